@@ -0,0 +1,96 @@
+// Hit ratio and throughput of ShardedEvictingCacheMap with LockedReads versus
+// BufferedReads.  Every thread replays its own Zipfian trace (skew 0.9) over
+// 1M keys against a map of 100k entries and puts a key on a miss.  Buffered
+// reads are replayed late or dropped, so the hit ratio shows what their
+// approximate eviction order costs.  The thread count goes up to the number
+// of hardware threads, or to the first argument if given.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ShardedEvictingCacheMap.h"
+#include "Workloads.h"
+
+namespace {
+
+const std::uint64_t KeyCount = 1000000;
+const std::size_t Capacity = 100000;
+const std::size_t TraceLength = 1 << 21;
+
+template <class TReads>
+using Cache =
+    ShardedEvictingCacheMap<std::uint64_t, std::uint64_t,
+                            std::hash<std::uint64_t>,
+                            std::equal_to<std::uint64_t>, LruEviction,
+                            std::allocator<std::pair<const std::uint64_t,
+                                                     std::uint64_t>>,
+                            NoStats, TReads>;
+
+struct Result {
+  double hitRatio;
+  double mops;
+};
+
+template <class TReads>
+Result Measure(const std::vector<std::vector<std::uint64_t>>& traces,
+               unsigned threadCount) {
+  Cache<TReads> cache(Capacity);
+  std::atomic<std::size_t> hits{0};
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threadCount; ++t)
+    threads.emplace_back([&cache, &hits, &trace = traces[t]]() {
+      std::size_t found = 0;
+      for (std::uint64_t key : trace) {
+        if (cache.get(key))
+          ++found;
+        else
+          cache.put(key, key);
+      }
+      hits += found;
+    });
+  for (auto& thread : threads) thread.join();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const double accesses = static_cast<double>(TraceLength) * threadCount;
+  return {static_cast<double>(hits) / accesses,
+          accesses / elapsed.count() / 1e6};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const unsigned maxThreads =
+      argc > 1 ? static_cast<unsigned>(std::atoi(argv[1]))
+               : std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::vector<std::uint64_t>> traces;
+  for (unsigned t = 0; t < maxThreads; ++t)
+    traces.push_back(workloads::MakeTrace(
+        workloads::Zipf(KeyCount, 0.9, t + 1), TraceLength));
+
+  std::vector<unsigned> threadCounts;
+  for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%8s %12s %12s %12s %12s\n", "threads", "locked hits",
+              "Mops/s", "buffered", "Mops/s");
+  for (unsigned threads : threadCounts) {
+    const Result locked = Measure<LockedReads>(traces, threads);
+    const Result buffered = Measure<BufferedReads<>>(traces, threads);
+    std::printf("%8u %12.4f %12.2f %12.4f %12.2f\n", threads,
+                locked.hitRatio, locked.mops, buffered.hitRatio,
+                buffered.mops);
+  }
+}
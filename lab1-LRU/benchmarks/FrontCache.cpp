@@ -0,0 +1,87 @@
+// Multi-threaded throughput of ShardedEvictingCacheMap versus FrontCachedMap
+// on hot keys.  Every thread replays its own Zipfian trace with skew 0.99
+// over 100k keys, all of which fit into the map, and overwrites one key out
+// of every hundred instead of reading it.  With this skew a handful of keys
+// take most of the accesses, so the shards holding them are contended by all
+// threads, while FrontCachedMap serves them from per-thread front caches.
+// The thread count goes up to the number of hardware threads, or to the
+// first argument if given.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "FrontCachedMap.h"
+#include "ShardedEvictingCacheMap.h"
+#include "Workloads.h"
+
+namespace {
+
+const std::uint64_t KeyCount = 100000;
+const std::size_t TraceLength = 1 << 21;
+const std::size_t PutPeriod = 100;
+
+template <class TCache>
+double MeasureMops(TCache& cache,
+                   const std::vector<std::vector<std::uint64_t>>& traces,
+                   unsigned threadCount) {
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threadCount; ++t)
+    threads.emplace_back([&cache, &trace = traces[t]]() {
+      std::uint64_t sum = 0;
+      for (std::size_t i = 0; i < trace.size(); ++i) {
+        if (i % PutPeriod == 0)
+          cache.put(trace[i], i);
+        else if (auto value = cache.get(trace[i]))
+          sum += *value;
+      }
+      // Keeps the reads from being optimized away
+      if (sum == 1) std::printf("\n");
+    });
+  for (auto& thread : threads) thread.join();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return static_cast<double>(TraceLength) * threadCount / elapsed.count() /
+         1e6;
+}
+
+template <class TCache>
+void Fill(TCache& cache) {
+  for (std::uint64_t rank = 0; rank < KeyCount; ++rank)
+    cache.put(workloads::Scatter(rank), rank);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const unsigned maxThreads =
+      argc > 1 ? static_cast<unsigned>(std::atoi(argv[1]))
+               : std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::vector<std::uint64_t>> traces;
+  for (unsigned t = 0; t < maxThreads; ++t)
+    traces.push_back(workloads::MakeTrace(
+        workloads::Zipf(KeyCount, 0.99, t + 1), TraceLength));
+
+  std::vector<unsigned> threadCounts;
+  for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%8s %16s %16s\n", "threads", "sharded Mops/s", "front Mops/s");
+  for (unsigned threads : threadCounts) {
+    ShardedEvictingCacheMap<std::uint64_t, std::uint64_t> sharded(KeyCount);
+    FrontCachedMap<std::uint64_t, std::uint64_t> front(KeyCount);
+    Fill(sharded);
+    Fill(front);
+    const double shardedMops = MeasureMops(sharded, traces, threads);
+    const double frontMops = MeasureMops(front, traces, threads);
+    std::printf("%8u %16.2f %16.2f\n", threads, shardedMops, frontMops);
+  }
+}
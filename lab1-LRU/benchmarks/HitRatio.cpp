@@ -0,0 +1,98 @@
+// Hit ratio of the eviction policies on synthetic traces.  Every access looks
+// the key up and inserts it on a miss.  The key space has 100k keys and the
+// cache holds 1%, 5% or 10% of it.  The ghost lists ArcEviction keeps for
+// the largest cache are reported per trace.
+
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "ArcEviction.h"
+#include "EvictingCacheMap.h"
+#include "LfuEviction.h"
+#include "EvictionPolicies.h"
+#include "TinyLfuEviction.h"
+#include "Workloads.h"
+
+namespace {
+
+const std::uint64_t KeyCount = 100000;
+const std::size_t TraceLength = 2000000;
+
+template <class TEvictionPolicy>
+using Cache =
+    EvictingCacheMap<std::uint64_t, std::uint64_t, std::hash<std::uint64_t>,
+                     std::equal_to<std::uint64_t>, TEvictionPolicy>;
+
+template <class TCache>
+double Replay(TCache& cache, const std::vector<std::uint64_t>& trace) {
+  std::size_t hits = 0;
+  for (std::uint64_t key : trace) {
+    if (cache.find(key) != cache.end())
+      ++hits;
+    else
+      cache.put(key, key);
+  }
+  return static_cast<double>(hits) / trace.size();
+}
+
+template <class TEvictionPolicy>
+double HitRatio(const std::vector<std::uint64_t>& trace,
+                std::size_t capacity) {
+  Cache<TEvictionPolicy> cache(capacity);
+  return Replay(cache, trace);
+}
+
+void Report(const char* name, const std::vector<std::uint64_t>& trace) {
+  for (std::size_t percent : {1, 5, 10}) {
+    const std::size_t capacity = KeyCount * percent / 100;
+    std::printf("%-14s %7zu %8.4f %8.4f %8.4f %10.4f %8.4f %8.4f %10.4f\n",
+                name, capacity, HitRatio<LruEviction>(trace, capacity),
+                HitRatio<ClockEviction>(trace, capacity),
+                HitRatio<SieveEviction>(trace, capacity),
+                HitRatio<WTinyLfuEviction>(trace, capacity),
+                HitRatio<ArcEviction>(trace, capacity),
+                HitRatio<LfuEviction<>>(trace, capacity),
+                HitRatio<LfuEviction<10>>(trace, capacity));
+  }
+}
+
+void ReportGhosts(const char* name, const std::vector<std::uint64_t>& trace) {
+  const std::size_t capacity = KeyCount / 10;
+  Cache<ArcEviction> cache(capacity);
+  Replay(cache, trace);
+  const auto& policy = cache.evictionPolicy();
+  std::printf("%-14s %7zu %8zu %12zu %14.1f\n", name, capacity,
+              policy.GhostCount(), policy.GhostMemoryUsage(),
+              static_cast<double>(policy.GhostMemoryUsage()) / capacity);
+}
+
+}  // namespace
+
+int main() {
+  const std::pair<const char*, std::vector<std::uint64_t>> traces[] = {
+      {"zipf-0.8", workloads::MakeTrace(workloads::Zipf(KeyCount, 0.8, 1),
+                                        TraceLength)},
+      {"zipf-0.99", workloads::MakeTrace(workloads::Zipf(KeyCount, 0.99, 2),
+                                         TraceLength)},
+      {"zipf+scan",
+       workloads::MakeTrace(
+           workloads::ScanMixed(KeyCount, 0.99, 50000, 20000, 3),
+           TraceLength)},
+      {"zipf+loop",
+       workloads::MakeTrace(
+           workloads::LoopMixed(KeyCount, 0.99, 50000, 20000, 5),
+           TraceLength)},
+      {"hot-shift",
+       workloads::MakeTrace(workloads::HotSetShift(KeyCount, 0.99, 500000, 4),
+                            TraceLength)}};
+
+  std::printf("%-14s %7s %8s %8s %8s %10s %8s %8s %10s\n", "trace", "cap",
+              "LRU", "CLOCK", "SIEVE", "W-TinyLFU", "ARC", "LFU", "LFU-aged");
+  for (const auto& [name, trace] : traces) Report(name, trace);
+
+  std::printf("\n%-14s %7s %8s %12s %14s\n", "ARC ghosts", "cap", "count",
+              "bytes", "bytes/entry");
+  for (const auto& [name, trace] : traces) ReportGhosts(name, trace);
+}
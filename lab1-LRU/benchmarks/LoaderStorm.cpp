@@ -0,0 +1,107 @@
+// Loader invocations under a hot-key storm.  In every round all threads miss
+// the same new key at once; the naive approach of get() followed by put() on
+// a miss lets every thread run the expensive loader, getOrLoad() runs it once
+// and lets the other threads wait for its result.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ShardedEvictingCacheMap.h"
+
+namespace {
+
+using Cache = ShardedEvictingCacheMap<std::uint64_t, std::uint64_t>;
+
+const std::size_t Capacity = 1 << 16;
+const int Rounds = 100;
+const auto LoadTime = std::chrono::milliseconds(1);
+
+// Releases the waiting threads together once all of them have arrived
+class Barrier {
+ public:
+  explicit Barrier(unsigned count) : count(count) {}
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    const unsigned arrival = generation;
+    if (++arrived == count) {
+      arrived = 0;
+      ++generation;
+      released.notify_all();
+      return;
+    }
+    released.wait(lock, [&] { return generation != arrival; });
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable released;
+  const unsigned count;
+  unsigned arrived = 0;
+  unsigned generation = 0;
+};
+
+struct Result {
+  std::uint64_t loads;
+  double milliseconds;
+};
+
+template <class TFetch>
+Result RunStorm(unsigned threadCount, TFetch fetch) {
+  Cache cache(Capacity);
+  Barrier barrier(threadCount);
+  std::atomic<std::uint64_t> loads(0);
+  auto loader = [&loads](std::uint64_t key) {
+    ++loads;
+    std::this_thread::sleep_for(LoadTime);
+    return key * 2;
+  };
+
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threadCount; ++t)
+    threads.emplace_back([&]() {
+      for (int round = 0; round < Rounds; ++round) {
+        barrier.Wait();
+        fetch(cache, static_cast<std::uint64_t>(round), loader);
+      }
+    });
+  for (auto& thread : threads) thread.join();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return {loads.load(), elapsed.count()};
+}
+
+}  // namespace
+
+int main() {
+  const unsigned maxThreads =
+      std::max(16u, 2 * std::thread::hardware_concurrency());
+
+  std::printf("%8s %14s %14s %14s %14s\n", "threads", "naive loads",
+              "naive ms", "single loads", "single ms");
+  for (unsigned threads = 2; threads <= maxThreads; threads *= 2) {
+    const Result naive = RunStorm(
+        threads, [](Cache& cache, std::uint64_t key, auto& loader) {
+          if (cache.get(key)) return;
+          cache.put(key, loader(key));
+        });
+    const Result single = RunStorm(
+        threads, [](Cache& cache, std::uint64_t key, auto& loader) {
+          cache.getOrLoad(key, loader);
+        });
+    std::printf("%8u %14llu %14.1f %14llu %14.1f\n", threads,
+                static_cast<unsigned long long>(naive.loads),
+                naive.milliseconds,
+                static_cast<unsigned long long>(single.loads),
+                single.milliseconds);
+  }
+}
@@ -0,0 +1,87 @@
+// Cost and accuracy of trackMissRatioCurve().  A map of 10k entries serves a
+// Zipfian trace over 100k keys with get() and put() on a miss, without and
+// with the sampled tracker in alternating runs, and the best time per access
+// of both is compared.  The hit ratios the tracker estimates for half, the
+// same and twice the capacity are then checked against maps actually of those
+// sizes.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "EvictingCacheMap.h"
+#include "Workloads.h"
+
+namespace {
+
+using Map = EvictingCacheMap<std::uint64_t, std::uint64_t>;
+
+const std::uint64_t KeyCount = 100000;
+const std::size_t Capacity = 10000;
+const std::size_t TraceLength = 4000000;
+const int Repetitions = 10;
+
+// @return hits of the trace
+std::size_t Replay(Map& map, const std::vector<std::uint64_t>& trace) {
+  std::size_t hits = 0;
+  for (std::uint64_t key : trace) {
+    if (map.get(key))
+      ++hits;
+    else
+      map.put(key, key);
+  }
+  return hits;
+}
+
+// Nanoseconds per access of one run
+double NsPerAccess(bool track, const std::vector<std::uint64_t>& trace) {
+  Map map(Capacity);
+  if (track) map.trackMissRatioCurve();
+  const auto start = std::chrono::steady_clock::now();
+  const std::size_t hits = Replay(map, trace);
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (hits == trace.size()) std::printf("unexpected\n");
+  return elapsed.count() / static_cast<double>(trace.size());
+}
+
+double ActualHitRatio(std::size_t capacity,
+                      const std::vector<std::uint64_t>& trace) {
+  Map map(capacity);
+  return static_cast<double>(Replay(map, trace)) /
+         static_cast<double>(trace.size());
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<std::uint64_t> trace =
+      workloads::MakeTrace(workloads::Zipf(KeyCount, 0.99, 7), TraceLength);
+
+  // Best of several runs, alternating so that drift of the machine affects
+  // both alike
+  double plain = 0;
+  double tracked = 0;
+  for (int run = 0; run < Repetitions; ++run) {
+    const double ns = NsPerAccess(false, trace);
+    if (run == 0 || ns < plain) plain = ns;
+    const double nsTracked = NsPerAccess(true, trace);
+    if (run == 0 || nsTracked < tracked) tracked = nsTracked;
+  }
+  std::printf("%-12s %10s\n", "", "ns/access");
+  std::printf("%-12s %10.2f\n", "untracked", plain);
+  std::printf("%-12s %10.2f\n", "tracked", tracked);
+  std::printf("overhead %.2f%%\n\n", 100 * (tracked - plain) / plain);
+
+  Map map(Capacity);
+  map.trackMissRatioCurve();
+  Replay(map, trace);
+  const MissRatioCurve& curve = *map.missRatioCurve();
+  std::printf("sampling rate %.4f, %zu keys tracked\n", curve.Rate(),
+              curve.Samples());
+  std::printf("%10s %10s %10s\n", "capacity", "estimated", "actual");
+  for (std::size_t capacity : {Capacity / 2, Capacity, 2 * Capacity})
+    std::printf("%10zu %10.4f %10.4f\n", capacity, curve.HitRatio(capacity),
+                ActualHitRatio(capacity, trace));
+}
@@ -0,0 +1,94 @@
+// Batched lookups versus a loop of single ones on a map much larger than the
+// last level cache.  Requests of 50 to 500 uniformly distributed keys are
+// served by calling get() or put() per key, or by multiGet() and multiPut(),
+// which prefetch the index slots and entries of a batch before touching them.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "EvictingCacheMap.h"
+
+namespace {
+
+using Map = EvictingCacheMap<std::uint64_t, std::uint64_t>;
+
+const std::size_t Capacity = 1 << 23;
+const std::size_t KeysPerRun = 1 << 22;
+const std::size_t RequestSizes[] = {50, 100, 500};
+
+std::uint64_t NextRandom(std::uint64_t& state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+std::vector<std::uint64_t> RandomKeys(std::size_t count, std::uint64_t seed) {
+  std::vector<std::uint64_t> keys(count);
+  for (auto& key : keys) key = NextRandom(seed) % Capacity;
+  return keys;
+}
+
+template <class TServe>
+double MeasureNsPerKey(const std::vector<std::uint64_t>& keys,
+                       std::size_t requestSize, TServe serve) {
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i + requestSize <= keys.size(); i += requestSize)
+    serve(keys.data() + i, keys.data() + i + requestSize);
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(keys.size());
+}
+
+}  // namespace
+
+int main() {
+  Map map(Capacity);
+  map.reserve(Capacity);
+  for (std::uint64_t key = 0; key < Capacity; ++key) map.put(key, key);
+
+  const std::vector<std::uint64_t> keys = RandomKeys(KeysPerRun, 12345);
+  std::vector<std::optional<std::uint64_t>> values(RequestSizes[2]);
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> entries(
+      RequestSizes[2]);
+  std::uint64_t checksum = 0;
+
+  std::printf("%8s %14s %14s %14s %14s\n", "keys", "get ns/key",
+              "multiGet ns", "put ns/key", "multiPut ns");
+  for (std::size_t requestSize : RequestSizes) {
+    const double get = MeasureNsPerKey(
+        keys, requestSize,
+        [&](const std::uint64_t* first, const std::uint64_t* last) {
+          for (; first != last; ++first)
+            if (auto value = map.get(*first)) checksum += *value;
+        });
+    const double multiGet = MeasureNsPerKey(
+        keys, requestSize,
+        [&](const std::uint64_t* first, const std::uint64_t* last) {
+          map.multiGet(first, last, values.begin());
+          for (std::size_t i = 0; i < requestSize; ++i)
+            if (values[i]) checksum += *values[i];
+        });
+    const double put = MeasureNsPerKey(
+        keys, requestSize,
+        [&](const std::uint64_t* first, const std::uint64_t* last) {
+          for (; first != last; ++first) map.put(*first, *first + 1);
+        });
+    const double multiPut = MeasureNsPerKey(
+        keys, requestSize,
+        [&](const std::uint64_t* first, const std::uint64_t* last) {
+          auto entry = entries.begin();
+          for (; first != last; ++first, ++entry)
+            *entry = {*first, *first + 2};
+          map.multiPut(entries.begin(), entry);
+        });
+    std::printf("%8zu %14.1f %14.1f %14.1f %14.1f\n", requestSize, get,
+                multiGet, put, multiPut);
+  }
+  std::printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+}
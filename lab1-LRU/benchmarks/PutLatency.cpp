@@ -0,0 +1,108 @@
+// Latency distribution of single put() calls while a map fills up from empty.
+// Growing the index used to rehash all entries inside one put(); with
+// incremental rehashing the work is spread over the following calls.  The
+// first two rows drive RobinHoodIndex directly with both strategies, the
+// other two use EvictingCacheMap with and without reserve().
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "EvictingCacheMap.h"
+#include "RobinHoodIndex.h"
+
+namespace {
+
+const std::size_t Capacity = 1 << 22;
+const std::size_t Operations = 2 * Capacity;
+
+using Clock = std::chrono::steady_clock;
+
+class LatencyRecorder {
+ public:
+  explicit LatencyRecorder(std::size_t expected) { samples.reserve(expected); }
+
+  template <class TOperation>
+  void Measure(TOperation&& operation) {
+    const auto start = Clock::now();
+    operation();
+    const auto elapsed = Clock::now() - start;
+    samples.push_back(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+            .count()));
+  }
+
+  void Report(const char* name) {
+    std::sort(samples.begin(), samples.end());
+    std::printf("%-22s %8llu %8llu %8llu %8llu %12llu\n", name, Percentile(0.5),
+                Percentile(0.99), Percentile(0.999), Percentile(0.9999),
+                static_cast<unsigned long long>(samples.back()));
+  }
+
+ private:
+  unsigned long long Percentile(double fraction) const {
+    const auto pos = static_cast<std::size_t>(fraction * (samples.size() - 1));
+    return static_cast<unsigned long long>(samples[pos]);
+  }
+
+  std::vector<std::uint64_t> samples;
+};
+
+std::uint64_t KeyAt(std::size_t i) { return i * 0x9e3779b97f4a7c15ULL; }
+
+// Grow the index by doubling once it is 3/4 full, like EvictingCacheMap.
+void IndexInserts(bool incremental, LatencyRecorder& recorder) {
+  using Index = RobinHoodIndex<std::uint64_t>;
+  Index index(4);
+  for (std::size_t i = 0; i < Capacity; ++i) {
+    recorder.Measure([&]() {
+      const std::size_t entries = index.Size() + 1;
+      if (4 * entries > 3 * index.BucketCount()) {
+        if (incremental)
+          index.StartRehash(2 * index.BucketCount());
+        else
+          index.Rehash(2 * index.BucketCount());
+      } else if (incremental && entries == index.BucketCount() / 2 + 1) {
+        index.PrepareRehash(2 * index.BucketCount());
+      }
+      if (index.RehashPending()) index.RehashStep(4);
+      index.Insert(Index::Mix(KeyAt(i)), i);
+    });
+  }
+}
+
+void MapPuts(bool reserve, LatencyRecorder& recorder) {
+  EvictingCacheMap<std::uint64_t, std::uint64_t> map(Capacity);
+  if (reserve) map.reserve(Capacity);
+  for (std::size_t i = 0; i < Operations; ++i)
+    recorder.Measure([&]() { map.put(KeyAt(i), i); });
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-22s %8s %8s %8s %8s %12s\n", "ns per put", "p50", "p99",
+              "p99.9", "p99.99", "max");
+  {
+    LatencyRecorder recorder(Capacity);
+    IndexInserts(false, recorder);
+    recorder.Report("index, full rehash");
+  }
+  {
+    LatencyRecorder recorder(Capacity);
+    IndexInserts(true, recorder);
+    recorder.Report("index, incremental");
+  }
+  {
+    LatencyRecorder recorder(Operations);
+    MapPuts(false, recorder);
+    recorder.Report("map");
+  }
+  {
+    LatencyRecorder recorder(Operations);
+    MapPuts(true, recorder);
+    recorder.Report("map, reserve()");
+  }
+}
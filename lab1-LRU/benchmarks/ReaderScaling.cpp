@@ -0,0 +1,81 @@
+// Read throughput of ShardedEvictingCacheMap versus ReadMostlyCacheMap as
+// readers are added.  Every thread looks up Zipfian keys (skew 0.9) over a
+// map holding all 100k of them and puts one key per thousand lookups, the
+// read to write ratio of configuration and metadata caches.  The thread
+// count goes up to the number of hardware threads, or to the first argument
+// if given.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "ReadMostlyCacheMap.h"
+#include "ShardedEvictingCacheMap.h"
+#include "Workloads.h"
+
+namespace {
+
+const std::uint64_t KeyCount = 100000;
+const std::size_t TraceLength = 1 << 21;
+const std::size_t PutPeriod = 1000;
+
+template <class TCache>
+double MeasureMops(TCache& cache,
+                   const std::vector<std::vector<std::uint64_t>>& traces,
+                   unsigned threadCount) {
+  for (std::uint64_t rank = 0; rank < KeyCount; ++rank)
+    cache.put(workloads::Scatter(rank), rank);
+
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threadCount; ++t)
+    threads.emplace_back([&cache, &trace = traces[t]]() {
+      std::uint64_t sum = 0;
+      for (std::size_t i = 0; i < trace.size(); ++i) {
+        if (i % PutPeriod == 0)
+          cache.put(trace[i], i);
+        else if (auto value = cache.get(trace[i]))
+          sum += *value;
+      }
+      // Keeps the reads from being optimized away
+      if (sum == 1) std::printf("\n");
+    });
+  for (auto& thread : threads) thread.join();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return static_cast<double>(TraceLength) * threadCount / elapsed.count() /
+         1e6;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const unsigned maxThreads =
+      argc > 1 ? static_cast<unsigned>(std::atoi(argv[1]))
+               : std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::vector<std::uint64_t>> traces;
+  for (unsigned t = 0; t < maxThreads; ++t)
+    traces.push_back(workloads::MakeTrace(
+        workloads::Zipf(KeyCount, 0.9, t + 1), TraceLength));
+
+  std::vector<unsigned> threadCounts;
+  for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%8s %16s %20s\n", "threads", "sharded Mops/s",
+              "read-mostly Mops/s");
+  for (unsigned threads : threadCounts) {
+    ShardedEvictingCacheMap<std::uint64_t, std::uint64_t> sharded(KeyCount);
+    ReadMostlyCacheMap<std::uint64_t, std::uint64_t> readMostly(KeyCount);
+    const double shardedMops = MeasureMops(sharded, traces, threads);
+    const double readMostlyMops = MeasureMops(readMostly, traces, threads);
+    std::printf("%8u %16.2f %20.2f\n", threads, shardedMops, readMostlyMops);
+  }
+}
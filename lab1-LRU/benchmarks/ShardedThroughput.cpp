@@ -0,0 +1,90 @@
+// Multi-threaded throughput of a single mutex around EvictingCacheMap versus
+// ShardedEvictingCacheMap.  Every thread looks up uniformly distributed keys
+// and inserts them on a miss; the key space is twice the capacity, so about
+// half of the lookups miss and cause an eviction.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "EvictingCacheMap.h"
+#include "ShardedEvictingCacheMap.h"
+
+namespace {
+
+const std::size_t Capacity = 1 << 20;
+const std::uint64_t KeySpace = 2 * Capacity;
+const int OpsPerThread = 1 << 21;
+
+class GlobalMutexCache {
+ public:
+  explicit GlobalMutexCache(std::size_t capacity) : map(capacity) {}
+
+  std::optional<std::uint64_t> get(std::uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return map.get(key);
+  }
+
+  void put(std::uint64_t key, std::uint64_t value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    map.put(key, value);
+  }
+
+ private:
+  std::mutex mutex;
+  EvictingCacheMap<std::uint64_t, std::uint64_t> map;
+};
+
+std::uint64_t NextRandom(std::uint64_t& state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+template <class TCache>
+double MeasureMops(TCache& cache, unsigned threadCount) {
+  for (std::uint64_t key = 0; key < Capacity; ++key) cache.put(key, key);
+
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threadCount; ++t)
+    threads.emplace_back([&cache, t]() {
+      std::uint64_t state = 0x9e3779b97f4a7c15ULL * (t + 1);
+      for (int i = 0; i < OpsPerThread; ++i) {
+        const std::uint64_t key = NextRandom(state) % KeySpace;
+        if (!cache.get(key)) cache.put(key, key);
+      }
+    });
+  for (auto& thread : threads) thread.join();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return static_cast<double>(OpsPerThread) * threadCount / elapsed.count() /
+         1e6;
+}
+
+}  // namespace
+
+int main() {
+  const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<unsigned> threadCounts;
+  for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%8s %16s %16s\n", "threads", "mutex Mops/s", "sharded Mops/s");
+  for (unsigned threads : threadCounts) {
+    GlobalMutexCache global(Capacity);
+    ShardedEvictingCacheMap<std::uint64_t, std::uint64_t> sharded(Capacity);
+    const double globalMops = MeasureMops(global, threads);
+    const double shardedMops = MeasureMops(sharded, threads);
+    std::printf("%8u %16.2f %16.2f\n", threads, globalMops, shardedMops);
+  }
+}
@@ -0,0 +1,98 @@
+// Cost of the statistics modes.  A map of 10k entries serves a Zipfian trace
+// over 100k keys with get() and put() on a miss, without statistics, with
+// counters only, with counters and the latency of every operation and of
+// every 16th one, and the time per access is compared.  Then the recorded
+// statistics of one run are printed.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "CacheStats.h"
+#include "EvictingCacheMap.h"
+#include "Workloads.h"
+
+namespace {
+
+template <class TStats>
+using Map = EvictingCacheMap<std::uint64_t, std::uint64_t,
+                             std::hash<std::uint64_t>,
+                             std::equal_to<std::uint64_t>, LruEviction,
+                             std::allocator<std::pair<const std::uint64_t,
+                                                      std::uint64_t>>,
+                             UnitWeigher, NoExpiration, TStats>;
+
+const std::uint64_t KeyCount = 100000;
+const std::size_t Capacity = 10000;
+const std::size_t TraceLength = 4000000;
+const int Repetitions = 5;
+
+template <class TMap>
+std::size_t Replay(TMap& map, const std::vector<std::uint64_t>& trace) {
+  std::size_t hits = 0;
+  for (std::uint64_t key : trace) {
+    if (map.get(key))
+      ++hits;
+    else
+      map.put(key, key);
+  }
+  return hits;
+}
+
+// Best of several runs, in nanoseconds per access
+template <class TStats>
+double MeasureNsPerAccess(const std::vector<std::uint64_t>& trace,
+                          std::size_t& hits) {
+  double best = 0;
+  for (int run = 0; run < Repetitions; ++run) {
+    Map<TStats> map(Capacity);
+    const auto start = std::chrono::steady_clock::now();
+    hits = Replay(map, trace);
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double ns = elapsed.count() / static_cast<double>(trace.size());
+    if (run == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<std::uint64_t> trace =
+      workloads::MakeTrace(workloads::Zipf(KeyCount, 0.99, 7), TraceLength);
+
+  std::size_t hits = 0;
+  const double none = MeasureNsPerAccess<NoStats>(trace, hits);
+  const double counted = MeasureNsPerAccess<CountStats>(trace, hits);
+  const double recorded = MeasureNsPerAccess<RecordStats<>>(trace, hits);
+  const double sampled = MeasureNsPerAccess<
+      RecordStats<std::chrono::steady_clock, 16>>(trace, hits);
+  std::printf("%-14s %10s %10s\n", "", "ns/access", "overhead");
+  std::printf("%-14s %10.2f\n", "NoStats", none);
+  std::printf("%-14s %10.2f %9.1f%%\n", "CountStats", counted,
+              100 * (counted - none) / none);
+  std::printf("%-14s %10.2f %9.1f%%\n", "RecordStats", recorded,
+              100 * (recorded - none) / none);
+  std::printf("%-14s %10.2f %9.1f%%\n\n", "RecordStats/16", sampled,
+              100 * (sampled - none) / none);
+
+  Map<RecordStats<>> map(Capacity);
+  Replay(map, trace);
+  const CacheStatsSnapshot stats = map.stats();
+  std::printf("hit ratio %.4f (%zu hits counted outside), %llu evictions\n",
+              stats.HitRatio(), hits,
+              static_cast<unsigned long long>(stats.evictions));
+  std::printf("%-6s %8s %8s %8s %8s\n", "ns", "p50", "p99", "p99.9",
+              "p99.99");
+  const std::pair<const char*, const LatencyHistogram*> histograms[] = {
+      {"get", &stats.getLatency}, {"put", &stats.putLatency}};
+  for (const auto& [name, histogram] : histograms)
+    std::printf("%-6s %8llu %8llu %8llu %8llu\n", name,
+                static_cast<unsigned long long>(histogram->Percentile(0.5)),
+                static_cast<unsigned long long>(histogram->Percentile(0.99)),
+                static_cast<unsigned long long>(histogram->Percentile(0.999)),
+                static_cast<unsigned long long>(
+                    histogram->Percentile(0.9999)));
+}
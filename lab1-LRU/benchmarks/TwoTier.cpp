@@ -0,0 +1,118 @@
+// Memory-only cache versus TieredCache with a log on the local disk.  A
+// Zipfian trace over 1M keys with 64-byte values is served by a map of 100k
+// entries, i.e. a tenth of the key space, with put() on a miss; then by a
+// TieredCache with the same map in front of a log as large as the key space,
+// once key by key and once with multiGet() batches of 32 keys.  The hit
+// ratio, the time per access and the reads per access are compared.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "EvictingCacheMap.h"
+#include "TieredCache.h"
+#include "Workloads.h"
+
+namespace {
+
+struct Value {
+  std::uint64_t payload[8];
+};
+
+using Cache = TieredCache<std::uint64_t, Value>;
+
+const std::uint64_t KeyCount = 1000000;
+const std::size_t Capacity = 100000;
+const std::size_t TraceLength = 2000000;
+const std::size_t SegmentSize = 1 << 20;
+const std::size_t BatchSize = 32;
+
+struct Result {
+  double hitRatio;
+  double nsPerAccess;
+  double readsPerAccess;
+};
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+Result MemoryOnly(const std::vector<std::uint64_t>& trace) {
+  EvictingCacheMap<std::uint64_t, Value> map(Capacity);
+  std::size_t hits = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::uint64_t key : trace) {
+    if (map.get(key))
+      ++hits;
+    else
+      map.put(key, Value{{key}});
+  }
+  const double size = static_cast<double>(trace.size());
+  return {static_cast<double>(hits) / size, SecondsSince(start) * 1e9 / size,
+          0};
+}
+
+Result Tiered(const std::vector<std::uint64_t>& trace,
+              const std::string& directory, bool batched) {
+  const std::size_t segmentCount =
+      KeyCount * Cache::Log::RecordSize / SegmentSize + 2;
+  Cache cache(Capacity, directory, SegmentSize, segmentCount);
+  std::size_t hits = 0;
+  std::vector<std::optional<Value>> values;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < trace.size(); i += BatchSize) {
+    const auto first = trace.begin() + i;
+    const auto last = trace.begin() + std::min(i + BatchSize, trace.size());
+    values.clear();
+    if (batched) {
+      cache.multiGet(first, last, std::back_inserter(values));
+    } else {
+      for (auto key = first; key != last; ++key)
+        values.push_back(cache.get(*key));
+    }
+    for (std::size_t j = 0; j < values.size(); ++j) {
+      if (values[j])
+        ++hits;
+      else
+        cache.put(first[j], Value{{first[j]}});
+    }
+  }
+  const double size = static_cast<double>(trace.size());
+  return {static_cast<double>(hits) / size, SecondsSince(start) * 1e9 / size,
+          static_cast<double>(cache.fileTier().Reads()) / size};
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<std::uint64_t> trace =
+      workloads::MakeTrace(workloads::Zipf(KeyCount, 0.9, 7), TraceLength);
+  const std::string directory = "/tmp/TwoTier";
+  ::mkdir(directory.c_str(), 0755);
+
+  const Result memory = MemoryOnly(trace);
+  const Result tiered = Tiered(trace, directory, false);
+  const Result batched = Tiered(trace, directory, true);
+  ::rmdir(directory.c_str());
+
+  std::printf("%-16s %10s %10s %10s\n", "", "hit ratio", "ns/access",
+              "reads");
+  const std::pair<const char*, const Result*> results[] = {
+      {"memory only", &memory},
+      {"tiered", &tiered},
+      {"tiered, batched", &batched}};
+  for (const auto& [name, result] : results)
+    std::printf("%-16s %10.4f %10.1f %10.4f\n", name, result->hitRatio,
+                result->nsPerAccess, result->readsPerAccess);
+}
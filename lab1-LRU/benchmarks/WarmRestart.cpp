@@ -0,0 +1,59 @@
+// Time to save and load a snapshot of a full map.  A map of 64-bit keys and
+// values, 10M entries unless another count is given as the first argument,
+// is saved with SaveSnapshot() and restored into a new map with
+// LoadSnapshot(), and both are compared with filling the map by put() calls.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "EvictingCacheMap.h"
+#include "Snapshot.h"
+#include "Workloads.h"
+
+namespace {
+
+using Map = EvictingCacheMap<std::uint64_t, std::uint64_t>;
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::size_t count =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  const std::string path = "/tmp/WarmRestart.snapshot";
+
+  auto start = std::chrono::steady_clock::now();
+  std::size_t checksum = 0;
+  {
+    Map map(count);
+    for (std::uint64_t i = 0; i < count; ++i)
+      map.put(workloads::Scatter(i), i);
+    const double fill = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    SaveSnapshot(map, path);
+    const double save = SecondsSince(start);
+    std::printf("%zu entries\n", count);
+    std::printf("%-6s %8.3f s\n", "put", fill);
+    std::printf("%-6s %8.3f s\n", "save", save);
+  }
+  {
+    Map map(count);
+    start = std::chrono::steady_clock::now();
+    LoadSnapshot(map, path);
+    const double load = SecondsSince(start);
+    std::printf("%-6s %8.3f s\n", "load", load);
+    // The most recently used entry comes first
+    checksum = map.begin()->second + map.size();
+  }
+  std::remove(path.c_str());
+  if (checksum != 2 * count - 1) std::printf("unexpected\n");
+}
@@ -0,0 +1,155 @@
+#ifndef BENCHMARKS_WORKLOADS_H_
+#define BENCHMARKS_WORKLOADS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+  Key generators shared by the benchmarks.  Every generator is a functor
+    returning the next key of the trace; keys are 64-bit integers, hot keys
+    are scattered over the key space so that they do not end up next to each
+    other in the index.
+*/
+
+namespace workloads {
+
+inline std::uint64_t Scatter(std::uint64_t key) {
+  key ^= key >> 31;
+  key *= 0x7fb5d329728ea185ULL;
+  key ^= key >> 27;
+  return key;
+}
+
+/**
+ * Uniformly distributed keys from [0, keyCount).
+ */
+class Uniform {
+ public:
+  Uniform(std::uint64_t keyCount, std::uint64_t seed)
+      : random(seed), distribution(0, keyCount - 1) {}
+
+  std::uint64_t operator()() { return Scatter(distribution(random)); }
+
+ private:
+  std::mt19937_64 random;
+  std::uniform_int_distribution<std::uint64_t> distribution;
+};
+
+/**
+ * Zipf distributed keys from [0, keyCount): the key of rank k is drawn with
+ *     probability proportional to 1 / k^skew.
+ */
+class Zipf {
+ public:
+  Zipf(std::uint64_t keyCount, double skew, std::uint64_t seed)
+      : random(seed), cdf(keyCount) {
+    double sum = 0;
+    for (std::uint64_t rank = 0; rank < keyCount; ++rank) {
+      sum += 1.0 / std::pow(static_cast<double>(rank + 1), skew);
+      cdf[rank] = sum;
+    }
+    for (auto& value : cdf) value /= sum;
+  }
+
+  std::uint64_t operator()() {
+    const double u = uniform(random);
+    const auto rank = static_cast<std::uint64_t>(
+        std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+    return Scatter(std::min<std::uint64_t>(rank, cdf.size() - 1));
+  }
+
+ private:
+  std::mt19937_64 random;
+  std::uniform_real_distribution<double> uniform{0.0, 1.0};
+  std::vector<double> cdf;
+};
+
+/**
+ * Zipf distributed keys interrupted by sequential scans: every `period`
+ *     accesses a scan of `scanLength` keys which are never seen again is
+ *     inserted, like a batch job walking through the key space.
+ */
+class ScanMixed {
+ public:
+  ScanMixed(std::uint64_t keyCount, double skew, std::uint64_t period,
+            std::uint64_t scanLength, std::uint64_t seed)
+      : zipf(keyCount, skew, seed), period(period), scanLength(scanLength) {}
+
+  std::uint64_t operator()() {
+    if (position++ % (period + scanLength) < period) return zipf();
+    return Scatter(ScanBase + nextScanKey++);
+  }
+
+ private:
+  constexpr static std::uint64_t ScanBase = std::uint64_t(1) << 48;
+
+  Zipf zipf;
+  std::uint64_t period;
+  std::uint64_t scanLength;
+  std::uint64_t position = 0;
+  std::uint64_t nextScanKey = 0;
+};
+
+/**
+ * Zipf distributed keys interrupted by loops: every `period` accesses the
+ *     same `loopLength` keys are walked in order, like a nightly batch job
+ *     going through a table larger than the cache again and again.
+ */
+class LoopMixed {
+ public:
+  LoopMixed(std::uint64_t keyCount, double skew, std::uint64_t period,
+            std::uint64_t loopLength, std::uint64_t seed)
+      : zipf(keyCount, skew, seed), period(period), loopLength(loopLength) {}
+
+  std::uint64_t operator()() {
+    const std::uint64_t offset = position++ % (period + loopLength);
+    if (offset < period) return zipf();
+    return Scatter(LoopBase + offset - period);
+  }
+
+ private:
+  constexpr static std::uint64_t LoopBase = std::uint64_t(1) << 48;
+
+  Zipf zipf;
+  std::uint64_t period;
+  std::uint64_t loopLength;
+  std::uint64_t position = 0;
+};
+
+/**
+ * Zipf distributed keys whose hot set moves to a disjoint part of the key
+ *     space every `period` accesses.
+ */
+class HotSetShift {
+ public:
+  HotSetShift(std::uint64_t keyCount, double skew, std::uint64_t period,
+              std::uint64_t seed)
+      : zipf(keyCount, skew, seed), keyCount(keyCount), period(period) {}
+
+  std::uint64_t operator()() {
+    const std::uint64_t shift = position++ / period;
+    return Scatter(zipf() + shift * keyCount);
+  }
+
+ private:
+  Zipf zipf;
+  std::uint64_t keyCount;
+  std::uint64_t period;
+  std::uint64_t position = 0;
+};
+
+template <class TGenerator>
+std::vector<std::uint64_t> MakeTrace(TGenerator generator,
+                                     std::size_t length) {
+  std::vector<std::uint64_t> trace(length);
+  for (auto& key : trace) key = generator();
+  return trace;
+}
+
+}  // namespace workloads
+
+#endif  // BENCHMARKS_WORKLOADS_H_
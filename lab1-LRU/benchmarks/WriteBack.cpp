@@ -0,0 +1,106 @@
+// Write-through versus write-back in front of a FileBackingStore.  A cache of
+// 10k entries serves a Zipfian trace over 100k keys where every fourth access
+// is a put() and the others a get(), once writing every put() to the store
+// right away and once with WriteBackCache, flushing every 64k accesses.  The
+// time per access, the number of write requests and the number of records
+// written are compared.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "BackingStore.h"
+#include "EvictingCacheMap.h"
+#include "WriteBackCache.h"
+#include "Workloads.h"
+
+namespace {
+
+using Store = FileBackingStore<std::uint64_t, std::uint64_t>;
+
+const std::uint64_t KeyCount = 100000;
+const std::size_t Capacity = 10000;
+const std::size_t TraceLength = 1000000;
+const std::size_t FlushPeriod = 1 << 16;
+
+struct Result {
+  double nsPerAccess;
+  std::size_t batches;
+  std::size_t records;
+};
+
+std::string StorePath(const char* name) {
+  return std::string("/tmp/WriteBack.") + name + ".log";
+}
+
+Result WriteThrough(const std::vector<std::uint64_t>& trace) {
+  const std::string path = StorePath("through");
+  std::remove(path.c_str());
+  Result result{};
+  {
+    Store store(path);
+    EvictingCacheMap<std::uint64_t, std::uint64_t> map(Capacity);
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < trace.size(); ++i) {
+      const std::uint64_t key = trace[i];
+      if (i % 4 == 0) {
+        map.put(key, i);
+        store.Write({{key, i}});
+      } else if (!map.get(key)) {
+        if (auto value = store.Read(key)) map.put(key, *value);
+      }
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    result = {elapsed.count() / static_cast<double>(trace.size()),
+              store.Batches(), store.Records()};
+  }
+  std::remove(path.c_str());
+  return result;
+}
+
+Result WriteBack(const std::vector<std::uint64_t>& trace) {
+  const std::string path = StorePath("back");
+  std::remove(path.c_str());
+  Result result{};
+  {
+    Store store(path);
+    const auto start = std::chrono::steady_clock::now();
+    {
+      WriteBackCache<std::uint64_t, std::uint64_t> cache(Capacity, store,
+                                                         Capacity);
+      for (std::size_t i = 0; i < trace.size(); ++i) {
+        if (i % 4 == 0)
+          cache.put(trace[i], i);
+        else
+          cache.get(trace[i]);
+        if (i % FlushPeriod == FlushPeriod - 1) cache.flush();
+      }
+      cache.flush();
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    result = {elapsed.count() / static_cast<double>(trace.size()),
+              store.Batches(), store.Records()};
+  }
+  std::remove(path.c_str());
+  return result;
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<std::uint64_t> trace =
+      workloads::MakeTrace(workloads::Zipf(KeyCount, 0.99, 7), TraceLength);
+
+  const Result through = WriteThrough(trace);
+  const Result back = WriteBack(trace);
+  std::printf("%-14s %10s %10s %10s\n", "", "ns/access", "writes",
+              "records");
+  std::printf("%-14s %10.2f %10zu %10zu\n", "write-through",
+              through.nsPerAccess, through.batches, through.records);
+  std::printf("%-14s %10.2f %10zu %10zu\n", "write-back", back.nsPerAccess,
+              back.batches, back.records);
+}
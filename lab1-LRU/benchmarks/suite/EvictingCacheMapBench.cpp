@@ -0,0 +1,336 @@
+// Google Benchmark suite for EvictingCacheMap.  Every benchmark runs one
+// operation per iteration over a pregenerated key trace, so the reported time
+// is the time per operation.  Caches are measured with
+//   - Zipfian, uniform, scan-mixed and hot-set-shift key distributions
+//     (see Workloads.h), over a key space four times the capacity,
+//   - integer and string keys, and integer, string and 1KB blob values,
+//   - capacities from a few kilobytes, which fit into L1, up to hundreds of
+//     megabytes, which are bound by DRAM latency,
+// against a hand-rolled LRU made of std::unordered_map and std::list.
+//
+// Benchmark names read Operation/Cache<Key,Value>/distribution/capacity, use
+// --benchmark_filter to pick a subset.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "EvictingCacheMap.h"
+#include "Workloads.h"
+
+namespace {
+
+using Blob = std::array<char, 1024>;
+
+/**
+ * LRU cache as usually written with the standard library: a list of entries
+ *     ordered by recency and a hash map from keys to list iterators.
+ */
+template <class TKey, class TValue>
+class StdLruCache {
+ public:
+  explicit StdLruCache(std::size_t capacity) : capacity(capacity) {
+    index.reserve(capacity);
+  }
+
+  std::optional<TValue> get(const TKey& key) {
+    auto it = index.find(key);
+    if (it == index.end()) return {};
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+  }
+
+  template <class E>
+  void put(const TKey& key, E&& value) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+      it->second->second = std::forward<E>(value);
+      entries.splice(entries.begin(), entries, it->second);
+      return;
+    }
+    if (entries.size() == capacity) {
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+    entries.emplace_front(key, std::forward<E>(value));
+    index.emplace(key, entries.begin());
+  }
+
+  bool erase(const TKey& key) {
+    auto it = index.find(key);
+    if (it == index.end()) return false;
+    entries.erase(it->second);
+    index.erase(it);
+    return true;
+  }
+
+  std::size_t size() const { return index.size(); }
+
+ private:
+  using Entries = std::list<std::pair<TKey, TValue>>;
+
+  std::size_t capacity;
+  Entries entries;
+  std::unordered_map<TKey, typename Entries::iterator> index;
+};
+
+enum class Distribution { Zipf, Uniform, ScanMixed, HotSetShift };
+
+const char* NameOf(Distribution distribution) {
+  switch (distribution) {
+    case Distribution::Zipf:
+      return "zipf";
+    case Distribution::Uniform:
+      return "uniform";
+    case Distribution::ScanMixed:
+      return "scan";
+    default:
+      return "hotshift";
+  }
+}
+
+// Traces are long enough for every cache to see many more distinct keys than
+// it can hold before a trace wraps around.
+std::size_t TraceLength(std::size_t capacity) {
+  return std::max<std::size_t>(1 << 21, 16 * capacity);
+}
+
+// Benchmarks are registered so that the ones using the same trace run one
+// after another, only the last trace is kept.
+const std::vector<std::uint64_t>& Trace(Distribution distribution,
+                                        std::size_t capacity) {
+  static std::pair<Distribution, std::size_t> last;
+  static std::vector<std::uint64_t> trace;
+  if (!trace.empty() && last == std::make_pair(distribution, capacity))
+    return trace;
+  last = {distribution, capacity};
+
+  const std::uint64_t keyCount = 4 * capacity;
+  const std::size_t length = TraceLength(capacity);
+  const std::uint64_t seed = capacity + static_cast<int>(distribution);
+  switch (distribution) {
+    case Distribution::Zipf:
+      trace = workloads::MakeTrace(workloads::Zipf(keyCount, 0.99, seed),
+                                   length);
+      break;
+    case Distribution::Uniform:
+      trace = workloads::MakeTrace(workloads::Uniform(keyCount, seed),
+                                   length);
+      break;
+    case Distribution::ScanMixed:
+      trace = workloads::MakeTrace(
+          workloads::ScanMixed(keyCount, 0.99, keyCount / 2, keyCount / 5,
+                               seed),
+          length);
+      break;
+    case Distribution::HotSetShift:
+      trace = workloads::MakeTrace(
+          workloads::HotSetShift(keyCount, 0.99, length / 8, seed),
+          length);
+      break;
+  }
+  return trace;
+}
+
+// A trace of integer keys is used as it is
+template <class TKey>
+struct KeyTrace {
+  KeyTrace(Distribution distribution, std::size_t capacity)
+      : trace(Trace(distribution, capacity)) {}
+
+  const TKey& operator[](std::size_t position) const {
+    return trace[position];
+  }
+  std::size_t size() const { return trace.size(); }
+
+  const std::vector<std::uint64_t>& trace;
+};
+
+// String keys are built once per distinct key, the trace refers to them by
+// position
+template <>
+struct KeyTrace<std::string> {
+  KeyTrace(Distribution distribution, std::size_t capacity) {
+    const auto& keys = Trace(distribution, capacity);
+    std::unordered_map<std::uint64_t, std::uint32_t> positions;
+    trace.reserve(keys.size());
+    for (std::uint64_t key : keys) {
+      auto inserted = positions.emplace(key, distinct.size());
+      if (inserted.second) distinct.push_back(MakeKey(key));
+      trace.push_back(inserted.first->second);
+    }
+  }
+
+  const std::string& operator[](std::size_t position) const {
+    return distinct[trace[position]];
+  }
+  std::size_t size() const { return trace.size(); }
+
+  // Long enough to need a heap allocation
+  static std::string MakeKey(std::uint64_t key) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "user:%016llx",
+                  static_cast<unsigned long long>(key));
+    return buffer;
+  }
+
+  std::vector<std::string> distinct;
+  std::vector<std::uint32_t> trace;
+};
+
+template <class TKey>
+const KeyTrace<TKey>& Keys(Distribution distribution, std::size_t capacity) {
+  static std::pair<Distribution, std::size_t> last;
+  static std::unique_ptr<KeyTrace<TKey>> keys;
+  if (!keys || last != std::make_pair(distribution, capacity)) {
+    keys.reset();
+    keys = std::make_unique<KeyTrace<TKey>>(distribution, capacity);
+    last = {distribution, capacity};
+  }
+  return *keys;
+}
+
+// Fill a cache up to its capacity by going through the trace once at most
+// @return position in the trace to continue at
+template <class TCache, class TKey, class TValue>
+std::size_t WarmUp(TCache& cache, const KeyTrace<TKey>& keys,
+                   std::size_t capacity, const TValue& value) {
+  std::size_t position = 0;
+  while (position < keys.size() && cache.size() < capacity) {
+    const TKey& key = keys[position++];
+    if (!cache.get(key)) cache.put(key, value);
+  }
+  return position == keys.size() ? 0 : position;
+}
+
+template <class TValue>
+TValue MakeValue() {
+  return 42;
+}
+
+template <>
+std::string MakeValue<std::string>() {
+  return std::string(32, 'v');
+}
+
+template <>
+Blob MakeValue<Blob>() {
+  Blob blob;
+  blob.fill('b');
+  return blob;
+}
+
+// Look every key up and insert it on a miss, the usual way to use a cache
+template <class TCache, class TKey, class TValue>
+void GetOrPut(benchmark::State& state, Distribution distribution,
+              std::size_t capacity) {
+  const KeyTrace<TKey>& keys = Keys<TKey>(distribution, capacity);
+  const TValue value = MakeValue<TValue>();
+  TCache cache(capacity);
+  std::size_t position = WarmUp(cache, keys, capacity, value);
+  std::size_t hits = 0;
+  for (auto _ : state) {
+    const TKey& key = keys[position];
+    if (++position == keys.size()) position = 0;
+    auto found = cache.get(key);
+    if (found)
+      ++hits;
+    else
+      cache.put(key, value);
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["hit_ratio"] =
+      static_cast<double>(hits) / static_cast<double>(state.iterations());
+}
+
+// Unconditional put(): updates of present keys and insertions with eviction
+template <class TCache, class TKey, class TValue>
+void Put(benchmark::State& state, Distribution distribution,
+         std::size_t capacity) {
+  const KeyTrace<TKey>& keys = Keys<TKey>(distribution, capacity);
+  const TValue value = MakeValue<TValue>();
+  TCache cache(capacity);
+  std::size_t position = WarmUp(cache, keys, capacity, value);
+  for (auto _ : state) {
+    cache.put(keys[position], value);
+    if (++position == keys.size()) position = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// erase() of a present key followed by putting it back
+template <class TCache, class TKey, class TValue>
+void EraseAndPut(benchmark::State& state, Distribution distribution,
+                 std::size_t capacity) {
+  const KeyTrace<TKey>& keys = Keys<TKey>(distribution, capacity);
+  const TValue value = MakeValue<TValue>();
+  TCache cache(capacity);
+  std::size_t position = WarmUp(cache, keys, capacity, value);
+  for (auto _ : state) {
+    const TKey& key = keys[position];
+    if (++position == keys.size()) position = 0;
+    benchmark::DoNotOptimize(cache.erase(key));
+    cache.put(key, value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class TKey, class TValue>
+void RegisterCaches(const char* typeName,
+                    const std::vector<std::size_t>& capacities) {
+  using Ecm = EvictingCacheMap<TKey, TValue>;
+  using Std = StdLruCache<TKey, TValue>;
+  const std::tuple<const char*, void (*)(benchmark::State&, Distribution,
+                                         std::size_t)>
+      benchmarks[] = {
+          {"GetOrPut/EvictingCacheMap", GetOrPut<Ecm, TKey, TValue>},
+          {"GetOrPut/StdLru", GetOrPut<Std, TKey, TValue>},
+          {"Put/EvictingCacheMap", Put<Ecm, TKey, TValue>},
+          {"Put/StdLru", Put<Std, TKey, TValue>},
+          {"EraseAndPut/EvictingCacheMap", EraseAndPut<Ecm, TKey, TValue>},
+          {"EraseAndPut/StdLru", EraseAndPut<Std, TKey, TValue>},
+      };
+
+  for (Distribution distribution :
+       {Distribution::Zipf, Distribution::Uniform, Distribution::ScanMixed,
+        Distribution::HotSetShift}) {
+    for (std::size_t capacity : capacities) {
+      for (const auto& [name, function] : benchmarks) {
+        const std::string fullName = std::string(name) + "<" + typeName +
+                                     ">/" + NameOf(distribution) + "/" +
+                                     std::to_string(capacity);
+        benchmark::RegisterBenchmark(fullName.c_str(), function,
+                                     distribution, capacity);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Capacities are picked so that the smallest cache fits into L1 and the
+  // largest takes from 40 to 250 MB.
+  RegisterCaches<std::uint64_t, std::uint64_t>(
+      "int,int", {1 << 9, 1 << 13, 1 << 17, 1 << 19});
+  RegisterCaches<std::string, std::string>(
+      "string,string", {1 << 7, 1 << 12, 1 << 15, 1 << 18});
+  RegisterCaches<std::uint64_t, Blob>("int,blob1k",
+                                      {1 << 5, 1 << 10, 1 << 14, 1 << 18});
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
@@ -0,0 +1,328 @@
+#ifndef INCLUDE_ARCEVICTION_H_
+#define INCLUDE_ARCEVICTION_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "EvictionPolicies.h"
+#include "IntrusiveList.h"
+
+/**
+ * Bounded FIFO of key hashes with constant time lookup and removal, the
+ *     ghost list of an adaptive policy.  Only the 32-bit mixed hash of an
+ *     evicted key is kept, so a ghost costs a few bytes whatever the size of
+ *     the key and value; two keys with the same hash share a ghost.
+ *
+ * Hashes are kept in a ring in insertion order and indexed by an open
+ *     addressing table of ring positions.  A removed hash leaves a dead ring
+ *     slot behind, which is skipped when it becomes the oldest one.  Once the
+ *     ring is full, pushing a hash drops the oldest slot, so the memory used
+ *     is fixed at construction.
+ */
+class GhostList final {
+ public:
+  /**
+   * Construct a GhostList
+   * @param capacity maximum number of hashes
+   */
+  explicit GhostList(std::size_t capacity)
+      : ring(std::max<std::size_t>(capacity, 1)),
+        table(RoundUpToPowerOfTwo(2 * ring.size())),
+        mask(table.size() - 1) {}
+
+  /**
+   * @param hash mixed hash of a key
+   * @return true if the hash is in the list
+   */
+  bool Contains(std::uint32_t hash) const { return FindSlot(hash) != npos; }
+
+  /**
+   * Remove a hash.
+   * @param hash mixed hash of a key
+   * @return true if the hash was in the list
+   */
+  bool Erase(std::uint32_t hash) {
+    const std::size_t slot = FindSlot(hash);
+    if (slot == npos) return false;
+    EraseSlot(slot);
+    return true;
+  }
+
+  /**
+   * Add a hash as the newest one, dropping the oldest slot if the ring is
+   *     full.
+   * @param hash mixed hash of a key
+   */
+  void Push(std::uint32_t hash) {
+    // Only a moved-from list has no ring
+    if (ring.empty()) return;
+    Erase(hash);
+    if (tail - head == ring.size()) PopSlot();
+    const std::size_t position = tail++ % ring.size();
+    ring[position] = hash;
+    std::size_t slot = hash & mask;
+    while (table[slot] != Vacant) slot = (slot + 1) & mask;
+    table[slot] = static_cast<std::uint32_t>(position) + 1;
+    ++count;
+  }
+
+  /**
+   * Remove the oldest hash, if any.
+   */
+  void PopOldest() {
+    while (head != tail)
+      if (PopSlot()) return;
+  }
+
+  std::size_t Size() const { return count; }
+  bool Empty() const { return count == 0; }
+
+  /**
+   * @return bytes taken by the ring and the table, independent of Size()
+   */
+  std::size_t MemoryUsage() const {
+    return (ring.size() + table.size()) * sizeof(std::uint32_t);
+  }
+
+  void Clear() {
+    std::fill(table.begin(), table.end(), Vacant);
+    head = tail = 0;
+    count = 0;
+  }
+
+ private:
+  constexpr static std::size_t npos = static_cast<std::size_t>(-1);
+  // Table slots hold a ring position plus one
+  constexpr static std::uint32_t Vacant = 0;
+
+  static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+    std::size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+  }
+
+  std::size_t FindSlot(std::uint32_t hash) const {
+    if (table.empty()) return npos;
+    for (std::size_t slot = hash & mask; table[slot] != Vacant;
+         slot = (slot + 1) & mask) {
+      if (ring[table[slot] - 1] == hash) return slot;
+    }
+    return npos;
+  }
+
+  // Drop the oldest ring slot
+  // @return true if it held a live hash
+  bool PopSlot() {
+    const std::size_t position = head++ % ring.size();
+    for (std::size_t slot = ring[position] & mask; table[slot] != Vacant;
+         slot = (slot + 1) & mask) {
+      if (table[slot] == position + 1) {
+        EraseSlot(slot);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Backward shift deletion keeps every probe sequence free of holes
+  void EraseSlot(std::size_t slot) {
+    --count;
+    for (std::size_t next = (slot + 1) & mask; table[next] != Vacant;
+         next = (next + 1) & mask) {
+      const std::size_t home = ring[table[next] - 1] & mask;
+      // Move the entry back unless its home lies in (slot, next]
+      if (((next - home) & mask) >= ((next - slot) & mask)) {
+        table[slot] = table[next];
+        slot = next;
+      }
+    }
+    table[slot] = Vacant;
+  }
+
+  std::vector<std::uint32_t> ring;
+  std::vector<std::uint32_t> table;
+  std::size_t mask;
+  std::uint64_t head = 0;
+  std::uint64_t tail = 0;
+  std::size_t count = 0;
+};
+
+/**
+ * Adaptive Replacement Cache (Megiddo and Modha).  Entries seen once live in
+ *     a recency list T1, entries hit again in a frequency list T2, both LRU.
+ *     Evicted keys are remembered in the ghost lists B1 and B2 by hash only.
+ *     A new key found in B1 means T1 was too small, one found in B2 that T2
+ *     was, and the target size of T1 moves accordingly; the victim is taken
+ *     from T1 while it is above its target, from T2 otherwise.
+ *
+ * A scan of keys seen once only cycles through T1, so entries in T2 survive
+ *     it, while a workload of mostly new keys still gets the whole capacity
+ *     for T1.  Ghost hits enter T2 directly.
+ *
+ * The ghost lists hold at most capacity hashes each and at most twice the
+ *     capacity together with the entries, as in ARC; GhostCount() and
+ *     GhostMemoryUsage() report them.  The list of the map is left in
+ *     insertion order.
+ */
+struct ArcEviction {
+  template <class TNode>
+  class Policy {
+    enum class Segment : std::uint8_t { Recent, Frequent };
+
+   public:
+    struct Hook {
+      TNode* policyPrev = nullptr;
+      TNode* policyNext = nullptr;
+      Segment segment = Segment::Recent;
+    };
+
+    explicit Policy(std::size_t capacity)
+        : capacity(std::max<std::size_t>(capacity, 1)),
+          recentGhosts(this->capacity),
+          frequentGhosts(this->capacity) {}
+
+    void Inserted(TNode* node, IntrusiveList&) {
+      const std::uint32_t hash = node->hash;
+      const bool adapt = !(adapted && adaptedHash == hash);
+      bool ghost = true;
+      if (recentGhosts.Contains(hash)) {
+        if (adapt) GrowRecent();
+        recentGhosts.Erase(hash);
+      } else if (frequentGhosts.Contains(hash)) {
+        if (adapt) ShrinkRecent();
+        frequentGhosts.Erase(hash);
+      } else {
+        ghost = false;
+      }
+      adapted = false;
+
+      if (ghost) {
+        node->segment = Segment::Frequent;
+        frequent.PushFront(node);
+      } else {
+        node->segment = Segment::Recent;
+        recent.PushFront(node);
+      }
+      TrimGhosts();
+    }
+
+    void Accessed(TNode* node, IntrusiveList&) {
+      if (node->segment == Segment::Frequent) {
+        frequent.MoveToFront(node);
+      } else {
+        recent.Remove(node);
+        node->segment = Segment::Frequent;
+        frequent.PushFront(node);
+      }
+    }
+
+    TNode* Victim(std::uint32_t hash, IntrusiveList&) {
+      // Adapt to the incoming key before choosing, as ARC does, once even if
+      // a weighted map asks for several victims; Inserted() then only moves
+      // the key out of its ghost list
+      const bool frequentGhost = frequentGhosts.Contains(hash);
+      if (!(adapted && adaptedHash == hash)) {
+        if (recentGhosts.Contains(hash))
+          GrowRecent();
+        else if (frequentGhost)
+          ShrinkRecent();
+        adapted = true;
+        adaptedHash = hash;
+      }
+
+      const bool fromRecent =
+          !recent.Empty() &&
+          (frequent.Empty() || recent.Size() > target ||
+           (frequentGhost && recent.Size() == target));
+      victim = fromRecent ? recent.Back() : frequent.Back();
+      return victim;
+    }
+
+    void Removed(TNode* node, IntrusiveList&) {
+      const bool wasRecent = node->segment == Segment::Recent;
+      (wasRecent ? recent : frequent).Remove(node);
+      // Erased entries leave no ghost
+      if (node == victim) {
+        (wasRecent ? recentGhosts : frequentGhosts).Push(node->hash);
+        victim = nullptr;
+        TrimGhosts();
+      }
+    }
+
+    void Cleared() {
+      recent.Clear();
+      frequent.Clear();
+      recentGhosts.Clear();
+      frequentGhosts.Clear();
+      target = 0;
+      victim = nullptr;
+      adapted = false;
+    }
+
+    /**
+     * @return number of hashes in the ghost lists
+     */
+    std::size_t GhostCount() const {
+      return recentGhosts.Size() + frequentGhosts.Size();
+    }
+
+    /**
+     * @return bytes allocated for the ghost lists
+     */
+    std::size_t GhostMemoryUsage() const {
+      return recentGhosts.MemoryUsage() + frequentGhosts.MemoryUsage();
+    }
+
+    /**
+     * @return current target size of the recency list
+     */
+    std::size_t RecentTarget() const { return target; }
+
+   private:
+    void GrowRecent() {
+      const std::size_t step = std::max<std::size_t>(
+          1, frequentGhosts.Size() / std::max<std::size_t>(
+                                         1, recentGhosts.Size()));
+      target = std::min(capacity, target + step);
+    }
+
+    void ShrinkRecent() {
+      const std::size_t step = std::max<std::size_t>(
+          1, recentGhosts.Size() / std::max<std::size_t>(
+                                       1, frequentGhosts.Size()));
+      target -= std::min(target, step);
+    }
+
+    // |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c
+    void TrimGhosts() {
+      while (!recentGhosts.Empty() &&
+             recent.Size() + recentGhosts.Size() > capacity)
+        recentGhosts.PopOldest();
+      while (!frequentGhosts.Empty() && Total() > 2 * capacity)
+        frequentGhosts.PopOldest();
+      while (!recentGhosts.Empty() && Total() > 2 * capacity)
+        recentGhosts.PopOldest();
+    }
+
+    std::size_t Total() const {
+      return recent.Size() + frequent.Size() + GhostCount();
+    }
+
+    std::size_t capacity;
+    PolicyList<TNode> recent;
+    PolicyList<TNode> frequent;
+    GhostList recentGhosts;
+    GhostList frequentGhosts;
+    // Target size of the recency list
+    std::size_t target = 0;
+    // Picked by Victim() and about to be removed
+    TNode* victim = nullptr;
+    // Victim() adapted the target to the entry with adaptedHash
+    bool adapted = false;
+    std::uint32_t adaptedHash = 0;
+  };
+};
+
+#endif  // INCLUDE_ARCEVICTION_H_
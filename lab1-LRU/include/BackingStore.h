@@ -0,0 +1,190 @@
+#ifndef INCLUDE_BACKINGSTORE_H_
+#define INCLUDE_BACKINGSTORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Storage behind a WriteBackCache.  Writes come in batches in which every
+ *     key appears at most once, so a store can turn a batch into a single
+ *     I/O request.  Errors are reported by throwing.
+ */
+template <class TKey, class TValue>
+class BackingStore {
+ public:
+  using Batch = std::vector<std::pair<TKey, TValue>>;
+
+  virtual ~BackingStore() = default;
+
+  /**
+   * @return the stored value of a key, nothing if there is none
+   */
+  virtual std::optional<TValue> Read(const TKey& key) = 0;
+
+  /**
+   * Store a batch of entries, replacing the values of keys already stored.
+   *     Either all entries are written or an exception is thrown.
+   */
+  virtual void Write(const Batch& batch) = 0;
+
+  /**
+   * Remove a key, if it is stored.
+   */
+  virtual void Remove(const TKey& key) = 0;
+};
+
+/**
+ * BackingStore keeping trivially copyable keys and values in a log file.
+ *     Every batch is appended with a single write, a removal appends a
+ *     tombstone, and an index in memory points to the latest record of every
+ *     key.  The log is replayed when the store is opened and never compacted,
+ *     which is enough for tests and benchmarks but not for a long-lived
+ *     store.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>>
+class FileBackingStore final : public BackingStore<TKey, TValue> {
+  static_assert(std::is_trivially_copyable_v<TKey> &&
+                    std::is_trivially_copyable_v<TValue>,
+                "FileBackingStore stores keys and values as raw bytes");
+
+ public:
+  using Batch = typename BackingStore<TKey, TValue>::Batch;
+
+  /**
+   * Open a store, creating its file if it does not exist.
+   * @param path path of the log file
+   */
+  explicit FileBackingStore(const std::string& path) {
+    // Create the file without truncating it, then open it for both
+    std::ofstream(path, std::ios::binary | std::ios::app);
+    file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) throw std::runtime_error("Unable to open " + path);
+    Replay();
+  }
+
+  std::optional<TValue> Read(const TKey& key) override {
+    auto found = offsets.find(key);
+    if (found == offsets.end()) return {};
+    char record[RecordSize];
+    file.seekg(static_cast<std::streamoff>(found->second));
+    if (!file.read(record, RecordSize))
+      throw std::runtime_error("Unable to read record");
+    ++reads;
+    TValue value;
+    std::memcpy(&value, record + 1 + sizeof(TKey), sizeof(TValue));
+    return value;
+  }
+
+  void Write(const Batch& batch) override {
+    if (batch.empty()) return;
+    std::vector<char> buffer(batch.size() * RecordSize);
+    char* record = buffer.data();
+    for (const auto& entry : batch) {
+      Encode(record, Live, entry.first, &entry.second);
+      record += RecordSize;
+    }
+    const std::uint64_t start = Append(buffer);
+    for (std::size_t i = 0; i < batch.size(); ++i)
+      offsets.insert_or_assign(batch[i].first, start + i * RecordSize);
+    ++batches;
+    records += batch.size();
+  }
+
+  void Remove(const TKey& key) override {
+    if (offsets.find(key) == offsets.end()) return;
+    std::vector<char> buffer(RecordSize);
+    Encode(buffer.data(), Tombstone, key, nullptr);
+    Append(buffer);
+    offsets.erase(key);
+  }
+
+  /**
+   * @return number of keys stored
+   */
+  std::size_t Size() const { return offsets.size(); }
+
+  /**
+   * @return number of Write() calls, i.e. of write requests to the file
+   */
+  std::size_t Batches() const { return batches; }
+
+  /**
+   * @return number of entries written by all batches
+   */
+  std::size_t Records() const { return records; }
+
+  /**
+   * @return number of values read from the file
+   */
+  std::size_t Reads() const { return reads; }
+
+ private:
+  // A record is a marker byte followed by the key and the value
+  constexpr static std::size_t RecordSize = 1 + sizeof(TKey) + sizeof(TValue);
+  constexpr static char Live = 1;
+  constexpr static char Tombstone = 0;
+
+  static void Encode(char* record, char marker, const TKey& key,
+                     const TValue* value) {
+    record[0] = marker;
+    std::memcpy(record + 1, &key, sizeof(TKey));
+    if (value)
+      std::memcpy(record + 1 + sizeof(TKey), value, sizeof(TValue));
+    else
+      std::memset(record + 1 + sizeof(TKey), 0, sizeof(TValue));
+  }
+
+  // Write after the last complete record, over a torn one if there is any
+  // @return offset of the appended bytes
+  std::uint64_t Append(const std::vector<char>& buffer) {
+    const std::uint64_t start = end;
+    file.seekp(static_cast<std::streamoff>(start));
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.flush();
+    if (!file) {
+      file.clear();
+      throw std::runtime_error("Unable to write records");
+    }
+    end += buffer.size();
+    return start;
+  }
+
+  // Rebuild the index from the log, ignoring a torn record at its end
+  void Replay() {
+    char record[RecordSize];
+    std::uint64_t offset = 0;
+    file.seekg(0);
+    while (file.read(record, RecordSize)) {
+      TKey key;
+      std::memcpy(&key, record + 1, sizeof(TKey));
+      if (record[0] == Live)
+        offsets.insert_or_assign(key, offset);
+      else
+        offsets.erase(key);
+      offset += RecordSize;
+    }
+    file.clear();
+    end = offset;
+  }
+
+  std::fstream file;
+  std::unordered_map<TKey, std::uint64_t, THash, TKeyEqual> offsets;
+  // Offset past the last complete record
+  std::uint64_t end = 0;
+  std::size_t batches = 0;
+  std::size_t records = 0;
+  std::size_t reads = 0;
+};
+
+#endif  // INCLUDE_BACKINGSTORE_H_
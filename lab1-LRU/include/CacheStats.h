@@ -0,0 +1,482 @@
+#ifndef INCLUDE_CACHESTATS_H_
+#define INCLUDE_CACHESTATS_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/*
+  Statistics modes for EvictingCacheMap.
+
+  With NoStats, the default, the map keeps no statistics and the code which
+    would record them is not compiled in.  The other modes count hits,
+    misses, inserts, updates, evictions and rehashes into a CacheStats
+    recorder, and RecordStats also measures the latency of get(), find(),
+    put() and erase() with TClock.
+
+  A recorder may be shared by several maps, e.g. by all shards of a
+    ShardedEvictingCacheMap, and read by any thread while they are in use.
+*/
+
+/**
+ * No statistics are kept.
+ */
+struct NoStats {
+  constexpr static bool RecordsLatency = false;
+};
+
+/**
+ * Count events only, no clock is read.
+ */
+struct CountStats {
+  constexpr static bool RecordsLatency = false;
+};
+
+/**
+ * Count events and measure operation latencies.  Reading a clock may cost
+ *     as much as a lookup, so only every SamplePeriod-th operation is
+ *     measured and recorded as SamplePeriod operations of that latency.
+ */
+template <class TClock = std::chrono::steady_clock,
+          unsigned SamplePeriod = 1>
+struct RecordStats {
+  static_assert(SamplePeriod > 0, "SamplePeriod must be positive");
+  using Clock = TClock;
+  constexpr static bool RecordsLatency = true;
+  constexpr static unsigned Period = SamplePeriod;
+};
+
+/**
+ * Histogram of latencies in nanoseconds with a bounded relative error, in the
+ *     manner of HdrHistogram: values below 8 have a bucket each, above that
+ *     every power of two is split into eight buckets, so a value is known
+ *     within 12.5%.  Values of 2^40 ns (about 18 minutes) or more share the
+ *     last bucket.
+ */
+class LatencyHistogram final {
+ public:
+  constexpr static unsigned SubBits = 3;
+  constexpr static unsigned MaxExponent = 40;
+  constexpr static std::size_t Buckets = (MaxExponent - SubBits + 1)
+                                         << SubBits;
+
+  void Record(std::uint64_t value, std::uint64_t count = 1) {
+    counts[BucketOf(value)] += count;
+    total += count;
+    sum += value * count;
+  }
+
+  /**
+   * Add the values of another histogram to this one.
+   */
+  LatencyHistogram& Merge(const LatencyHistogram& other) {
+    for (std::size_t bucket = 0; bucket < Buckets; ++bucket)
+      counts[bucket] += other.counts[bucket];
+    total += other.total;
+    sum += other.sum;
+    return *this;
+  }
+
+  /**
+   * @return number of recorded values
+   */
+  std::uint64_t Count() const { return total; }
+
+  /**
+   * @return sum of the recorded values
+   */
+  std::uint64_t Sum() const { return sum; }
+
+  /**
+   * @param bucket index below Buckets
+   * @return number of values recorded in the bucket
+   */
+  std::uint64_t CountAt(std::size_t bucket) const { return counts[bucket]; }
+
+  /**
+   * Get a percentile.
+   * @param fraction percentile as a fraction in [0, 1], e.g. 0.99
+   * @return the largest value which falls into the same bucket as the
+   *     percentile, 0 if nothing was recorded
+   */
+  std::uint64_t Percentile(double fraction) const {
+    if (total == 0) return 0;
+    const double clamped = std::min(std::max(fraction, 0.0), 1.0);
+    const auto rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(clamped * static_cast<double>(total) +
+                                      0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < Buckets; ++bucket) {
+      seen += counts[bucket];
+      if (seen >= rank) return LowerBound(bucket + 1) - 1;
+    }
+    return LowerBound(Buckets) - 1;
+  }
+
+  /**
+   * @return index of the bucket a value is recorded in
+   */
+  static std::size_t BucketOf(std::uint64_t value) {
+    if (value < (1u << SubBits)) return static_cast<std::size_t>(value);
+    unsigned exponent = 0;
+    for (unsigned step = 32; step > 0; step /= 2)
+      if (value >> (exponent + step)) exponent += step;
+    const std::uint64_t sub =
+        (value >> (exponent - SubBits)) & ((1u << SubBits) - 1);
+    return std::min<std::size_t>(
+        ((exponent - SubBits + 1) << SubBits) + sub, Buckets - 1);
+  }
+
+  /**
+   * @return smallest value recorded in a bucket, or for Buckets the first
+   *     value past the last regular bucket
+   */
+  static std::uint64_t LowerBound(std::size_t bucket) {
+    if (bucket < (1u << SubBits)) return bucket;
+    const unsigned exponent =
+        static_cast<unsigned>(bucket >> SubBits) + SubBits - 1;
+    const std::uint64_t sub = bucket & ((1u << SubBits) - 1);
+    return (std::uint64_t(1) << exponent) + (sub << (exponent - SubBits));
+  }
+
+ private:
+  // Fills snapshots in directly
+  friend class CacheStats;
+
+  std::array<std::uint64_t, Buckets> counts{};
+  std::uint64_t total = 0;
+  std::uint64_t sum = 0;
+};
+
+/**
+ * Statistics of one or more maps at some point in time.
+ */
+struct CacheStatsSnapshot {
+  // Lookups by find(), get() and multiGet() which found an entry
+  std::uint64_t hits = 0;
+  // Lookups which did not, including ones which found an expired entry
+  std::uint64_t misses = 0;
+  // put() of new keys
+  std::uint64_t inserts = 0;
+  // put() of keys which were present already
+  std::uint64_t updates = 0;
+  // Entries removed to make room or rejected as heavier than the capacity,
+  // as reported with RemovalCause::Capacity; expired entries are not counted
+  std::uint64_t evictions = 0;
+  // Times the index started to grow
+  std::uint64_t rehashes = 0;
+  // Latencies in nanoseconds, empty unless measured
+  LatencyHistogram getLatency;
+  LatencyHistogram putLatency;
+  LatencyHistogram eraseLatency;
+
+  /**
+   * Add the statistics of another map, e.g. to sum up several caches.
+   */
+  CacheStatsSnapshot& Merge(const CacheStatsSnapshot& other) {
+    hits += other.hits;
+    misses += other.misses;
+    inserts += other.inserts;
+    updates += other.updates;
+    evictions += other.evictions;
+    rehashes += other.rehashes;
+    getLatency.Merge(other.getLatency);
+    putLatency.Merge(other.putLatency);
+    eraseLatency.Merge(other.eraseLatency);
+    return *this;
+  }
+
+  /**
+   * @return fraction of lookups which hit, 0 if there were none
+   */
+  double HitRatio() const {
+    const std::uint64_t lookups = hits + misses;
+    return lookups == 0 ? 0.0
+                        : static_cast<double>(hits) /
+                              static_cast<double>(lookups);
+  }
+};
+
+/**
+ * Recorder of cache statistics which any number of threads may update and
+ *     read at the same time.  Every thread writes to a stripe of its own,
+ *     aligned to a cache line, so threads recording into the same recorder do
+ *     not contend; a snapshot sums up all stripes.  Threads are assigned
+ *     stripes round-robin on their first use of any recorder, threads beyond
+ *     the number of stripes share them.
+ *
+ * Snapshots are not atomic as a whole: counters updated during a snapshot
+ *     may be included or not, each one individually.
+ */
+class CacheStats final {
+ public:
+  enum class Counter { Hits, Misses, Inserts, Updates, Evictions, Rehashes };
+  enum class Operation { Get, Put, Erase };
+
+  /**
+   * Measures the time from its construction to its destruction and records
+   *     it as the latency of an operation.  Does nothing if constructed
+   *     without a recorder.
+   */
+  template <class TClock>
+  class Stopwatch final {
+   public:
+    Stopwatch(CacheStats* stats, Operation operation, std::uint64_t weight)
+        : stats(stats), operation(operation), weight(weight) {
+      if (stats) start = TClock::now();
+    }
+    Stopwatch(const Stopwatch&) = delete;
+    Stopwatch& operator=(const Stopwatch&) = delete;
+
+    ~Stopwatch() {
+      if (!stats) return;
+      const auto elapsed = std::chrono::duration_cast<
+          std::chrono::nanoseconds>(TClock::now() - start);
+      stats->Record(operation,
+                    static_cast<std::uint64_t>(
+                        std::max<std::int64_t>(elapsed.count(), 0)),
+                    weight);
+    }
+
+   private:
+    CacheStats* stats;
+    Operation operation;
+    std::uint64_t weight;
+    typename TClock::time_point start;
+  };
+
+  /**
+   * Construct a CacheStats
+   * @param recordLatency true to allocate latency histograms
+   * @param stripes number of stripes, rounded up to a power of two
+   */
+  explicit CacheStats(bool recordLatency = true,
+                      std::size_t stripes = DefaultStripes()) {
+    std::size_t count = 1;
+    while (count < stripes) count <<= 1;
+    stripeMask = count - 1;
+    counters = std::make_unique<CounterStripe[]>(count);
+    if (recordLatency)
+      latencies = std::make_unique<LatencyStripe[]>(count);
+  }
+
+  void Add(Counter counter, std::uint64_t count = 1) {
+    counters[ThreadIndex() & stripeMask]
+        .values[static_cast<std::size_t>(counter)]
+        .fetch_add(count, std::memory_order_relaxed);
+  }
+
+  /**
+   * Record the latency of an operation, ignored if the recorder was
+   *     constructed without latency histograms.
+   * @param nanoseconds latency
+   * @param count number of operations which took that long
+   */
+  void Record(Operation operation, std::uint64_t nanoseconds,
+              std::uint64_t count = 1) {
+    if (!latencies) return;
+    LatencyStripe& stripe = latencies[ThreadIndex() & stripeMask];
+    auto& histogram = stripe.histograms[static_cast<std::size_t>(operation)];
+    histogram.counts[LatencyHistogram::BucketOf(nanoseconds)].fetch_add(
+        count, std::memory_order_relaxed);
+    histogram.sum.fetch_add(nanoseconds * count, std::memory_order_relaxed);
+  }
+
+  CacheStatsSnapshot Snapshot() const {
+    std::array<std::uint64_t, CounterCount> sums{};
+    for (std::size_t i = 0; i <= stripeMask; ++i)
+      for (std::size_t counter = 0; counter < CounterCount; ++counter)
+        sums[counter] +=
+            counters[i].values[counter].load(std::memory_order_relaxed);
+
+    CacheStatsSnapshot snapshot;
+    snapshot.hits = sums[static_cast<std::size_t>(Counter::Hits)];
+    snapshot.misses = sums[static_cast<std::size_t>(Counter::Misses)];
+    snapshot.inserts = sums[static_cast<std::size_t>(Counter::Inserts)];
+    snapshot.updates = sums[static_cast<std::size_t>(Counter::Updates)];
+    snapshot.evictions = sums[static_cast<std::size_t>(Counter::Evictions)];
+    snapshot.rehashes = sums[static_cast<std::size_t>(Counter::Rehashes)];
+    if (latencies) {
+      Collect(Operation::Get, snapshot.getLatency);
+      Collect(Operation::Put, snapshot.putLatency);
+      Collect(Operation::Erase, snapshot.eraseLatency);
+    }
+    return snapshot;
+  }
+
+  /**
+   * Zero all statistics.  Updates made by other threads at the same time may
+   *     survive or be lost.
+   */
+  void Reset() {
+    for (std::size_t i = 0; i <= stripeMask; ++i) {
+      for (auto& value : counters[i].values)
+        value.store(0, std::memory_order_relaxed);
+      if (!latencies) continue;
+      for (auto& histogram : latencies[i].histograms) {
+        for (auto& count : histogram.counts)
+          count.store(0, std::memory_order_relaxed);
+        histogram.sum.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @return number of stripes, a power of two
+   */
+  std::size_t Stripes() const { return stripeMask + 1; }
+
+  /**
+   * @return true if latencies are recorded
+   */
+  bool RecordsLatency() const { return latencies != nullptr; }
+
+  static std::size_t DefaultStripes() {
+    return std::min<std::size_t>(
+        std::max(1u, std::thread::hardware_concurrency()), MaxStripes);
+  }
+
+ private:
+  constexpr static std::size_t CacheLineSize = 64;
+  constexpr static std::size_t MaxStripes = 64;
+  constexpr static std::size_t CounterCount = 6;
+  constexpr static std::size_t OperationCount = 3;
+
+  struct alignas(CacheLineSize) CounterStripe {
+    std::array<std::atomic<std::uint64_t>, CounterCount> values{};
+  };
+
+  struct AtomicHistogram {
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::Buckets>
+        counts{};
+    std::atomic<std::uint64_t> sum{0};
+  };
+
+  struct alignas(CacheLineSize) LatencyStripe {
+    std::array<AtomicHistogram, OperationCount> histograms{};
+  };
+
+  // Index of the calling thread, assigned on its first call.  The
+  // thread_local is constant-initialized, which spares every call the check
+  // of a dynamic initializer.
+  static std::size_t ThreadIndex() {
+    constexpr std::size_t Unassigned = ~std::size_t(0);
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t index = Unassigned;
+    if (index == Unassigned)
+      index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+
+  void Collect(Operation operation, LatencyHistogram& result) const {
+    const auto which = static_cast<std::size_t>(operation);
+    for (std::size_t i = 0; i <= stripeMask; ++i) {
+      const AtomicHistogram& histogram = latencies[i].histograms[which];
+      for (std::size_t bucket = 0; bucket < LatencyHistogram::Buckets;
+           ++bucket) {
+        const std::uint64_t count =
+            histogram.counts[bucket].load(std::memory_order_relaxed);
+        result.counts[bucket] += count;
+        result.total += count;
+      }
+      result.sum += histogram.sum.load(std::memory_order_relaxed);
+    }
+  }
+
+  std::size_t stripeMask;
+  std::unique_ptr<CounterStripe[]> counters;
+  std::unique_ptr<LatencyStripe[]> latencies;
+};
+
+namespace detail {
+
+inline void WritePrometheusCounter(std::ostream& out, std::string_view prefix,
+                                   std::string_view name,
+                                   std::string_view help,
+                                   std::uint64_t value) {
+  out << "# HELP " << prefix << '_' << name << "_total " << help << '\n'
+      << "# TYPE " << prefix << '_' << name << "_total counter\n"
+      << prefix << '_' << name << "_total " << value << '\n';
+}
+
+// Buckets of a Prometheus histogram end at powers of two nanoseconds, which
+// are also bucket bounds of LatencyHistogram
+inline void WritePrometheusHistogram(std::ostream& out,
+                                     std::string_view metric,
+                                     std::string_view operation,
+                                     const LatencyHistogram& histogram) {
+  constexpr unsigned FirstExponent = 4;
+  constexpr unsigned LastExponent = 34;
+  std::size_t bucket = 0;
+  std::uint64_t cumulative = 0;
+  for (unsigned exponent = FirstExponent; exponent <= LastExponent;
+       ++exponent) {
+    const std::uint64_t bound = std::uint64_t(1) << exponent;
+    for (; LatencyHistogram::LowerBound(bucket) < bound; ++bucket)
+      cumulative += histogram.CountAt(bucket);
+    out << metric << "_bucket{op=\"" << operation << "\",le=\""
+        << static_cast<double>(bound) * 1e-9 << "\"} " << cumulative << '\n';
+  }
+  out << metric << "_bucket{op=\"" << operation << "\",le=\"+Inf\"} "
+      << histogram.Count() << '\n'
+      << metric << "_sum{op=\"" << operation << "\"} "
+      << static_cast<double>(histogram.Sum()) * 1e-9 << '\n'
+      << metric << "_count{op=\"" << operation << "\"} " << histogram.Count()
+      << '\n';
+}
+
+}  // namespace detail
+
+/**
+ * Write statistics in the Prometheus text exposition format: a counter per
+ *     event and, if latencies were measured, one histogram in seconds
+ *     labelled by operation.
+ * @param out stream to write to
+ * @param stats statistics to export
+ * @param prefix prefix of all metric names
+ */
+inline void WritePrometheus(std::ostream& out, const CacheStatsSnapshot& stats,
+                            std::string_view prefix = "cache") {
+  detail::WritePrometheusCounter(out, prefix, "hits",
+                                 "Lookups which found an entry.", stats.hits);
+  detail::WritePrometheusCounter(out, prefix, "misses",
+                                 "Lookups which found no entry.",
+                                 stats.misses);
+  detail::WritePrometheusCounter(out, prefix, "inserts",
+                                 "Entries put under a new key.",
+                                 stats.inserts);
+  detail::WritePrometheusCounter(out, prefix, "updates",
+                                 "Entries put under a present key.",
+                                 stats.updates);
+  detail::WritePrometheusCounter(out, prefix, "evictions",
+                                 "Entries evicted to make room.",
+                                 stats.evictions);
+  detail::WritePrometheusCounter(out, prefix, "rehashes",
+                                 "Times the index grew.", stats.rehashes);
+
+  const LatencyHistogram* histograms[] = {
+      &stats.getLatency, &stats.putLatency, &stats.eraseLatency};
+  const char* operations[] = {"get", "put", "erase"};
+  bool any = false;
+  for (const LatencyHistogram* histogram : histograms)
+    any = any || histogram->Count() > 0;
+  if (!any) return;
+
+  std::string metric(prefix);
+  metric += "_operation_duration_seconds";
+  out << "# HELP " << metric << " Latency of cache operations.\n"
+      << "# TYPE " << metric << " histogram\n";
+  for (std::size_t i = 0; i < 3; ++i)
+    detail::WritePrometheusHistogram(out, metric, operations[i],
+                                     *histograms[i]);
+}
+
+#endif  // INCLUDE_CACHESTATS_H_
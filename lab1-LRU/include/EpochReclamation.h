@@ -0,0 +1,131 @@
+#ifndef INCLUDE_EPOCHRECLAMATION_H_
+#define INCLUDE_EPOCHRECLAMATION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Epoch-based reclamation of memory read by lock-free readers.
+ *
+ * A reader pins the calling thread for the duration of a read by publishing
+ *     the current global epoch in a record of its own; that is one load and
+ *     one store, so reads stay wait-free.  A writer which unlinked an object
+ *     retires it by advancing the global epoch: readers pinned afterwards can
+ *     not reach it any more, so it may be freed once every pinned thread has
+ *     published a later epoch.  Writers keep their retired objects and free
+ *     them by comparing with MinPinned().
+ *
+ * Readers must load and writers must unlink shared pointers with sequentially
+ *     consistent operations: a writer which finds a thread idle then knows
+ *     that its later reads come after the unlink in the single total order.
+ *     Such loads are plain loads on x86 and ARM, and fences are avoided so
+ *     that ThreadSanitizer understands the protocol.
+ *
+ * Thread records are shared by all users in the process, allocated on the
+ *     first Guard of a thread and reused after the thread exits.
+ */
+class EpochReclamation final {
+  struct Record;
+
+ public:
+  /**
+   * Keeps the calling thread pinned while alive.  Guards may be nested.
+   */
+  class Guard {
+   public:
+    Guard() : record(Acquire()) {
+      if (record->depth++ == 0) {
+        record->epoch.store(epoch.load(std::memory_order_seq_cst),
+                            std::memory_order_seq_cst);
+      }
+    }
+
+    ~Guard() {
+      if (--record->depth == 0)
+        record->epoch.store(Idle, std::memory_order_release);
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    Record* record;
+  };
+
+  /**
+   * Advance the global epoch after unlinking an object.
+   * @return the epoch to retire the object at
+   */
+  static std::uint64_t Advance() {
+    return epoch.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  /**
+   * @return the smallest epoch a thread is pinned at; objects retired at
+   *     smaller epochs can not be reached by any reader
+   */
+  static std::uint64_t MinPinned() {
+    std::uint64_t result = Idle;
+    for (Record* record = records.load(std::memory_order_acquire); record;
+         record = record->next) {
+      const std::uint64_t pinned =
+          record->epoch.load(std::memory_order_seq_cst);
+      if (pinned < result) result = pinned;
+    }
+    return result;
+  }
+
+ private:
+  constexpr static std::uint64_t Idle =
+      std::numeric_limits<std::uint64_t>::max();
+
+  struct Record {
+    std::atomic<std::uint64_t> epoch{Idle};
+    std::atomic<bool> used{true};
+    // Only touched by the owning thread
+    unsigned depth = 0;
+    Record* next = nullptr;
+  };
+
+  // Returns the record of the thread to the free ones on thread exit
+  struct Owner {
+    ~Owner() {
+      if (record) record->used.store(false, std::memory_order_release);
+    }
+
+    Record* record = nullptr;
+  };
+
+  static Record* Acquire() {
+    thread_local Owner owner;
+    if (owner.record) return owner.record;
+
+    for (Record* record = records.load(std::memory_order_acquire); record;
+         record = record->next) {
+      bool used = false;
+      if (!record->used.load(std::memory_order_relaxed) &&
+          record->used.compare_exchange_strong(used, true,
+                                               std::memory_order_acquire)) {
+        owner.record = record;
+        return record;
+      }
+    }
+
+    // Records are never freed, so readers and writers may walk the list
+    // without synchronization beyond the push
+    Record* record = new Record;
+    record->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(record->next, record,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+    owner.record = record;
+    return record;
+  }
+
+  static inline std::atomic<std::uint64_t> epoch{0};
+  static inline std::atomic<Record*> records{nullptr};
+};
+
+#endif  // INCLUDE_EPOCHRECLAMATION_H_
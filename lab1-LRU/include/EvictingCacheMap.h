@@ -2,216 +2,1274 @@
 #define INCLUDE_EVICTINGCACHEMAP_H_
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <optional>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
-#include <vector>
 
-template <class TKey, class TValue, class THash = std::hash<TKey>>
+#include "CacheStats.h"
+#include "EvictionPolicies.h"
+#include "Expiration.h"
+#include "IntrusiveList.h"
+#include "MissRatioCurve.h"
+#include "NodeSlab.h"
+#include "RobinHoodIndex.h"
+#include "TimerWheel.h"
+
+namespace detail {
+// Reads and writes snapshots of the map, see Snapshot.h
+struct SnapshotAccess;
+}  // namespace detail
+
+/**
+ * True if T declares `is_transparent`, the marker for hash functions and key
+ *     comparisons which accept types other than the key type.
+ */
+template <class T, class = void>
+struct IsTransparent : std::false_type {};
+template <class T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>>
+    : std::true_type {};
+
+/**
+ * Default weigher of EvictingCacheMap: every entry weighs 1, so the capacity
+ *     is the maximum number of entries.
+ */
+struct UnitWeigher {
+  template <class TKey, class TValue>
+  std::size_t operator()(const TKey&, const TValue&) const {
+    return 1;
+  }
+};
+
+/**
+ * Why an entry left an EvictingCacheMap, as reported to its removal listener.
+ */
+enum class RemovalCause {
+  // Evicted to make room, or heavier than the whole capacity
+  Capacity,
+  // Removed by erase()
+  Erased,
+  // The value was overwritten by put()
+  Replaced,
+  // The time-to-live passed
+  Expired,
+  // Removed by clear()
+  Cleared
+};
+
+/**
+ * Cache with a fixed capacity.  Entries are kept in an intrusive doubly
+ *     linked list and indexed by an open-addressing hash table.  Which entry
+ *     is evicted once the map is full is decided by TEvictionPolicy (see
+ *     EvictionPolicies.h); with the default LruEviction the list is ordered
+ *     from the most to the least recently used entry.
+ *
+ * List nodes come from a slab owned by the map: an evicted node is reused for
+ *     the entry that displaced it and erased nodes are recycled, so once the
+ *     map has been filled up to its capacity no operation allocates memory.
+ *     All memory, including the index, is obtained through TAllocator.
+ *
+ * Keys are compared with TKeyEqual.  If both THash and TKeyEqual are
+ *     transparent, find(), get(), exists() and erase() accept any type they
+ *     can hash and compare, e.g. a std::string_view for std::string keys,
+ *     without constructing a TKey.
+ *
+ * TWeigher maps an entry to its cost, `std::size_t(const TKey&, const
+ *     TValue&)`.  The capacity bounds the total weight of all entries, and
+ *     put() evicts entries until the new one fits.  With the default
+ *     UnitWeigher the capacity is simply the maximum number of entries and no
+ *     weight is stored per entry.
+ *
+ * TExpiration enables per-entry time-to-live (see Expiration.h).  Expired
+ *     entries are invisible to find(), get() and exists() right away, but
+ *     keep counting towards size() and show up in iteration until they are
+ *     reclaimed by the next put(), find() or cleanUp().
+ *
+ * trackMissRatioCurve() makes lookups feed a sampled estimate of the LRU
+ *     miss ratio at other capacities (see MissRatioCurve.h).  The tracker is
+ *     allocated separately with the default allocator and is not copied
+ *     along with the entries.
+ *
+ * TStats selects which statistics are kept (see CacheStats.h).  The default
+ *     NoStats keeps none and compiles to nothing; with CountStats or
+ *     RecordStats, stats() returns counters of hits, misses, inserts,
+ *     updates, evictions and rehashes, and RecordStats adds latency
+ *     histograms of get()/find(), put() and erase().
+ *
+ * setRemovalListener() registers a function which is handed every entry that
+ *     leaves the map, together with the cause, e.g. to write dirty values
+ *     back or release resources they hold.
+ *
+ * SaveSnapshot() and LoadSnapshot() in Snapshot.h write the entries to a
+ *     snapshot file in recency order and restore them, so a restarted
+ *     process starts with a warm cache.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>,
+          class TEvictionPolicy = LruEviction,
+          class TAllocator = std::allocator<std::pair<const TKey, TValue>>,
+          class TWeigher = UnitWeigher, class TExpiration = NoExpiration,
+          class TStats = NoStats>
 class EvictingCacheMap final {
-  using PairsList = std::list<std::pair<const TKey, TValue>>;
-  using IteratorsList = std::list<typename PairsList::iterator>;
-  using HashTable = std::vector<IteratorsList>;
+ public:
+  using key_type = TKey;
+  using mapped_type = TValue;
+  using value_type = std::pair<const TKey, TValue>;
+  using allocator_type = TAllocator;
+  // The key stays const inside the map, so only the value is handed over
+  using RemovalListener =
+      std::function<void(const TKey&, TValue&&, RemovalCause)>;
+
+ private:
+  friend struct detail::SnapshotAccess;
+
+  constexpr static bool IsTransparentLookup =
+      IsTransparent<THash>::value && IsTransparent<TKeyEqual>::value;
+
+  // Enables the heterogeneous overloads of the lookup functions
+  template <class K>
+  using IfTransparent =
+      std::enable_if_t<IsTransparentLookup && !std::is_same_v<K, TKey>>;
+
+  struct Node;
+  using NodeBase = IntrusiveList::Link;
+  using Policy = typename TEvictionPolicy::template Policy<Node>;
+
+  constexpr static bool IsWeighted = !std::is_same_v<TWeigher, UnitWeigher>;
+
+  struct Weight {
+    std::size_t weight = 0;
+  };
+  struct NoWeight {};
+
+  constexpr static bool IsExpiring =
+      !std::is_same_v<TExpiration, NoExpiration>;
+
+  using Wheel = TimerWheel<TAllocator>;
+  struct Expiry : Wheel::Timer {
+    // Time-to-live in nanoseconds, NoTtl if the entry does not expire
+    std::uint64_t ttl = NoTtl;
+  };
+  struct NoExpiry {};
+  struct NoWheel {
+    explicit NoWheel(const TAllocator&) {}
+  };
+
+  constexpr static bool IsRecording = !std::is_same_v<TStats, NoStats>;
+  constexpr static bool IsTiming = TStats::RecordsLatency;
+  struct NoRecorder {};
+  struct NoStopwatch {};
+
+  struct Node : NodeBase,
+                Policy::Hook,
+                std::conditional_t<IsWeighted, Weight, NoWeight>,
+                std::conditional_t<IsExpiring, Expiry, NoExpiry> {
+    void* Storage() { return storage; }
+    value_type* Value() {
+      return std::launder(reinterpret_cast<value_type*>(storage));
+    }
+    const value_type* Value() const {
+      return std::launder(reinterpret_cast<const value_type*>(storage));
+    }
+
+    std::uint32_t hash = 0;
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+  };
+
+  using ValueTraits = std::allocator_traits<TAllocator>;
+  using Slab = NodeSlab<Node, TAllocator>;
+  using Index = RobinHoodIndex<Node*, TAllocator>;
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = EvictingCacheMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+    using reference =
+        std::conditional_t<IsConst, const value_type&, value_type&>;
+
+    Iterator() = default;
+
+    template <bool WasConst, class = std::enable_if_t<IsConst && !WasConst>>
+    Iterator(const Iterator<WasConst>& other) : node(other.node) {}
+
+    reference operator*() const { return *static_cast<Node*>(node)->Value(); }
+    pointer operator->() const { return static_cast<Node*>(node)->Value(); }
+
+    Iterator& operator++() {
+      node = node->next;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator result = *this;
+      node = node->next;
+      return result;
+    }
+    Iterator& operator--() {
+      node = node->prev;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator result = *this;
+      node = node->prev;
+      return result;
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.node == rhs.node;
+    }
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.node != rhs.node;
+    }
+
+   private:
+    friend class EvictingCacheMap;
+    template <bool>
+    friend class Iterator;
+
+    explicit Iterator(NodeBase* node) : node(node) {}
+
+    NodeBase* node = nullptr;
+  };
 
  public:
-  using iterator = typename PairsList::iterator;
-  using const_iterator = typename PairsList::const_iterator;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
   /**
    * Construct a EvictingCacheMap
    * @param capacity maximum size of the cache map.  Once the map size exceeds
-   *    maxSize, the map will begin to evict.
+   *    maxSize, the map will begin to evict.  For a weighted map this is the
+   *    maximum total weight.
+   * @param allocator allocator used for entries and the index
    */
-  explicit EvictingCacheMap(std::size_t capacity) : capacity(capacity) {
+  explicit EvictingCacheMap(std::size_t capacity,
+                            const TAllocator& allocator = TAllocator())
+      : EvictingCacheMap(capacity, capacity, TWeigher(), allocator) {}
+
+  /**
+   * Construct a weighted EvictingCacheMap
+   * @param maxWeight maximum total weight of the entries
+   * @param expectedSize expected number of entries, used to size the state of
+   *     the eviction policy (e.g. the frequency sketch of WTinyLfuEviction)
+   * @param weigher function computing the weight of an entry
+   * @param allocator allocator used for entries and the index
+   */
+  EvictingCacheMap(std::size_t maxWeight, std::size_t expectedSize,
+                   const TWeigher& weigher,
+                   const TAllocator& allocator = TAllocator())
+      : allocator(allocator),
+        slab(MaxEntries(maxWeight), allocator),
+        index(0, allocator),
+        policy(expectedSize),
+        wheel(allocator),
+        weigher(weigher),
+        capacity(maxWeight),
+        expectedSize(expectedSize),
+        recorder(MakeRecorder()) {
     if (capacity == 0)
       throw std::logic_error("Unable to create cache of size 0");
 
-    const std::size_t initialTableSize = 4;
-    hashTable.resize(initialTableSize);
+    index.Rehash(InitialBucketCount);
   }
 
   EvictingCacheMap(const EvictingCacheMap& other)
-      : pairs(other.pairs),
-        hashTable(other.hashTable.size()),
+      : allocator(ValueTraits::select_on_container_copy_construction(
+            other.allocator)),
+        slab(MaxEntries(other.capacity), allocator),
+        index(other.index.BucketCount(), allocator),
+        policy(other.expectedSize),
+        wheel(allocator),
         hasher(other.hasher),
-        capacity(other.capacity) {
-    for (auto it = pairs.begin(); it != pairs.end(); ++it)
-      Bucket(it->first).emplace_back(it);
+        keyEqual(other.keyEqual),
+        weigher(other.weigher),
+        capacity(other.capacity),
+        expectedSize(other.expectedSize),
+        recorder(MakeRecorder()),
+        listener(other.listener) {
+    AppendEntries(other);
   }
 
+  /**
+   * Copy entries of another map.  The allocator is never propagated, entries
+   *     are copied into memory obtained from the allocator of this map.  The
+   *     order of entries is preserved, but per-entry eviction policy state
+   *     is not copied.  Statistics are not copied either.  Entries which were
+   *     in this map are not reported to the removal listener.
+   */
   EvictingCacheMap& operator=(const EvictingCacheMap& other) {
     if (this != &other) {
-      pairs = other.pairs;
-      hashTable.resize(other.hashTable.size());
+      Clear();
+      listener = other.listener;
       hasher = other.hasher;
+      keyEqual = other.keyEqual;
+      weigher = other.weigher;
       capacity = other.capacity;
-      for (auto it = pairs.begin(); it != pairs.end(); ++it)
-        Bucket(it->first).emplace_back(it);
+      expectedSize = other.expectedSize;
+      slab.SetMaxNodes(MaxEntries(capacity));
+      index = Index(other.index.BucketCount(), allocator);
+      policy = Policy(expectedSize);
+      AppendEntries(other);
     }
     return *this;
   }
 
   EvictingCacheMap(EvictingCacheMap&& other)
-      : pairs(std::move(other.pairs)),
-        hashTable(std::move(other.hashTable)),
+      : allocator(other.allocator),
+        slab(std::move(other.slab)),
+        index(std::move(other.index)),
+        list(std::move(other.list)),
+        policy(std::move(other.policy)),
+        wheel(std::move(other.wheel)),
         hasher(std::move(other.hasher)),
-        capacity(other.capacity) {}
+        keyEqual(std::move(other.keyEqual)),
+        weigher(std::move(other.weigher)),
+        capacity(other.capacity),
+        expectedSize(other.expectedSize),
+        totalWeight(other.totalWeight),
+        mrc(std::move(other.mrc)),
+        recorder(other.recorder),
+        listener(std::move(other.listener)) {
+    other.policy.Cleared();
+    other.totalWeight = 0;
+  }
 
   EvictingCacheMap& operator=(EvictingCacheMap&& other) {
     if (this != &other) {
-      pairs = std::move(other.pairs);
-      hashTable = std::move(other.hashTable);
-      hasher = std::move(other.hasher);
-      capacity = other.capacity;
+      constexpr bool propagate =
+          ValueTraits::propagate_on_container_move_assignment::value;
+      if (propagate || allocator == other.allocator) {
+        DestroyValues();
+        if constexpr (propagate) allocator = other.allocator;
+        slab = std::move(other.slab);
+        index = std::move(other.index);
+        list = std::move(other.list);
+        policy = std::move(other.policy);
+        wheel = std::move(other.wheel);
+        hasher = std::move(other.hasher);
+        keyEqual = std::move(other.keyEqual);
+        weigher = std::move(other.weigher);
+        capacity = other.capacity;
+        expectedSize = other.expectedSize;
+        totalWeight = other.totalWeight;
+        other.policy.Cleared();
+        other.totalWeight = 0;
+      } else {
+        Clear();
+        hasher = std::move(other.hasher);
+        keyEqual = std::move(other.keyEqual);
+        weigher = std::move(other.weigher);
+        capacity = other.capacity;
+        expectedSize = other.expectedSize;
+        slab.SetMaxNodes(MaxEntries(capacity));
+        index = Index(other.index.BucketCount(), allocator);
+        policy = Policy(expectedSize);
+        AppendEntries(std::move(other));
+        other.Clear();
+      }
+      mrc = std::move(other.mrc);
+      listener = std::move(other.listener);
+      // The moved-from map keeps recording, into the same statistics
+      if constexpr (IsRecording) recorder = other.recorder;
     }
     return *this;
   }
 
-  ~EvictingCacheMap() = default;
+  // Entries destroyed along with the map are not reported to the listener
+  ~EvictingCacheMap() { DestroyValues(); }
 
   /**
    * Check for existence of a specific key in the map.  This operation has
-   *     no effect on LRU order.
+   *     no effect on eviction order.
    * @param key key to search for
    * @return true if exists, false otherwise
    */
-  bool exists(const TKey& key) const {
-    const auto& bucket = Bucket(key);
-    return std::find_if(bucket.begin(), bucket.end(), [&](iterator iter) {
-             return iter->first == key;
-           }) != bucket.end();
+  bool exists(const TKey& key) const { return Exists(key); }
+
+  /**
+   * Heterogeneous exists(), available if lookups are transparent.
+   */
+  template <class K, class = IfTransparent<K>>
+  bool exists(const K& key) const {
+    return Exists(key);
+  }
+
+  /**
+   * Get the iterator associated with a specific key without reporting an
+   *     access to the eviction policy, so the eviction order is unchanged.
+   * @param key key to search for
+   * @return the iterator of the object or end() if it does not exist
+   */
+  iterator findWithoutPromotion(const TKey& key) {
+    return iterator(const_cast<NodeBase*>(Peek(key)));
+  }
+  const_iterator findWithoutPromotion(const TKey& key) const {
+    return const_iterator(const_cast<NodeBase*>(Peek(key)));
   }
 
   /**
-   * Get the value associated with a specific key.  This function always
-   *     promotes a found value to the head of the LRU.
+   * Report an access to an entry found by findWithoutPromotion() earlier, as
+   *     get() would have, e.g. to replay reads recorded while the map could
+   *     not be modified.  Nothing may have been removed from the map since
+   *     the lookup, except the entry itself: the node of a removed entry is
+   *     recognized only until it is reused for another key, and then the new
+   *     entry would be promoted.  Must not be used with iterators from before
+   *     the map was moved or assigned to either.
+   * @param it iterator of the entry
+   * @return true if the entry still existed and was promoted
+   */
+  bool promote(const_iterator it) {
+    if (it == cend()) return false;
+    Node* node = static_cast<Node*>(it.node);
+    const std::size_t pos =
+        index.Find(node->hash, [node](Node* other) { return other == node; });
+    if (pos == Index::npos) return false;
+    if constexpr (IsExpiring)
+      if (node->deadline <= Now()) return false;
+    policy.Accessed(node, list);
+    return true;
+  }
+
+  /**
+   * Get the value associated with a specific key.  A found value is reported
+   *     to the eviction policy as accessed; with LruEviction it is promoted
+   *     to the head of the LRU.
    * @param key key associated with the value
    * @return the value if it exists
    */
-  std::optional<TValue> get(const TKey& key) {
-    auto iter = find(key);
-    if (iter != pairs.end())
-      return iter->second;
-    else
-      return {};
+  std::optional<TValue> get(const TKey& key) { return Get(key); }
+
+  /**
+   * Heterogeneous get(), available if lookups are transparent.
+   */
+  template <class K, class = IfTransparent<K>>
+  std::optional<TValue> get(const K& key) {
+    return Get(key);
   }
 
   /**
-   * Get the iterator associated with a specific key.  This function always
-   *     promotes a found value to the head of the LRU.
+   * Get the iterator associated with a specific key.  A found value is
+   *     reported to the eviction policy as accessed; with LruEviction it is
+   *     promoted to the head of the LRU.
    * @param key key to associate with value
    * @return the iterator of the object (a std::pair of const TKey, TValue) or
    *     end() if it does not exist
    */
-  iterator find(const TKey& key) {
-    const auto& bucket = Bucket(key);
-    auto iter = std::find_if(bucket.begin(), bucket.end(),
-                             [&](iterator iter) { return iter->first == key; });
+  iterator find(const TKey& key) { return Find(key); }
 
-    if (iter == bucket.end()) return pairs.end();
-
-    pairs.splice(pairs.begin(), pairs, *iter);
-    return pairs.begin();
+  /**
+   * Heterogeneous find(), available if lookups are transparent.
+   */
+  template <class K, class = IfTransparent<K>>
+  iterator find(const K& key) {
+    return Find(key);
   }
 
   /**
-   * Erase the key-value pair associated with key if it exists.
+   * Erase the key-value pair associated with key if it exists.  An expired
+   *     entry is removed as Expired and does not count as erased.
    * @param key key associated with the value
    * @return true if the key existed and was erased, else false
    */
-  bool erase(const TKey& key) {
-    auto iter = find(key);
-    if (iter == pairs.end()) return false;
+  bool erase(const TKey& key) { return Erase(key); }
 
-    Bucket(key).remove_if([&](iterator iter) { return iter->first == key; });
-    pairs.pop_front();
-    return true;
+  /**
+   * Heterogeneous erase(), available if lookups are transparent.
+   */
+  template <class K, class = IfTransparent<K>>
+  bool erase(const K& key) {
+    return Erase(key);
   }
 
   /**
-   * Set a key-value pair in the dictionary
+   * Set a key-value pair in the dictionary.  In a weighted map entries are
+   *     evicted until the total weight fits into the capacity again; this
+   *     may evict the updated entry itself if the policy picks it.  An entry
+   *     heavier than the whole capacity is not stored, and an existing entry
+   *     with the same key is erased.
    * @param key key to associate with value
    * @param value value to associate with the key
    */
   template <class T, class E>
   void put(T&& key, E&& value) {
-    auto iter = find(key);
+    Put(std::forward<T>(key), std::forward<E>(value), NoTtl);
+  }
 
-    if (iter != pairs.end()) {
-      iter->second = std::forward<E>(value);
-      return;
-    }
+  /**
+   * Set a key-value pair which expires after a time-to-live.  Only available
+   *     if the map has an expiration mode.
+   * @param key key to associate with value
+   * @param value value to associate with the key
+   * @param ttl time-to-live of the entry, counted from now
+   */
+  template <class T, class E, class Rep, class Period>
+  void put(T&& key, E&& value, std::chrono::duration<Rep, Period> ttl) {
+    static_assert(IsExpiring, "put() with a ttl needs an expiration mode");
+    const auto nanoseconds = std::max<std::int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(ttl).count(), 0);
+    Put(std::forward<T>(key), std::forward<E>(value),
+        std::min<std::uint64_t>(nanoseconds, NoTtl - 1));
+  }
+
+  /**
+   * Look up many keys at once, with the same effect as calling get() for
+   *     each of them in order.  Keys are processed in batches: all keys of a
+   *     batch are hashed and the index slots and entries they are going to
+   *     touch are prefetched before any of them is looked up, so the cache
+   *     misses of a batch overlap instead of being taken one after another.
+   * @param first beginning of the range of keys
+   * @param last end of the range of keys
+   * @param out output iterator receiving a std::optional<TValue> per key
+   * @return output iterator past the last value written
+   */
+  template <class TForwardIt, class TOutputIt>
+  TOutputIt multiGet(TForwardIt first, TForwardIt last, TOutputIt out) {
+    std::uint64_t now = 0;
+    if constexpr (IsExpiring) now = ReclaimExpired();
 
-    if (pairs.size() == capacity) {
-      const auto& keyToRemove = pairs.back().first;
-      Bucket(keyToRemove).remove_if([&](iterator iter) {
-        return iter->first == keyToRemove;
-      });
-      pairs.pop_back();
+    std::uint32_t hashes[BatchSize];
+    while (first != last) {
+      const std::size_t count =
+          PrefetchBatch(first, last, hashes,
+                        [](const auto& key) -> const auto& { return key; });
+      for (std::size_t i = 0; i < count; ++i, ++first) {
+        const iterator iter = Find(LookupKey(*first), hashes[i], now);
+        if (iter != end())
+          *out = std::optional<TValue>(iter->second);
+        else
+          *out = std::optional<TValue>();
+        ++out;
+      }
     }
+    return out;
+  }
 
-    pairs.emplace_front(std::forward<T>(key), std::forward<E>(value));
-    if (LoadFactor() > MaxLoadFactor) Extend();
-    Bucket(pairs.front().first).emplace_back(pairs.begin());
+  /**
+   * Set many key-value pairs, with the same effect as calling put() for each
+   *     of them in order.  Lookups are prefetched in batches like in
+   *     multiGet().
+   * @param first beginning of a range of pairs of a key and a value, which
+   *     are moved from if the iterator yields rvalues (std::move_iterator)
+   * @param last end of the range
+   */
+  template <class TForwardIt>
+  void multiPut(TForwardIt first, TForwardIt last) {
+    std::uint32_t hashes[BatchSize];
+    while (first != last) {
+      const std::size_t count = PrefetchBatch(
+          first, last, hashes,
+          [](const auto& entry) -> const auto& { return entry.first; });
+      for (std::size_t i = 0; i < count; ++i, ++first) {
+        auto&& entry = *first;
+        decltype(auto) lookupKey = LookupKey(entry.first);
+        Put(std::forward<decltype(entry)>(entry).first,
+            std::forward<decltype(entry)>(entry).second, NoTtl, lookupKey,
+            hashes[i]);
+      }
+    }
   }
 
   /**
    * Get the number of elements in the dictionary
    * @return the size of the dictionary
    */
-  std::size_t size() const { return pairs.size(); }
+  std::size_t size() const { return list.Size(); }
+
+  /**
+   * Prepare the map for a number of entries: the index is grown so that it
+   *     does not need to be rehashed until that size, and list nodes are
+   *     allocated up front.
+   * @param n expected number of entries, limited by the capacity
+   */
+  void reserve(std::size_t n) {
+    n = std::min(n, MaxEntries(capacity));
+    const auto bucketCount =
+        static_cast<std::size_t>(static_cast<double>(n) / MaxLoadFactor) + 1;
+    if (bucketCount > index.BucketCount()) {
+      index.Rehash(bucketCount);
+      Count(Counter::Rehashes);
+    }
+    slab.Reserve(n);
+  }
+
+  /**
+   * Get the total weight of the entries, which never exceeds the capacity
+   * @return the total weight, equal to size() for an unweighted map
+   */
+  std::size_t weight() const {
+    if constexpr (IsWeighted)
+      return totalWeight;
+    else
+      return list.Size();
+  }
 
   /**
    * Typical empty function
    * @return true if empty, false otherwise
    */
-  bool empty() const { return pairs.size() == 0; }
+  bool empty() const { return list.Empty(); }
 
   void clear() {
-    pairs.clear();
-    for (auto& list : hashTable) list.clear();
+    if (listener) {
+      for (NodeBase* node = list.Front(); node != list.End();
+           node = node->next)
+        Notify(static_cast<Node*>(node), RemovalCause::Cleared);
+    }
+    Clear();
+  }
+
+  /**
+   * Reclaim all expired entries now instead of during the next operation.
+   *     Does nothing for maps without an expiration mode.
+   */
+  void cleanUp() {
+    if constexpr (IsExpiring) ReclaimExpired();
+  }
+
+  /**
+   * Start estimating the miss-ratio curve: from now on every find() and get()
+   *     is a reference of the sampled stream, while put() and exists() are
+   *     not.  Restarts the estimate if it is already being tracked.  Every
+   *     reference costs a comparison and the sampled ones a stack update,
+   *     several percent of a get() in all (see MissRatioOverhead); an
+   *     untracked map only tests for the tracker.
+   * @param maxSamples maximum number of distinct keys the tracker keeps
+   * @param rate initial sampling rate, lowered as needed to fit maxSamples
+   */
+  void trackMissRatioCurve(
+      std::size_t maxSamples = MissRatioCurve::DefaultMaxSamples,
+      double rate = MissRatioCurve::DefaultRate) {
+    mrc = std::make_unique<MissRatioCurve>(maxSamples, rate);
+  }
+
+  void stopTrackingMissRatioCurve() { mrc.reset(); }
+
+  /**
+   * Get the miss-ratio curve estimated so far, e.g.
+   *     `missRatioCurve()->HitRatio(2 * capacity)`.
+   * @return the estimate, nullptr unless trackMissRatioCurve() was called
+   */
+  const MissRatioCurve* missRatioCurve() const { return mrc.get(); }
+
+  /**
+   * Register a function called with every entry that leaves the map other
+   *     than by destruction or assignment of the map: its key, its value to
+   *     move from, and why it was removed.  For RemovalCause::Replaced the
+   *     value is the previous one.  The listener runs inside the operation
+   *     which removes the entry, so it must neither throw nor use the map.
+   * @param removalListener the listener, an empty function to remove it
+   */
+  void setRemovalListener(RemovalListener removalListener) {
+    listener = std::move(removalListener);
   }
 
+  /**
+   * Take a snapshot of the statistics.  Only available if TStats keeps any.
+   * @return statistics since construction or the last resetStats()
+   */
+  CacheStatsSnapshot stats() const {
+    static_assert(IsRecording, "stats() needs a statistics mode");
+    return recorder->Snapshot();
+  }
+
+  void resetStats() {
+    static_assert(IsRecording, "resetStats() needs a statistics mode");
+    recorder->Reset();
+  }
+
+  /**
+   * Record statistics into a recorder shared with other maps instead of the
+   *     map's own one, e.g. to have one set of statistics for a group of
+   *     caches.  What was recorded so far stays with the previous recorder.
+   * @param shared the recorder, which must not be null
+   */
+  void shareStats(std::shared_ptr<CacheStats> shared) {
+    static_assert(IsRecording, "shareStats() needs a statistics mode");
+    recorder = std::move(shared);
+  }
+
+  /**
+   * @return the recorder statistics are recorded into
+   */
+  const std::shared_ptr<CacheStats>& statsRecorder() const {
+    static_assert(IsRecording, "statsRecorder() needs a statistics mode");
+    return recorder;
+  }
+
+  /**
+   * @return the state of the eviction policy, e.g. the ghost lists of
+   *     ArcEviction
+   */
+  const Policy& evictionPolicy() const { return policy; }
+
+  allocator_type get_allocator() const { return allocator; }
+
   // Iterators and such
-  iterator begin() noexcept { return pairs.begin(); }
-  iterator end() noexcept { return pairs.end(); }
-  const_iterator begin() const noexcept { return pairs.begin(); }
-  const_iterator end() const noexcept { return pairs.end(); }
-  const_iterator cbegin() const noexcept { return pairs.cbegin(); }
-  const_iterator cend() const noexcept { return pairs.cend(); }
+  iterator begin() noexcept { return iterator(list.Front()); }
+  iterator end() noexcept { return iterator(list.End()); }
+  const_iterator begin() const noexcept { return cbegin(); }
+  const_iterator end() const noexcept { return cend(); }
+  const_iterator cbegin() const noexcept {
+    return const_iterator(list.Front());
+  }
+  const_iterator cend() const noexcept {
+    return const_iterator(const_cast<NodeBase*>(list.End()));
+  }
 
  private:
+  template <class K>
+  bool Exists(const K& key) const { return Peek(key) != list.End(); }
+
+  // The node of a key without touching the policy, the list end if it does
+  // not exist or expired
+  template <class K>
+  const NodeBase* Peek(const K& key) const {
+    const std::size_t pos = index.Find(HashOf(key), KeyMatcher(key));
+    if (pos == Index::npos) return list.End();
+    const Node* node = index.At(pos);
+    if constexpr (IsExpiring)
+      if (node->deadline <= Now()) return list.End();
+    return node;
+  }
+
+  bool HasExpired([[maybe_unused]] const Node* node,
+                  [[maybe_unused]] std::uint64_t now) const {
+    if constexpr (IsExpiring)
+      return node->deadline <= now;
+    else
+      return false;
+  }
+
+  // Insert an entry read from a snapshot.  Keys of a snapshot are distinct,
+  // so the index is not searched, and it was sized for the snapshot already.
+  // @param ttl time-to-live of the entry
+  // @param left time left until it expires
+  void LoadEntry(TKey&& key, TValue&& value, std::uint64_t ttl,
+                 std::uint64_t left, std::uint64_t now) {
+    const std::uint32_t hash = HashOf(key);
+    Node* node;
+    if constexpr (IsWeighted) {
+      node = PutWeighted(hash, std::move(key), std::move(value), left, now);
+      if (!node) return;
+    } else {
+      node = slab.Acquire();
+      try {
+        ValueTraits::construct(allocator,
+                               static_cast<value_type*>(node->Storage()),
+                               std::move(key), std::move(value));
+      } catch (...) {
+        slab.Release(node);
+        throw;
+      }
+      Insert(node, hash, left, now);
+    }
+    // The timer was started with the time left
+    if constexpr (IsExpiring) node->ttl = ttl;
+  }
+
+  template <class K>
+  std::optional<TValue> Get(const K& key) {
+    auto iter = Find(key);
+    if (iter != end())
+      return iter->second;
+    else
+      return {};
+  }
+
+  template <class K>
+  iterator Find(const K& key) {
+    [[maybe_unused]] const auto stopwatch = Measure(Operation::Get);
+    std::uint64_t now = 0;
+    if constexpr (IsExpiring) now = ReclaimExpired();
+    return Find(key, HashOf(key), now);
+  }
+
+  template <class K>
+  iterator Find(const K& key, std::uint32_t hash, std::uint64_t now) {
+    if (mrc) mrc->Reference(hash);
+    const std::size_t pos = index.Find(hash, KeyMatcher(key));
+    if (pos == Index::npos) {
+      Count(Counter::Misses);
+      return end();
+    }
+
+    Node* node = index.At(pos);
+    if constexpr (IsExpiring) {
+      // The wheel only expires whole buckets, the entry may be due already
+      if (node->deadline <= now) {
+        index.EraseAt(pos);
+        Unlink(node);
+        Notify(node, RemovalCause::Expired);
+        DestroyNode(node);
+        Count(Counter::Misses);
+        return end();
+      }
+      if constexpr (TExpiration::RefreshOnAccess) StartTimer(node, now);
+    }
+    policy.Accessed(node, list);
+    Count(Counter::Hits);
+    return iterator(node);
+  }
+
+  template <class K>
+  bool Erase(const K& key) {
+    [[maybe_unused]] const auto stopwatch = Measure(Operation::Erase);
+    std::uint64_t now = 0;
+    if constexpr (IsExpiring) now = ReclaimExpired();
+    if (index.RehashPending()) index.RehashStep(RehashStepSize);
+    const std::size_t pos = index.Find(HashOf(key), KeyMatcher(key));
+    if (pos == Index::npos) return false;
+
+    Node* node = index.At(pos);
+    // An entry due but not reclaimed yet is gone already
+    const bool expired = HasExpired(node, now);
+    index.EraseAt(pos);
+    Unlink(node);
+    Notify(node, expired ? RemovalCause::Expired : RemovalCause::Erased);
+    DestroyNode(node);
+    return !expired;
+  }
+
+  template <class T, class E>
+  void Put(T&& key, E&& value, std::uint64_t ttl) {
+    [[maybe_unused]] const auto stopwatch = Measure(Operation::Put);
+    decltype(auto) lookupKey = LookupKey(key);
+    Put(std::forward<T>(key), std::forward<E>(value), ttl, lookupKey,
+        HashOf(lookupKey));
+  }
+
+  // put() with the key to look up and its hash computed already
+  template <class T, class E, class K>
+  void Put(T&& key, E&& value, std::uint64_t ttl, const K& lookupKey,
+           std::uint32_t hash) {
+    std::uint64_t now = 0;
+    if constexpr (IsExpiring) now = ReclaimExpired();
+    if (index.RehashPending()) index.RehashStep(RehashStepSize);
+
+    const std::size_t pos = index.Find(hash, KeyMatcher(lookupKey));
+
+    if (pos != Index::npos) {
+      Count(Counter::Updates);
+      Node* node = index.At(pos);
+      policy.Accessed(node, list);
+      if (listener) {
+        TValue previous = std::move(node->Value()->second);
+        node->Value()->second = std::forward<E>(value);
+        CallListener(node->Value()->first, std::move(previous),
+                     RemovalCause::Replaced);
+      } else {
+        node->Value()->second = std::forward<E>(value);
+      }
+      if constexpr (IsExpiring) {
+        node->ttl = ttl;
+        StartTimer(node, now);
+      }
+      if constexpr (IsWeighted) Reweigh(node);
+      return;
+    }
+
+    const std::size_t entries = std::min(list.Size() + 1, MaxEntries(capacity));
+    if (LoadFactor(entries) > MaxLoadFactor)
+      Extend();
+    else if (entries == index.BucketCount() / 2 + 1)
+      index.PrepareRehash(NextBucketCount());
+
+    if constexpr (IsWeighted) {
+      PutWeighted(hash, std::forward<T>(key), std::forward<E>(value), ttl,
+                  now);
+      return;
+    }
+
+    Node* node;
+    if (list.Size() == capacity) {
+      // Reuse the evicted node instead of giving it back to the slab and
+      // taking another one.
+      node = policy.Victim(hash, list);
+      Count(Counter::Evictions);
+      index.Erase(node->hash, [node](Node* other) { return other == node; });
+      Unlink(node);
+      Notify(node, RemovalCause::Capacity);
+      ValueTraits::destroy(allocator, node->Value());
+    } else {
+      node = slab.Acquire();
+    }
+
+    try {
+      ValueTraits::construct(allocator,
+                             static_cast<value_type*>(node->Storage()),
+                             std::forward<T>(key), std::forward<E>(value));
+    } catch (...) {
+      slab.Release(node);
+      throw;
+    }
+    Insert(node, hash, ttl, now);
+  }
+
+  // Hash up to BatchSize keys and start loading what looking them up is going
+  // to touch: first the home slots of all keys, then the entries their
+  // fingerprints point to.
+  // @return number of keys hashed
+  template <class TForwardIt, class TKeyOf>
+  std::size_t PrefetchBatch(TForwardIt first, TForwardIt last,
+                            std::uint32_t* hashes, TKeyOf keyOf) const {
+    std::size_t count = 0;
+    for (; first != last && count < BatchSize; ++first, ++count) {
+      hashes[count] = HashOf(LookupKey(keyOf(*first)));
+      index.Prefetch(hashes[count]);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      if (Node* node = index.Candidate(hashes[i])) {
+        Prefetch(node);
+        Prefetch(node->Value());
+      }
+    }
+    return count;
+  }
+
+  static void Prefetch(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#endif
+  }
+
+  // Upper bound on the number of entries.  Weights may be 0, so a weighted
+  // map has none.
+  static std::size_t MaxEntries(std::size_t capacity) {
+    if constexpr (IsWeighted)
+      return std::numeric_limits<std::size_t>::max();
+    else
+      return capacity;
+  }
+
+  // Growing starts once the index is 3/4 full.  Its new slots are allocated
+  // when it is half full already and initialized by the following put() and
+  // erase() calls, which also move the handles a few at a time afterwards,
+  // so growing a large index does not stall a single call.
   void Extend() {
-    std::size_t newHashTableSize = 2 * hashTable.size();
-    if (static_cast<double>(newHashTableSize) * MaxLoadFactor > capacity)
-      newHashTableSize = static_cast<std::size_t>(
-          static_cast<double>(capacity) / MaxLoadFactor);
-    hashTable.clear();
-    hashTable.resize(newHashTableSize);
+    index.StartRehash(NextBucketCount());
+    Count(Counter::Rehashes);
+  }
+
+  std::size_t NextBucketCount() const {
+    std::size_t newBucketCount =
+        std::max(2 * index.BucketCount(), InitialBucketCount);
+    // The index is rounded up to a power of two, so capping it at
+    // capacity / MaxLoadFactor still keeps a full cache under the limit.
+    if (!IsWeighted &&
+        static_cast<double>(newBucketCount) * MaxLoadFactor > capacity)
+      newBucketCount = static_cast<std::size_t>(
+          static_cast<double>(capacity) / MaxLoadFactor) + 1;
+    return newBucketCount;
+  }
+
+  // Insert a new entry into a weighted map.  The value is constructed first,
+  // since the weigher needs it, and entries are evicted afterwards; the new
+  // node is not linked yet, so it can not be picked as a victim.
+  // @return the inserted node, null if the entry was heavier than the
+  //     capacity
+  template <class T, class E>
+  Node* PutWeighted(std::uint32_t hash, T&& key, E&& value, std::uint64_t ttl,
+                   std::uint64_t now) {
+    Node* node = slab.Acquire();
+    try {
+      ValueTraits::construct(allocator,
+                             static_cast<value_type*>(node->Storage()),
+                             std::forward<T>(key), std::forward<E>(value));
+    } catch (...) {
+      slab.Release(node);
+      throw;
+    }
+
+    try {
+      node->weight = WeightOf(node);
+    } catch (...) {
+      DestroyNode(node);
+      throw;
+    }
+    if (node->weight > capacity) {
+      Count(Counter::Evictions);
+      Notify(node, RemovalCause::Capacity);
+      DestroyNode(node);
+      return nullptr;
+    }
+    while (totalWeight + node->weight > capacity) Evict(hash);
+
+    totalWeight += node->weight;
+    Insert(node, hash, ttl, now);
+    return node;
+  }
+
+  // Link a node with a constructed value into the list, the policy, the
+  // index and the timer wheel
+  void Insert(Node* node, std::uint32_t hash, std::uint64_t ttl,
+              std::uint64_t now) {
+    Count(Counter::Inserts);
+    node->hash = hash;
+    list.PushFront(node);
+    policy.Inserted(node, list);
+    index.Insert(hash, node);
+    if constexpr (IsExpiring) {
+      node->ttl = ttl;
+      StartTimer(node, now);
+    }
+  }
 
-    for (auto it = pairs.begin(); it != pairs.end(); ++it)
-      Bucket(it->first).emplace_back(it);
+  // (Re)start the time-to-live of a node
+  void StartTimer(Node* node, std::uint64_t now) {
+    wheel.Remove(node);
+    const std::uint64_t deadline =
+        node->ttl == NoTtl ? Wheel::Never
+                           : now + std::min(node->ttl, Wheel::Never - 1 - now);
+    wheel.Schedule(node, deadline);
   }
 
-  double LoadFactor() const {
-    return static_cast<double>(pairs.size()) /
-           static_cast<double>(hashTable.size());
+  static std::uint64_t Now() {
+    const auto sinceEpoch = TExpiration::Clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch)
+            .count());
   }
-  const IteratorsList& Bucket(const TKey& key) const {
-    return hashTable[hasher(key) % hashTable.size()];
+
+  // Remove all entries whose bucket in the timer wheel has passed
+  // @return the current time
+  std::uint64_t ReclaimExpired() {
+    const std::uint64_t now = Now();
+    wheel.Advance(now, [this](typename Wheel::Timer* timer) {
+      Remove(static_cast<Node*>(timer), RemovalCause::Expired);
+    });
+    return now;
   }
-  IteratorsList& Bucket(const TKey& key) {
-    return hashTable[hasher(key) % hashTable.size()];
+
+  // Account for the new value of an entry in a weighted map
+  void Reweigh(Node* node) {
+    const std::size_t weight = WeightOf(node);
+    totalWeight = totalWeight - node->weight + weight;
+    node->weight = weight;
+    if (weight > capacity) {
+      Count(Counter::Evictions);
+      Remove(node, RemovalCause::Capacity);
+      return;
+    }
+    while (totalWeight > capacity) Evict(node->hash);
+  }
+
+  std::size_t WeightOf(Node* node) const {
+    const value_type& entry = *node->Value();
+    return weigher(entry.first, entry.second);
+  }
+
+  void Evict(std::uint32_t hash) {
+    Count(Counter::Evictions);
+    Remove(policy.Victim(hash, list), RemovalCause::Capacity);
+  }
+
+  using Counter = CacheStats::Counter;
+  using Operation = CacheStats::Operation;
+
+  static auto MakeRecorder() {
+    if constexpr (IsRecording)
+      return std::make_shared<CacheStats>(IsTiming);
+    else
+      return NoRecorder{};
+  }
+
+  void Count(Counter counter) {
+    if constexpr (IsRecording) recorder->Add(counter);
+  }
+
+  // Measures the enclosing operation until the result goes out of scope,
+  // if it is one of the sampled ones.  Without a timing mode nothing is
+  // compiled in, and no clock is read for a shared recorder which keeps no
+  // histograms.
+  auto Measure([[maybe_unused]] Operation operation) {
+    if constexpr (IsTiming) {
+      CacheStats* sampled = nullptr;
+      if (++operations == TStats::Period) {
+        operations = 0;
+        if (recorder->RecordsLatency()) sampled = recorder.get();
+      }
+      return CacheStats::Stopwatch<typename TStats::Clock>(
+          sampled, operation, TStats::Period);
+    } else {
+      return NoStopwatch{};
+    }
+  }
+
+  void Remove(Node* node, RemovalCause cause) {
+    index.Erase(node->hash, [node](Node* other) { return other == node; });
+    Unlink(node);
+    Notify(node, cause);
+    DestroyNode(node);
+  }
+
+  // Hand an entry about to be destroyed to the listener
+  void Notify(Node* node, RemovalCause cause) {
+    if (listener)
+      CallListener(node->Value()->first, std::move(node->Value()->second),
+                   cause);
+  }
+
+  // A throwing listener would leave the map in the middle of an operation
+  void CallListener(const TKey& key, TValue&& value,
+                    RemovalCause cause) noexcept {
+    listener(key, std::move(value), cause);
+  }
+
+  // Remove all entries without reporting them
+  void Clear() {
+    DestroyValues();
+    index.Clear();
+    policy.Cleared();
+    if constexpr (IsExpiring) wheel.Clear();
+  }
+
+  double LoadFactor(std::size_t elements) const {
+    return static_cast<double>(elements) /
+           static_cast<double>(index.BucketCount());
+  }
+
+  template <class K>
+  std::uint32_t HashOf(const K& key) const {
+    return Index::Mix(hasher(key));
+  }
+
+  template <class K>
+  auto KeyMatcher(const K& key) const {
+    return [this, &key](Node* node) {
+      return keyEqual(node->Value()->first, key);
+    };
+  }
+
+  // The key put() looks up: the argument itself if lookups are transparent
+  // or it is a TKey already, a TKey constructed from it otherwise
+  template <class K>
+  static decltype(auto) LookupKey(const K& key) {
+    if constexpr (IsTransparentLookup || std::is_same_v<K, TKey>)
+      return (key);
+    else
+      return TKey(key);
+  }
+
+  void Unlink(Node* node) {
+    policy.Removed(node, list);
+    list.Remove(node);
+    if constexpr (IsWeighted) totalWeight -= node->weight;
+    if constexpr (IsExpiring) wheel.Remove(node);
+  }
+
+  void DestroyNode(Node* node) {
+    ValueTraits::destroy(allocator, node->Value());
+    slab.Release(node);
+  }
+
+  // Destroy all entries and return their nodes to the slab.  Neither the
+  // index nor the policy are updated.
+  void DestroyValues() {
+    for (NodeBase* node = list.Front(); node != list.End();) {
+      NodeBase* next = node->next;
+      DestroyNode(static_cast<Node*>(node));
+      node = next;
+    }
+    list.Reset();
+    totalWeight = 0;
+  }
+
+  // Copy or move entries of another map, keeping their order.  The index
+  // must already have enough buckets.
+  template <class TMap>
+  void AppendEntries(TMap&& other) {
+    if constexpr (IsExpiring) ReclaimExpired();
+    try {
+      for (NodeBase* it = other.list.Back(); it != other.list.End();
+           it = it->prev) {
+        Node* source = static_cast<Node*>(it);
+        Node* node = slab.Acquire();
+        try {
+          auto* storage = static_cast<value_type*>(node->Storage());
+          if constexpr (std::is_lvalue_reference_v<TMap>)
+            ValueTraits::construct(allocator, storage, *source->Value());
+          else
+            ValueTraits::construct(allocator, storage,
+                                   source->Value()->first,
+                                   std::move(source->Value()->second));
+        } catch (...) {
+          slab.Release(node);
+          throw;
+        }
+        node->hash = source->hash;
+        if constexpr (IsWeighted) {
+          node->weight = source->weight;
+          totalWeight += node->weight;
+        }
+        list.PushFront(node);
+        policy.Inserted(node, list);
+        index.Insert(node->hash, node);
+        if constexpr (IsExpiring) {
+          node->ttl = source->ttl;
+          wheel.Schedule(node, source->deadline);
+        }
+      }
+    } catch (...) {
+      Clear();
+      throw;
+    }
   }
 
   constexpr static double MaxLoadFactor = 0.75;
+  // Handles moved per put() or erase() while the index is rehashed.  The
+  // index doubles, so one would already finish before the next growth.
+  constexpr static std::size_t RehashStepSize = 4;
+  constexpr static std::uint64_t NoTtl = Wheel::Never;
+  constexpr static std::size_t InitialBucketCount = 4;
+  // Keys multiGet() and multiPut() prefetch ahead
+  constexpr static std::size_t BatchSize = 16;
 
-  PairsList pairs;
-  HashTable hashTable;
+  TAllocator allocator;
+  Slab slab;
+  Index index;
+  IntrusiveList list;
+  Policy policy;
+  std::conditional_t<IsExpiring, Wheel, NoWheel> wheel;
   THash hasher;
+  TKeyEqual keyEqual;
+  TWeigher weigher;
   size_t capacity;
+  // Number of entries the policy was sized for
+  std::size_t expectedSize;
+  // Only maintained by weighted maps, see weight()
+  std::size_t totalWeight = 0;
+  // Only allocated while the miss-ratio curve is tracked
+  std::unique_ptr<MissRatioCurve> mrc;
+  std::conditional_t<IsRecording, std::shared_ptr<CacheStats>, NoRecorder>
+      recorder;
+  // Operations since the last measured one
+  std::conditional_t<IsTiming, unsigned, NoStopwatch> operations{};
+  RemovalListener listener;
 };
 
+namespace pmr {
+
+/**
+ * EvictingCacheMap taking its memory from a std::pmr::memory_resource.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>,
+          class TEvictionPolicy = LruEviction>
+using EvictingCacheMap = ::EvictingCacheMap<
+    TKey, TValue, THash, TKeyEqual, TEvictionPolicy,
+    std::pmr::polymorphic_allocator<std::pair<const TKey, TValue>>>;
+
+}  // namespace pmr
+
 #endif  // INCLUDE_EVICTINGCACHEMAP_H_
@@ -0,0 +1,203 @@
+#ifndef INCLUDE_EVICTIONPOLICIES_H_
+#define INCLUDE_EVICTIONPOLICIES_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "IntrusiveList.h"
+
+/*
+  Eviction policies for EvictingCacheMap.
+
+  A policy is a tag type with a nested `template <class TNode> class Policy`.
+    The map owns one Policy instance and a list of all its nodes, which is
+    also the iteration order of the map.  Nodes derive from Policy::Hook, so
+    a policy can keep per-entry state without any lookup.
+
+  The map calls:
+    Policy(std::size_t capacity),
+    void Inserted(TNode*, IntrusiveList&) after a new node was pushed to the
+      front of the list,
+    void Accessed(TNode*, IntrusiveList&) when an entry is found by find(),
+      get() or put(),
+    TNode* Victim(std::uint32_t hash, IntrusiveList&) when the map is full
+      and the entry with the given hash is about to be inserted,
+    void Removed(TNode*, IntrusiveList&) right before a node is unlinked from
+      the list, either because it was erased or evicted,
+    void Cleared() after all nodes were removed at once.
+
+  Policies may reorder the list but never link or unlink nodes themselves.
+    They must not keep pointers to the list sentinel either, because it moves
+    together with the map.  TNode::hash holds the mixed hash of the key.
+*/
+
+/**
+ * Null-terminated doubly linked list for policies which keep nodes in lists
+ *     of their own, next to the list of the map.  The hook of such a policy
+ *     provides `TNode* policyPrev` and `TNode* policyNext` members.  There is
+ *     no sentinel, so the list can be moved around freely.
+ */
+template <class TNode>
+class PolicyList final {
+ public:
+  TNode* Front() const { return front; }
+  TNode* Back() const { return back; }
+  bool Empty() const { return count == 0; }
+  std::size_t Size() const { return count; }
+
+  void PushFront(TNode* node) {
+    node->policyPrev = nullptr;
+    node->policyNext = front;
+    if (front)
+      front->policyPrev = node;
+    else
+      back = node;
+    front = node;
+    ++count;
+  }
+
+  void Remove(TNode* node) {
+    if (node->policyPrev)
+      node->policyPrev->policyNext = node->policyNext;
+    else
+      front = node->policyNext;
+    if (node->policyNext)
+      node->policyNext->policyPrev = node->policyPrev;
+    else
+      back = node->policyPrev;
+    --count;
+  }
+
+  void MoveToFront(TNode* node) {
+    if (front == node) return;
+    Remove(node);
+    PushFront(node);
+  }
+
+  void Clear() {
+    front = back = nullptr;
+    count = 0;
+  }
+
+ private:
+  TNode* front = nullptr;
+  TNode* back = nullptr;
+  std::size_t count = 0;
+};
+
+/**
+ * Least recently used.  Every hit moves the entry to the front of the list
+ *     and the back of the list is evicted.
+ */
+struct LruEviction {
+  template <class TNode>
+  class Policy {
+   public:
+    struct Hook {};
+
+    explicit Policy(std::size_t) {}
+
+    void Inserted(TNode*, IntrusiveList&) {}
+    void Accessed(TNode* node, IntrusiveList& list) { list.MoveToFront(node); }
+    TNode* Victim(std::uint32_t, IntrusiveList& list) {
+      return static_cast<TNode*>(list.Back());
+    }
+    void Removed(TNode*, IntrusiveList&) {}
+    void Cleared() {}
+  };
+};
+
+/**
+ * CLOCK, implemented as second-chance FIFO.  A hit only sets the visited bit
+ *     of the entry.  On eviction visited entries at the back of the list get
+ *     their bit cleared and are moved to the front, the first unvisited one
+ *     is evicted.
+ */
+struct ClockEviction {
+  template <class TNode>
+  class Policy {
+   public:
+    struct Hook {
+      std::atomic<bool> visited{false};
+    };
+
+    explicit Policy(std::size_t) {}
+
+    void Inserted(TNode* node, IntrusiveList&) {
+      node->visited.store(false, std::memory_order_relaxed);
+    }
+
+    void Accessed(TNode* node, IntrusiveList&) {
+      if (!node->visited.load(std::memory_order_relaxed))
+        node->visited.store(true, std::memory_order_relaxed);
+    }
+
+    TNode* Victim(std::uint32_t, IntrusiveList& list) {
+      for (;;) {
+        auto* node = static_cast<TNode*>(list.Back());
+        if (!node->visited.load(std::memory_order_relaxed)) return node;
+        node->visited.store(false, std::memory_order_relaxed);
+        list.MoveToFront(node);
+      }
+    }
+
+    void Removed(TNode*, IntrusiveList&) {}
+    void Cleared() {}
+  };
+};
+
+/**
+ * SIEVE.  Like CLOCK a hit only sets the visited bit, but retained entries
+ *     stay in place: a hand moves from the back of the list towards the
+ *     front, clearing visited bits, and evicts the first unvisited entry.
+ *     New entries are inserted at the front, so the list stays in insertion
+ *     order and recently inserted entries are separated from the ones that
+ *     have survived a sweep.
+ */
+struct SieveEviction {
+  template <class TNode>
+  class Policy {
+   public:
+    struct Hook {
+      std::atomic<bool> visited{false};
+    };
+
+    explicit Policy(std::size_t) {}
+
+    void Inserted(TNode* node, IntrusiveList&) {
+      node->visited.store(false, std::memory_order_relaxed);
+    }
+
+    void Accessed(TNode* node, IntrusiveList&) {
+      if (!node->visited.load(std::memory_order_relaxed))
+        node->visited.store(true, std::memory_order_relaxed);
+    }
+
+    TNode* Victim(std::uint32_t, IntrusiveList& list) {
+      IntrusiveList::Link* link = hand ? hand : list.Back();
+      for (;;) {
+        auto* node = static_cast<TNode*>(link);
+        if (!node->visited.load(std::memory_order_relaxed)) {
+          hand = node;
+          return node;
+        }
+        node->visited.store(false, std::memory_order_relaxed);
+        link = link->prev != list.End() ? link->prev : list.Back();
+      }
+    }
+
+    void Removed(TNode* node, IntrusiveList& list) {
+      if (hand == node)
+        hand = node->prev != list.End() ? node->prev : nullptr;
+    }
+
+    void Cleared() { hand = nullptr; }
+
+   private:
+    // Next entry to examine, nullptr to start over from the back
+    IntrusiveList::Link* hand = nullptr;
+  };
+};
+
+#endif  // INCLUDE_EVICTIONPOLICIES_H_
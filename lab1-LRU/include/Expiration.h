@@ -0,0 +1,45 @@
+#ifndef INCLUDE_EXPIRATION_H_
+#define INCLUDE_EXPIRATION_H_
+
+#include <chrono>
+
+/*
+  Expiration modes for EvictingCacheMap.
+
+  With an expiring mode put(key, value, ttl) gives the entry a time-to-live;
+    entries put without one never expire.  Deadlines are kept in a
+    TimerWheel, and expired entries are reclaimed in batches at the start of
+    find(), get() and put(), or explicitly by cleanUp().  No background thread
+    is involved.
+
+  TClock is a type with a static now() returning a std::chrono::time_point
+    whose time_since_epoch() is not negative, like std::chrono::steady_clock.
+    Tests can substitute a manually advanced clock.
+*/
+
+/**
+ * Entries never expire.  Nodes carry no expiration state.
+ */
+struct NoExpiration {};
+
+/**
+ * The time-to-live of an entry starts when it is put into the map and is
+ *     restarted by every put() of the same key.
+ */
+template <class TClock = std::chrono::steady_clock>
+struct ExpireAfterWrite {
+  using Clock = TClock;
+  constexpr static bool RefreshOnAccess = false;
+};
+
+/**
+ * The time-to-live of an entry is restarted by every put() and every hit of
+ *     find() or get(), so only entries which are not used expire.
+ */
+template <class TClock = std::chrono::steady_clock>
+struct ExpireAfterAccess {
+  using Clock = TClock;
+  constexpr static bool RefreshOnAccess = true;
+};
+
+#endif  // INCLUDE_EXPIRATION_H_
@@ -0,0 +1,236 @@
+#ifndef INCLUDE_FRONTCACHEDMAP_H_
+#define INCLUDE_FRONTCACHEDMAP_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "RobinHoodIndex.h"
+#include "ShardedEvictingCacheMap.h"
+
+/**
+ * ShardedEvictingCacheMap with a small direct-mapped cache per thread in
+ *     front of it.  A repeated get() of a key the thread read before is
+ *     served from its own front cache without taking a shard lock or writing
+ *     any shared memory, so hot keys do not bounce the cache lines of their
+ *     entry and of the LRU head between cores.
+ *
+ * Front entries are validated by version stamps: keys hash to one of a
+ *     fixed number of atomic counters, which put() and erase() increment
+ *     once the shared map is updated, and clear() increments a global epoch.
+ *     A front entry records the stamp it was read under and is only used
+ *     while the stamp is unchanged, so once put() or erase() returned, no
+ *     thread reads the previous value from its front cache any more.  Keys
+ *     sharing a counter invalidate each other now and then.
+ *
+ * Hits in a front cache are not reported to the shared map, so a key read
+ *     only from front caches ages in the LRU of its shard and may be evicted
+ *     there; front caches keep serving it until it is overwritten or their
+ *     slot is taken by another key, which never makes a read stale.
+ *
+ * Front caches are allocated by each thread on its first get() and freed
+ *     when the thread exits; those of a destroyed map are freed by the next
+ *     map a thread starts using.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>,
+          class TEvictionPolicy = LruEviction,
+          class TAllocator = std::allocator<std::pair<const TKey, TValue>>,
+          class TStats = NoStats>
+class FrontCachedMap final {
+ public:
+  using Shared = ShardedEvictingCacheMap<TKey, TValue, THash, TKeyEqual,
+                                         TEvictionPolicy, TAllocator, TStats>;
+
+  /**
+   * Construct a FrontCachedMap
+   * @param capacity capacity of the shared map
+   * @param frontSize number of entries of every front cache, rounded up to
+   *     a power of two
+   * @param stampCount number of version stamps, rounded up to a power of two
+   * @param shardCount number of shards of the shared map
+   */
+  explicit FrontCachedMap(
+      std::size_t capacity, std::size_t frontSize = 64,
+      std::size_t stampCount = 4096,
+      std::size_t shardCount = Shared::DefaultShardCount())
+      : shared(capacity, shardCount),
+        frontMask(RoundUp(frontSize) - 1),
+        stampMask(RoundUp(stampCount) - 1),
+        stamps(new std::atomic<std::uint64_t>[stampMask + 1]),
+        id(nextId.fetch_add(1, std::memory_order_relaxed)),
+        alive(std::make_shared<char>()) {
+    for (std::size_t i = 0; i <= stampMask; ++i)
+      stamps[i].store(0, std::memory_order_relaxed);
+  }
+
+  FrontCachedMap(const FrontCachedMap&) = delete;
+  FrontCachedMap& operator=(const FrontCachedMap&) = delete;
+
+  /**
+   * Get a copy of the value associated with a specific key, from the front
+   *     cache of the thread if it has a valid one.
+   * @param key key associated with the value
+   * @return the value if it exists
+   */
+  std::optional<TValue> get(const TKey& key) {
+    const std::uint32_t hash = HashOf(key);
+    const std::uint64_t stamp = StampOf(hash);
+    FrontEntry& entry = Front().entries[hash & frontMask];
+    if (entry.stamp == stamp && entry.key && keyEqual(*entry.key, key))
+      return entry.value;
+
+    // The stamp was read first, so a put() racing with this read makes the
+    // entry outdated rather than leaving a stale value behind a fresh stamp
+    std::optional<TValue> value = shared.get(key);
+    if (value) {
+      entry.key = key;
+      entry.value = *value;
+      entry.stamp = stamp;
+    }
+    return value;
+  }
+
+  /**
+   * getOrLoad() of the shared map, after looking into the front cache.
+   */
+  template <class TLoader>
+  TValue getOrLoad(const TKey& key, TLoader&& loader) {
+    const std::uint32_t hash = HashOf(key);
+    const std::uint64_t stamp = StampOf(hash);
+    FrontEntry& entry = Front().entries[hash & frontMask];
+    if (entry.stamp == stamp && entry.key && keyEqual(*entry.key, key))
+      return *entry.value;
+
+    TValue value = shared.getOrLoad(key, std::forward<TLoader>(loader));
+    entry.key = key;
+    entry.value = value;
+    entry.stamp = stamp;
+    return value;
+  }
+
+  /**
+   * Set a key-value pair in the shared map and invalidate the key in all
+   *     front caches.
+   */
+  template <class T, class E>
+  void put(T&& key, E&& value) {
+    const std::uint32_t hash = HashOf(key);
+    shared.put(std::forward<T>(key), std::forward<E>(value));
+    Invalidate(hash);
+  }
+
+  /**
+   * Erase a key from the shared map and invalidate it in all front caches.
+   * @return true if the key existed in the shared map
+   */
+  bool erase(const TKey& key) {
+    const bool erased = shared.erase(key);
+    Invalidate(HashOf(key));
+    return erased;
+  }
+
+  /**
+   * Remove all entries and invalidate all front caches.
+   */
+  void clear() {
+    shared.clear();
+    epoch.fetch_add(StampEpoch, std::memory_order_acq_rel);
+  }
+
+  std::size_t size() const { return shared.size(); }
+
+  /**
+   * @return the shared map, e.g. for its statistics
+   */
+  const Shared& sharedMap() const { return shared; }
+
+ private:
+  // The epoch and the key's counter are added into one stamp; the epoch
+  // counts in steps no counter reaches in practice
+  constexpr static std::uint64_t StampEpoch = std::uint64_t(1) << 40;
+
+  struct FrontEntry {
+    std::optional<TKey> key;
+    std::optional<TValue> value;
+    std::uint64_t stamp = 0;
+  };
+
+  struct FrontCache {
+    FrontCache(std::size_t size, std::weak_ptr<char> owner)
+        : entries(size), owner(std::move(owner)) {}
+
+    std::vector<FrontEntry> entries;
+    // Expires with the map, so the cache can be freed
+    std::weak_ptr<char> owner;
+  };
+
+  // Front caches of the calling thread by map id
+  using FrontCaches =
+      std::unordered_map<std::uint64_t, std::unique_ptr<FrontCache>>;
+
+  static std::size_t RoundUp(std::size_t n) {
+    std::size_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+  }
+
+  std::uint32_t HashOf(const TKey& key) const {
+    return RobinHoodIndex<std::uint32_t>::Mix(hasher(key));
+  }
+
+  std::uint64_t StampOf(std::uint32_t hash) const {
+    // Stamps use the high bits, front caches the low ones
+    return epoch.load(std::memory_order_acquire) +
+           stamps[(hash >> 16) & stampMask].load(std::memory_order_acquire);
+  }
+
+  void Invalidate(std::uint32_t hash) {
+    stamps[(hash >> 16) & stampMask].fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  FrontCache& Front() {
+    struct Last {
+      std::uint64_t id = 0;
+      FrontCache* cache = nullptr;
+    };
+    thread_local Last last;
+    if (last.cache && last.id == id) return *last.cache;
+
+    thread_local FrontCaches caches;
+    std::unique_ptr<FrontCache>& cache = caches[id];
+    if (!cache) {
+      // Free the caches of maps destroyed since
+      for (auto it = caches.begin(); it != caches.end();) {
+        if (it->second && it->second->owner.expired())
+          it = caches.erase(it);
+        else
+          ++it;
+      }
+      cache = std::make_unique<FrontCache>(frontMask + 1, alive);
+    }
+    last = Last{id, cache.get()};
+    return *cache;
+  }
+
+  // Ids are never reused, unlike addresses
+  static inline std::atomic<std::uint64_t> nextId{1};
+
+  Shared shared;
+  std::size_t frontMask;
+  std::size_t stampMask;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> stamps;
+  std::atomic<std::uint64_t> epoch{0};
+  std::uint64_t id;
+  std::shared_ptr<char> alive;
+  THash hasher;
+  TKeyEqual keyEqual;
+};
+
+#endif  // INCLUDE_FRONTCACHEDMAP_H_
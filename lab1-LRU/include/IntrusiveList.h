@@ -0,0 +1,103 @@
+#ifndef INCLUDE_INTRUSIVELIST_H_
+#define INCLUDE_INTRUSIVELIST_H_
+
+#include <cstddef>
+#include <utility>
+
+/**
+ * Circular doubly linked list of externally owned links.  Elements derive
+ *     from IntrusiveList::Link, the list never allocates and never owns its
+ *     elements.  The front of the list is reached through End()->next and
+ *     the back through End()->prev.
+ */
+class IntrusiveList final {
+ public:
+  struct Link {
+    Link* prev = nullptr;
+    Link* next = nullptr;
+  };
+
+  IntrusiveList() = default;
+
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+  IntrusiveList(IntrusiveList&& other) noexcept { Steal(other); }
+
+  IntrusiveList& operator=(IntrusiveList&& other) noexcept {
+    if (this != &other) Steal(other);
+    return *this;
+  }
+
+  Link* End() { return &head; }
+  const Link* End() const { return &head; }
+  Link* Front() const { return head.next; }
+  Link* Back() const { return head.prev; }
+
+  bool Empty() const { return count == 0; }
+  std::size_t Size() const { return count; }
+
+  void PushFront(Link* link) {
+    Relink(link);
+    ++count;
+  }
+
+  void PushBack(Link* link) { InsertBefore(&head, link); }
+
+  void InsertBefore(Link* position, Link* link) {
+    link->prev = position->prev;
+    link->next = position;
+    position->prev->next = link;
+    position->prev = link;
+    ++count;
+  }
+
+  void Remove(Link* link) {
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    --count;
+  }
+
+  void MoveToFront(Link* link) {
+    if (head.next == link) return;
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    Relink(link);
+  }
+
+  /**
+   * Forget all elements.  The elements themselves are not touched.
+   */
+  void Reset() {
+    head.prev = head.next = &head;
+    count = 0;
+  }
+
+ private:
+  // Link to the front without reading the current front node: the writes to
+  // the neighbours of a moved node usually miss the cache, and a load behind
+  // them would have to wait for those stores.
+  void Relink(Link* link) {
+    link->prev = &head;
+    link->next = head.next;
+    head.next->prev = link;
+    head.next = link;
+  }
+
+  void Steal(IntrusiveList& other) {
+    if (other.Empty()) {
+      Reset();
+    } else {
+      head = other.head;
+      head.next->prev = &head;
+      head.prev->next = &head;
+      count = other.count;
+    }
+    other.Reset();
+  }
+
+  Link head{&head, &head};
+  std::size_t count = 0;
+};
+
+#endif  // INCLUDE_INTRUSIVELIST_H_
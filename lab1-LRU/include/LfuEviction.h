@@ -0,0 +1,174 @@
+#ifndef INCLUDE_LFUEVICTION_H_
+#define INCLUDE_LFUEVICTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+
+#include "EvictionPolicies.h"
+#include "IntrusiveList.h"
+
+/**
+ * Least frequently used, in constant time (Shah, Mitra and Matani).  Entries
+ *     with the same access count share a bucket, an LRU list of its own, and
+ *     the buckets form a list sorted by count.  A hit moves the entry to the
+ *     bucket with the next count, creating it right after the current one if
+ *     needed, and the least recently used entry of the first bucket is
+ *     evicted.  New entries start with a count of one.
+ *
+ * Without aging an entry which was popular once holds on to its place
+ *     forever.  With AgingFactor set, every count is halved (but kept at one
+ *     at least) once AgingFactor times the capacity accesses and insertions
+ *     were recorded, merging the buckets which end up with the same count.
+ *     That pass is linear in the number of entries, constant time per
+ *     access amortized.
+ *
+ * Buckets are recycled, so once the map is full no operation allocates
+ *     memory.  The list of the map is left in insertion order.
+ *
+ * @tparam AgingFactor accesses between two agings, as a multiple of the
+ *     capacity; 0 disables aging
+ */
+template <std::size_t AgingFactor = 0>
+struct LfuEviction {
+  template <class TNode>
+  class Policy {
+    struct Bucket {
+      std::uint32_t count = 0;
+      Bucket* prev = nullptr;
+      Bucket* next = nullptr;
+      PolicyList<TNode> entries;
+    };
+
+   public:
+    struct Hook {
+      TNode* policyPrev = nullptr;
+      TNode* policyNext = nullptr;
+      Bucket* bucket = nullptr;
+    };
+
+    explicit Policy(std::size_t capacity)
+        : agingPeriod(AgingFactor * capacity) {}
+
+    // Copies would point into the buckets of the original
+    Policy(Policy&&) = default;
+    Policy& operator=(Policy&&) = default;
+
+    void Inserted(TNode* node, IntrusiveList&) {
+      Bucket* bucket = first && first->count == 1 ? first : Link(nullptr, 1);
+      node->bucket = bucket;
+      bucket->entries.PushFront(node);
+      Record();
+    }
+
+    void Accessed(TNode* node, IntrusiveList&) {
+      Bucket* bucket = node->bucket;
+      if (bucket->count == std::numeric_limits<std::uint32_t>::max()) {
+        bucket->entries.MoveToFront(node);
+      } else if (bucket->entries.Size() == 1 &&
+                 !(bucket->next && bucket->next->count == bucket->count + 1)) {
+        // The entry has the bucket to itself
+        ++bucket->count;
+      } else {
+        Bucket* next = bucket->next && bucket->next->count == bucket->count + 1
+                           ? bucket->next
+                           : Link(bucket, bucket->count + 1);
+        Detach(node);
+        node->bucket = next;
+        next->entries.PushFront(node);
+      }
+      Record();
+    }
+
+    TNode* Victim(std::uint32_t, IntrusiveList&) {
+      return first->entries.Back();
+    }
+
+    void Removed(TNode* node, IntrusiveList&) { Detach(node); }
+
+    void Cleared() {
+      first = nullptr;
+      spare = nullptr;
+      buckets.clear();
+      accesses = 0;
+    }
+
+    /**
+     * @return number of buckets in use, one per distinct access count
+     */
+    std::size_t BucketCount() const {
+      std::size_t result = 0;
+      for (Bucket* bucket = first; bucket; bucket = bucket->next) ++result;
+      return result;
+    }
+
+   private:
+    // Take a bucket with the given count and put it after `prev`, or first
+    // if `prev` is nullptr
+    Bucket* Link(Bucket* prev, std::uint32_t count) {
+      Bucket* bucket;
+      if (spare) {
+        bucket = spare;
+        spare = spare->next;
+      } else {
+        bucket = &buckets.emplace_back();
+      }
+      bucket->count = count;
+      bucket->prev = prev;
+      bucket->next = prev ? prev->next : first;
+      if (bucket->next) bucket->next->prev = bucket;
+      (prev ? prev->next : first) = bucket;
+      return bucket;
+    }
+
+    void Unlink(Bucket* bucket) {
+      (bucket->prev ? bucket->prev->next : first) = bucket->next;
+      if (bucket->next) bucket->next->prev = bucket->prev;
+      bucket->next = spare;
+      spare = bucket;
+    }
+
+    // Remove a node from its bucket, dropping the bucket once empty
+    void Detach(TNode* node) {
+      Bucket* bucket = node->bucket;
+      bucket->entries.Remove(node);
+      if (bucket->entries.Empty()) Unlink(bucket);
+    }
+
+    void Record() {
+      if (agingPeriod != 0 && ++accesses == agingPeriod) Age();
+    }
+
+    // Halve every count.  Counts stay sorted, so only neighbours can end up
+    // equal; entries of the higher one go in front of the lower one's
+    void Age() {
+      accesses = 0;
+      for (Bucket* bucket = first; bucket;) {
+        Bucket* next = bucket->next;
+        bucket->count = bucket->count > 1 ? bucket->count / 2 : 1;
+        Bucket* prev = bucket->prev;
+        if (prev && prev->count == bucket->count) {
+          while (TNode* node = bucket->entries.Back()) {
+            bucket->entries.Remove(node);
+            node->bucket = prev;
+            prev->entries.PushFront(node);
+          }
+          Unlink(bucket);
+        }
+        bucket = next;
+      }
+    }
+
+    // Lowest count first
+    Bucket* first = nullptr;
+    // Recycled buckets, chained through `next`
+    Bucket* spare = nullptr;
+    // A deque keeps buckets in place as it grows and when the policy moves
+    std::deque<Bucket> buckets;
+    std::size_t agingPeriod;
+    std::size_t accesses = 0;
+  };
+};
+
+#endif  // INCLUDE_LFUEVICTION_H_
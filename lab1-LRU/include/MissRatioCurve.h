@@ -0,0 +1,222 @@
+#ifndef INCLUDE_MISSRATIOCURVE_H_
+#define INCLUDE_MISSRATIOCURVE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "StackDistance.h"
+
+/**
+ * Online estimate of the LRU miss-ratio curve of a reference stream, using
+ *     spatially hashed sampling (SHARDS, Waldspurger et al., FAST '15).
+ *
+ * A reference is sampled if its key hash falls below a threshold, so either
+ *     all or none of the references to a key are seen, at a rate R of the
+ *     hash space.  The stack distances of the sampled references, measured
+ *     among sampled keys only, are scaled by 1/R and collected in a
+ *     histogram with eight buckets per doubling, from which the miss ratio of
+ *     any capacity is read.  As in SHARDS_adj, the estimate is corrected by the
+ *     difference between the expected and the actual number of sampled
+ *     references, which otherwise is dominated by whether the hottest keys
+ *     happen to be sampled.
+ *
+ * At most maxSamples keys are tracked: when another one is sampled, the keys
+ *     with the highest hashes are dropped and the threshold is lowered to
+ *     theirs, and the histogram is rescaled to the new rate.  Memory is
+ *     therefore constant, and references which are not sampled cost a single
+ *     comparison.
+ */
+class MissRatioCurve final {
+ public:
+  constexpr static std::size_t DefaultMaxSamples = 8192;
+  constexpr static double DefaultRate = 0.01;
+
+  /**
+   * Construct a MissRatioCurve
+   * @param maxSamples maximum number of distinct keys tracked
+   * @param rate initial sampling rate in (0, 1], lowered automatically once
+   *     more than maxSamples keys are sampled
+   */
+  explicit MissRatioCurve(std::size_t maxSamples = DefaultMaxSamples,
+                          double rate = DefaultRate)
+      : stack(maxSamples + 1),
+        maxSamples(std::max<std::size_t>(maxSamples, 1)),
+        threshold(ThresholdOf(rate)),
+        inverseRate(1 / Rate()) {}
+
+  /**
+   * Record a reference.
+   * @param hash uniformly distributed 32-bit hash of the key
+   */
+  void Reference(std::uint32_t hash) {
+    total += 1;
+    if ((hash >> HashShift) < threshold) Sample(hash);
+  }
+
+  /**
+   * Estimate the miss ratio of an LRU cache.
+   * @param capacity number of entries of the cache
+   * @return miss ratio in [0, 1], 1 if nothing was sampled yet
+   */
+  double MissRatio(std::size_t capacity) const {
+    if (references <= 0) return 1;
+    // SHARDS_adj: a few hot keys make the number of sampled references
+    // deviate from the expected one.  The difference is attributed to the
+    // smallest distance, so that it changes the hits of every capacity.
+    const double expected = static_cast<double>(total) * Rate();
+    double hits = expected - references;
+    for (std::size_t bucket = 0; bucket < Buckets; ++bucket) {
+      const double low = static_cast<double>(LowerBound(bucket));
+      const double high = static_cast<double>(LowerBound(bucket + 1));
+      const auto c = static_cast<double>(capacity);
+      if (c < low) break;
+      // Distances are assumed to be spread evenly over a bucket
+      hits += histogram[bucket] * std::min(1.0, (c - low + 1) / (high - low));
+    }
+    return std::min(1.0, std::max(0.0, 1 - hits / expected));
+  }
+
+  /**
+   * @param capacity number of entries of the cache
+   * @return estimated hit ratio of an LRU cache
+   */
+  double HitRatio(std::size_t capacity) const {
+    return 1 - MissRatio(capacity);
+  }
+
+  /**
+   * Evaluate the curve at capacities spaced by doubling.
+   * @param maxCapacity largest capacity to report
+   * @return pairs of a capacity and its estimated miss ratio
+   */
+  std::vector<std::pair<std::size_t, double>> Points(
+      std::size_t maxCapacity) const {
+    std::vector<std::pair<std::size_t, double>> points;
+    for (std::size_t capacity = 1; capacity <= maxCapacity; capacity *= 2) {
+      points.emplace_back(capacity, MissRatio(capacity));
+      if (capacity > maxCapacity / 2) break;
+    }
+    return points;
+  }
+
+  /**
+   * @return current sampling rate
+   */
+  double Rate() const {
+    return static_cast<double>(threshold) / static_cast<double>(HashRange);
+  }
+
+  /**
+   * @return number of distinct keys being tracked
+   */
+  std::size_t Samples() const { return stack.Size(); }
+
+  void Clear() {
+    stack.Clear();
+    sampled = {};
+    histogram.fill(0);
+    references = 0;
+    total = 0;
+    last = NoHash;
+  }
+
+ private:
+  // Thresholds compare the upper 24 bits of a hash
+  constexpr static unsigned HashShift = 8;
+  constexpr static std::uint32_t HashRange = std::uint32_t(1) << 24;
+  // Eight buckets per doubling of the distance, enough for 2^48
+  constexpr static unsigned SubBits = 3;
+  constexpr static std::size_t Buckets = (48 - SubBits + 1) << SubBits;
+  // Above every 32-bit hash
+  constexpr static std::uint64_t NoHash = std::uint64_t(1) << 32;
+
+  static std::uint32_t ThresholdOf(double rate) {
+    rate = std::min(std::max(rate, 1.0 / HashRange), 1.0);
+    return static_cast<std::uint32_t>(rate * HashRange);
+  }
+
+  // Buckets 0..7 hold distances 0..7; above that every power of two is split
+  // into eight buckets by the three bits below the highest one
+  static std::size_t BucketOf(std::uint64_t distance) {
+    if (distance < (1u << SubBits)) return static_cast<std::size_t>(distance);
+    // Index of the highest bit, by binary search
+    unsigned exponent = 0;
+    for (unsigned step = 32; step > 0; step /= 2)
+      if (distance >> (exponent + step)) exponent += step;
+    const std::uint64_t sub =
+        (distance >> (exponent - SubBits)) & ((1u << SubBits) - 1);
+    return std::min<std::size_t>(
+        ((exponent - SubBits + 1) << SubBits) + sub, Buckets - 1);
+  }
+
+  static std::uint64_t LowerBound(std::size_t bucket) {
+    if (bucket < (1u << SubBits)) return bucket;
+    const unsigned exponent =
+        static_cast<unsigned>(bucket >> SubBits) + SubBits - 1;
+    const std::uint64_t sub = bucket & ((1u << SubBits) - 1);
+    return (std::uint64_t(1) << exponent) +
+           (sub << (exponent - SubBits));
+  }
+
+  void Sample(std::uint32_t hash) {
+    references += 1;
+    // A hot key sampled by chance makes up most of the sampled references,
+    // and repeating the last one leaves the stack as it is
+    if (hash == last) {
+      histogram[BucketOf(Scaled(1))] += 1;
+      return;
+    }
+    last = hash;
+    const StackDistance::Distance distance = stack.Access(hash);
+    if (distance.entries == StackDistance::Infinite) {
+      sampled.push(hash);
+      if (stack.Size() > maxSamples) LowerThreshold();
+      return;
+    }
+    histogram[BucketOf(Scaled(distance.entries))] += 1;
+  }
+
+  // Distance among the sampled keys scaled to the whole stream
+  std::uint64_t Scaled(std::uint64_t distance) const {
+    return static_cast<std::uint64_t>(static_cast<double>(distance) *
+                                      inverseRate);
+  }
+
+  // Drop the keys with the highest hashes until the sample fits again, and
+  // rescale what was collected at the old rate to the new one
+  void LowerThreshold() {
+    const std::uint32_t previous = threshold;
+    threshold = std::max<std::uint32_t>(sampled.top() >> HashShift, 1);
+    inverseRate = 1 / Rate();
+    while (!sampled.empty() && (sampled.top() >> HashShift) >= threshold) {
+      stack.Remove(sampled.top());
+      sampled.pop();
+    }
+
+    const double scale =
+        static_cast<double>(threshold) / static_cast<double>(previous);
+    for (double& count : histogram) count *= scale;
+    references *= scale;
+  }
+
+  StackDistance stack;
+  // Hashes of the tracked keys, the highest on top
+  std::priority_queue<std::uint32_t> sampled;
+  std::array<double, Buckets> histogram{};
+  // Sampled references, rescaled along with the histogram
+  double references = 0;
+  // All references
+  std::uint64_t total = 0;
+  // Hash of the last sampled reference
+  std::uint64_t last = NoHash;
+  std::size_t maxSamples;
+  std::uint32_t threshold;
+  double inverseRate;
+};
+
+#endif  // INCLUDE_MISSRATIOCURVE_H_
@@ -0,0 +1,178 @@
+#ifndef INCLUDE_NODESLAB_H_
+#define INCLUDE_NODESLAB_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Pool of fixed-size nodes carved out of a few large chunks.  Released nodes
+ *     are kept on a free list and handed out again, so a container whose size
+ *     is bounded stops allocating once it has reached that bound.
+ *
+ * Chunks grow geometrically, each new chunk doubling the number of nodes
+ *     owned by the slab, until the node limit passed at construction is
+ *     reached.  Memory is only returned to the allocator when the slab is
+ *     destroyed.
+ *
+ * TNode must be default constructible and have a `next` pointer member which
+ *     a TNode* can be assigned to; free nodes are chained through it.
+ */
+template <class TNode, class TAllocator>
+class NodeSlab final {
+  using NodeAllocator = typename std::allocator_traits<
+      TAllocator>::template rebind_alloc<TNode>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+  using Chunk = std::pair<TNode*, std::size_t>;
+  using ChunkAllocator = typename std::allocator_traits<
+      TAllocator>::template rebind_alloc<Chunk>;
+
+ public:
+  NodeSlab(std::size_t maxNodes, const TAllocator& allocator)
+      : nodeAllocator(allocator),
+        chunks(ChunkAllocator(allocator)),
+        maxNodes(maxNodes) {}
+
+  NodeSlab(const NodeSlab&) = delete;
+  NodeSlab& operator=(const NodeSlab&) = delete;
+
+  NodeSlab(NodeSlab&& other) noexcept
+      : nodeAllocator(other.nodeAllocator),
+        chunks(std::move(other.chunks)),
+        freeList(std::exchange(other.freeList, nullptr)),
+        fresh(std::exchange(other.fresh, nullptr)),
+        freshEnd(std::exchange(other.freshEnd, nullptr)),
+        allocated(std::exchange(other.allocated, 0)),
+        maxNodes(other.maxNodes) {
+    other.chunks.clear();
+  }
+
+  /**
+   * Take over the chunks of another slab.  Unless the allocator propagates on
+   *     move assignment, both slabs must use equal allocators.
+   */
+  NodeSlab& operator=(NodeSlab&& other) noexcept {
+    if (this != &other) {
+      ReleaseChunks();
+      if constexpr (NodeTraits::propagate_on_container_move_assignment::value)
+        nodeAllocator = other.nodeAllocator;
+      chunks = std::move(other.chunks);
+      freeList = std::exchange(other.freeList, nullptr);
+      fresh = std::exchange(other.fresh, nullptr);
+      freshEnd = std::exchange(other.freshEnd, nullptr);
+      allocated = std::exchange(other.allocated, 0);
+      maxNodes = other.maxNodes;
+      other.chunks.clear();
+    }
+    return *this;
+  }
+
+  ~NodeSlab() { ReleaseChunks(); }
+
+  /**
+   * Take a node from the free list, or construct the next untouched node of
+   *     the newest chunk if it is empty, allocating a new chunk if needed.
+   * @return pointer to a default constructed node
+   */
+  TNode* Acquire() {
+    if (freeList == nullptr) {
+      if (fresh == freshEnd) Grow(NextChunkSize());
+      NodeTraits::construct(nodeAllocator, fresh);
+      return fresh++;
+    }
+    TNode* node = freeList;
+    freeList = static_cast<TNode*>(node->next);
+    return node;
+  }
+
+  /**
+   * Return a node to the free list.  The node must come from this slab and
+   *     must not own a value any more.
+   * @param node node to recycle
+   */
+  void Release(TNode* node) {
+    node->next = freeList;
+    freeList = node;
+  }
+
+  /**
+   * Make sure at least `nodes` nodes are owned by the slab, allocating the
+   *     difference as a single chunk and constructing all its nodes.
+   * @param nodes number of nodes to preallocate
+   */
+  void Reserve(std::size_t nodes) {
+    if (nodes <= allocated) return;
+    Grow(nodes - allocated);
+    ConstructFresh();
+  }
+
+  /**
+   * Change the limit used to size future chunks.  Already allocated chunks
+   *     are kept.
+   * @param nodes new node limit
+   */
+  void SetMaxNodes(std::size_t nodes) { maxNodes = nodes; }
+
+  std::size_t Allocated() const { return allocated; }
+
+  NodeAllocator get_allocator() const { return nodeAllocator; }
+
+ private:
+  std::size_t NextChunkSize() const {
+    const std::size_t wanted = std::max(allocated, MinChunkSize);
+    if (allocated >= maxNodes) return wanted;
+    return std::min(wanted, maxNodes - allocated);
+  }
+
+  // Nodes of a new chunk are only constructed when they are handed out, so
+  // a large chunk is not written all at once.  Only the newest chunk may
+  // have untouched nodes: the rest of the previous one is constructed and
+  // put on the free list first.
+  void Grow(std::size_t count) {
+    chunks.reserve(chunks.size() + 1);
+    TNode* nodes = NodeTraits::allocate(nodeAllocator, count);
+    ConstructFresh();
+    chunks.emplace_back(nodes, count);
+    fresh = nodes;
+    freshEnd = nodes + count;
+    allocated += count;
+  }
+
+  // Construct all untouched nodes and put them on the free list
+  void ConstructFresh() {
+    while (fresh != freshEnd) {
+      NodeTraits::construct(nodeAllocator, fresh);
+      Release(fresh++);
+    }
+  }
+
+  void ReleaseChunks() {
+    for (auto& chunk : chunks) {
+      const bool newest = &chunk == &chunks.back();
+      const std::size_t constructed =
+          newest ? static_cast<std::size_t>(fresh - chunk.first) : chunk.second;
+      for (std::size_t i = 0; i < constructed; ++i)
+        NodeTraits::destroy(nodeAllocator, chunk.first + i);
+      NodeTraits::deallocate(nodeAllocator, chunk.first, chunk.second);
+    }
+    chunks.clear();
+    freeList = nullptr;
+    fresh = freshEnd = nullptr;
+    allocated = 0;
+  }
+
+  constexpr static std::size_t MinChunkSize = 16;
+
+  NodeAllocator nodeAllocator;
+  std::vector<Chunk, ChunkAllocator> chunks;
+  TNode* freeList = nullptr;
+  // Untouched nodes at the end of the newest chunk
+  TNode* fresh = nullptr;
+  TNode* freshEnd = nullptr;
+  std::size_t allocated = 0;
+  std::size_t maxNodes;
+};
+
+#endif  // INCLUDE_NODESLAB_H_
@@ -0,0 +1,282 @@
+#ifndef INCLUDE_READMOSTLYCACHEMAP_H_
+#define INCLUDE_READMOSTLYCACHEMAP_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "EpochReclamation.h"
+#include "RobinHoodIndex.h"
+
+/**
+ * Thread-safe cache for workloads with far more reads than writes.  get()
+ *     and exists() take no lock and are wait-free: entries are immutable
+ *     nodes in chained buckets of atomic pointers, writers replace and
+ *     unlink nodes with single pointer stores, and unlinked nodes are freed
+ *     by epoch-based reclamation once no reader can still see them.  Writers
+ *     serialize on one mutex.
+ *
+ * Recency is approximated instead of kept in a list: every put() or erase()
+ *     advances a clock, a get() copies the clock into the stamp of its node
+ *     unless it is already there, and eviction samples a few entries and
+ *     removes the one with the oldest stamp.  A hot key therefore costs one
+ *     write per writer operation rather than one per read.
+ *
+ * The bucket array is sized for the capacity up front and never grows.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>>
+class ReadMostlyCacheMap final {
+ public:
+  /**
+   * Construct a ReadMostlyCacheMap
+   * @param capacity maximum number of entries
+   * @param sampleSize number of entries compared to pick a victim
+   */
+  explicit ReadMostlyCacheMap(std::size_t capacity, std::size_t sampleSize = 8)
+      : maxSize(capacity),
+        sampleSize(sampleSize),
+        mask(RoundUp(capacity) - 1),
+        buckets(new std::atomic<Node*>[mask + 1]) {
+    if (capacity == 0)
+      throw std::logic_error("Unable to create cache of size 0");
+    if (sampleSize == 0)
+      throw std::logic_error("Unable to sample 0 entries for eviction");
+    for (std::size_t i = 0; i <= mask; ++i)
+      buckets[i].store(nullptr, std::memory_order_relaxed);
+    nodes.reserve(capacity);
+  }
+
+  /**
+   * No reader may use the map while it is destroyed.
+   */
+  ~ReadMostlyCacheMap() {
+    for (Node* node : nodes) delete node;
+    for (const Retired& retired : graveyard) delete retired.node;
+  }
+
+  ReadMostlyCacheMap(const ReadMostlyCacheMap&) = delete;
+  ReadMostlyCacheMap& operator=(const ReadMostlyCacheMap&) = delete;
+
+  /**
+   * Get a copy of the value associated with a specific key and mark the key
+   *     as recently used.
+   * @param key key associated with the value
+   * @return the value if it exists
+   */
+  std::optional<TValue> get(const TKey& key) {
+    const std::uint32_t hash = HashOf(key);
+    EpochReclamation::Guard guard;
+    Node* node = Find(key, hash);
+    if (!node) return std::nullopt;
+    const std::uint64_t now = clock.load(std::memory_order_relaxed);
+    if (node->stamp.load(std::memory_order_relaxed) != now)
+      node->stamp.store(now, std::memory_order_relaxed);
+    return node->value;
+  }
+
+  /**
+   * Check for existence of a specific key without marking it as used.
+   */
+  bool exists(const TKey& key) const {
+    const std::uint32_t hash = HashOf(key);
+    EpochReclamation::Guard guard;
+    return Find(key, hash) != nullptr;
+  }
+
+  /**
+   * Set a key-value pair, evicting a sampled least recently used entry if
+   *     the map is full.  Readers see either the previous or the new value.
+   */
+  template <class T, class E>
+  void put(T&& key, E&& value) {
+    std::unique_ptr<Node> node(
+        new Node(std::forward<T>(key), std::forward<E>(value)));
+    node->hash = HashOf(node->key);
+
+    std::lock_guard<std::mutex> lock(writer);
+    const std::uint64_t now = Tick();
+    node->stamp.store(now, std::memory_order_relaxed);
+    std::atomic<Node*>* link = FindLink(node->key, node->hash);
+    if (Node* old = link->load(std::memory_order_relaxed)) {
+      node->next.store(old->next.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+      node->position = old->position;
+      nodes[old->position] = node.get();
+      link->store(node.release(), std::memory_order_seq_cst);
+      Retire(old);
+    } else {
+      if (nodes.size() == maxSize) {
+        Unlink(Victim());
+        // The victim may have held the link
+        link = FindLink(node->key, node->hash);
+      }
+      node->position = nodes.size();
+      nodes.push_back(node.get());
+      link->store(node.release(), std::memory_order_seq_cst);
+      count.store(nodes.size(), std::memory_order_relaxed);
+    }
+    ReclaimIfNeeded();
+  }
+
+  /**
+   * Erase a key.
+   * @return true if the key existed
+   */
+  bool erase(const TKey& key) {
+    const std::uint32_t hash = HashOf(key);
+    std::lock_guard<std::mutex> lock(writer);
+    Tick();
+    Node* node = FindLink(key, hash)->load(std::memory_order_relaxed);
+    if (!node) return false;
+    Unlink(node);
+    ReclaimIfNeeded();
+    return true;
+  }
+
+  /**
+   * Remove all entries.
+   */
+  void clear() {
+    std::lock_guard<std::mutex> lock(writer);
+    Tick();
+    for (std::size_t i = 0; i <= mask; ++i)
+      buckets[i].store(nullptr, std::memory_order_seq_cst);
+    const std::uint64_t epoch = EpochReclamation::Advance();
+    for (Node* node : nodes) graveyard.push_back({epoch, node});
+    nodes.clear();
+    count.store(0, std::memory_order_relaxed);
+    Reclaim();
+  }
+
+  std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+  std::size_t capacity() const { return maxSize; }
+
+ private:
+  // Unlinked nodes are freed in batches of this size
+  constexpr static std::size_t ReclaimBatch = 64;
+
+  struct Node {
+    template <class T, class E>
+    Node(T&& key, E&& value)
+        : key(std::forward<T>(key)), value(std::forward<E>(value)) {}
+
+    const TKey key;
+    const TValue value;
+    std::uint32_t hash = 0;
+    std::atomic<std::uint64_t> stamp{0};
+    std::atomic<Node*> next{nullptr};
+    // Index in nodes, only used by writers
+    std::size_t position = 0;
+  };
+
+  struct Retired {
+    std::uint64_t epoch;
+    Node* node;
+  };
+
+  static std::size_t RoundUp(std::size_t n) {
+    std::size_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+  }
+
+  std::uint32_t HashOf(const TKey& key) const {
+    return RobinHoodIndex<std::uint32_t>::Mix(hasher(key));
+  }
+
+  Node* Find(const TKey& key, std::uint32_t hash) const {
+    // Sequentially consistent, as required by EpochReclamation
+    for (Node* node = buckets[hash & mask].load(std::memory_order_seq_cst);
+         node; node = node->next.load(std::memory_order_seq_cst)) {
+      if (node->hash == hash && keyEqual(node->key, key)) return node;
+    }
+    return nullptr;
+  }
+
+  // Only for writers: the link pointing to the node of the key, or the null
+  // link at the end of its bucket
+  std::atomic<Node*>* FindLink(const TKey& key, std::uint32_t hash) {
+    std::atomic<Node*>* link = &buckets[hash & mask];
+    for (Node* node; (node = link->load(std::memory_order_relaxed));
+         link = &node->next) {
+      if (node->hash == hash && keyEqual(node->key, key)) break;
+    }
+    return link;
+  }
+
+  std::uint64_t Tick() {
+    const std::uint64_t now = clock.load(std::memory_order_relaxed) + 1;
+    clock.store(now, std::memory_order_relaxed);
+    return now;
+  }
+
+  Node* Victim() {
+    Node* victim = nullptr;
+    for (std::size_t i = 0; i < sampleSize; ++i) {
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      Node* candidate = nodes[random % nodes.size()];
+      if (!victim || candidate->stamp.load(std::memory_order_relaxed) <
+                         victim->stamp.load(std::memory_order_relaxed))
+        victim = candidate;
+    }
+    return victim;
+  }
+
+  void Unlink(Node* node) {
+    FindLink(node->key, node->hash)
+        ->store(node->next.load(std::memory_order_relaxed),
+                std::memory_order_seq_cst);
+    Node* last = nodes.back();
+    last->position = node->position;
+    nodes[node->position] = last;
+    nodes.pop_back();
+    count.store(nodes.size(), std::memory_order_relaxed);
+    Retire(node);
+  }
+
+  void Retire(Node* node) {
+    graveyard.push_back({EpochReclamation::Advance(), node});
+  }
+
+  void ReclaimIfNeeded() {
+    if (graveyard.size() >= ReclaimBatch) Reclaim();
+  }
+
+  // Retired in order of their epochs, so the reclaimable ones are a prefix
+  void Reclaim() {
+    const std::uint64_t pinned = EpochReclamation::MinPinned();
+    std::size_t freed = 0;
+    while (freed < graveyard.size() && graveyard[freed].epoch < pinned)
+      delete graveyard[freed++].node;
+    graveyard.erase(graveyard.begin(), graveyard.begin() + freed);
+  }
+
+  const std::size_t maxSize;
+  const std::size_t sampleSize;
+  const std::size_t mask;
+  std::unique_ptr<std::atomic<Node*>[]> buckets;
+  std::atomic<std::uint64_t> clock{0};
+  std::atomic<std::size_t> count{0};
+
+  // Writer state
+  std::mutex writer;
+  std::vector<Node*> nodes;
+  std::vector<Retired> graveyard;
+  std::uint64_t random = 0x9e3779b97f4a7c15ULL;
+
+  THash hasher;
+  TKeyEqual keyEqual;
+};
+
+#endif  // INCLUDE_READMOSTLYCACHEMAP_H_
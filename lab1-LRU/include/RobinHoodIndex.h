@@ -0,0 +1,383 @@
+#ifndef INCLUDE_ROBINHOODINDEX_H_
+#define INCLUDE_ROBINHOODINDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Open-addressing index from hash values to node handles.  Slots live in a
+ *     single power-of-two sized array and collisions are resolved by linear
+ *     probing with Robin Hood displacement, so a lookup touches one or two
+ *     adjacent cache lines instead of walking a bucket list.  Every slot keeps
+ *     a 32-bit hash fingerprint next to the handle, which lets a probe reject
+ *     non-matching slots without dereferencing the handle.
+ *
+ * The index does not know anything about keys: callers pass the hash and a
+ *     predicate that checks whether a handle refers to the wanted key.  The
+ *     index never grows by itself either, callers are expected to call
+ *     Rehash() before the table gets full.  PrepareRehash(), StartRehash()
+ *     and RehashStep() spread that work over many operations instead: the
+ *     new slot array is initialized piecewise before it is needed, handles
+ *     stay in the old array until they are moved, and lookups check both
+ *     arrays meanwhile.
+ *
+ * Slot storage is obtained from a rebound copy of TAllocator.
+ */
+template <class THandle, class TAllocator = std::allocator<THandle>>
+class RobinHoodIndex final {
+  struct Slot {
+    THandle handle{};
+    std::uint32_t hash = 0;
+    // 0 for an empty slot, otherwise distance from the home bucket plus one
+    std::uint32_t distance = 0;
+  };
+  using SlotAllocator = typename std::allocator_traits<
+      TAllocator>::template rebind_alloc<Slot>;
+  using Slots = std::vector<Slot, SlotAllocator>;
+
+  // A single Robin Hood table.  The index has two of them while it is being
+  // rehashed incrementally.
+  struct Table {
+    Table(std::size_t bucketCount, const SlotAllocator& allocator)
+        : Table(Slots(bucketCount, allocator)) {}
+
+    explicit Table(Slots&& slots)
+        : slots(std::move(slots)),
+          mask(this->slots.empty() ? 0 : this->slots.size() - 1) {}
+
+    Table(const Table&) = default;
+    Table& operator=(const Table&) = default;
+
+    Table(Table&& other) noexcept
+        : slots(std::move(other.slots)), mask(std::exchange(other.mask, 0)) {
+      other.slots.clear();
+    }
+
+    Table& operator=(Table&& other) noexcept {
+      if (this != &other) {
+        slots = std::move(other.slots);
+        mask = std::exchange(other.mask, 0);
+        other.slots.clear();
+      }
+      return *this;
+    }
+
+    template <class TPredicate>
+    std::size_t Find(std::uint32_t hash, TPredicate& matches) const {
+      if (slots.empty()) return npos;
+
+      std::size_t pos = hash & mask;
+      for (std::uint32_t distance = 1;; ++distance) {
+        const Slot& slot = slots[pos];
+        // Either an empty slot or an entry closer to its home than we would
+        // be: Robin Hood ordering guarantees the key is not further away.
+        if (slot.distance < distance) return npos;
+        if (slot.hash == hash && matches(slot.handle)) return pos;
+        pos = (pos + 1) & mask;
+      }
+    }
+
+    void Insert(Slot incoming) {
+      incoming.distance = 1;
+      std::size_t pos = incoming.hash & mask;
+      for (;;) {
+        Slot& slot = slots[pos];
+        if (slot.distance == 0) {
+          slot = std::move(incoming);
+          return;
+        }
+        if (slot.distance < incoming.distance) std::swap(slot, incoming);
+        ++incoming.distance;
+        pos = (pos + 1) & mask;
+      }
+    }
+
+    // Shift the following entries of the probe sequence back, so that no
+    // tombstones are needed
+    void EraseAt(std::size_t pos) {
+      std::size_t next = (pos + 1) & mask;
+      while (slots[next].distance > 1) {
+        slots[pos] = std::move(slots[next]);
+        --slots[pos].distance;
+        pos = next;
+        next = (next + 1) & mask;
+      }
+      slots[pos] = Slot();
+    }
+
+    Slots slots;
+    std::size_t mask;
+  };
+
+ public:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  /**
+   * Scramble a user-provided hash value.  std::hash is the identity for
+   *     integral types, which would put sequential keys into sequential slots
+   *     and make masking by a power of two useless.
+   * @param hash result of the user hash function
+   * @return mixed 32-bit hash suitable for Find/Insert/Erase
+   */
+  static std::uint32_t Mix(std::size_t hash) {
+    std::uint64_t h = static_cast<std::uint64_t>(hash);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<std::uint32_t>(h);
+  }
+
+  explicit RobinHoodIndex(std::size_t bucketCount = 0,
+                          const TAllocator& allocator = TAllocator())
+      : table(RoundUpToPowerOfTwo(bucketCount), SlotAllocator(allocator)),
+        old(0, SlotAllocator(allocator)),
+        prepared(SlotAllocator(allocator)) {}
+
+  RobinHoodIndex(const RobinHoodIndex&) = default;
+  RobinHoodIndex& operator=(const RobinHoodIndex&) = default;
+
+  RobinHoodIndex(RobinHoodIndex&& other) noexcept
+      : table(std::move(other.table)),
+        old(std::move(other.old)),
+        prepared(std::move(other.prepared)),
+        cursor(std::exchange(other.cursor, 0)),
+        count(std::exchange(other.count, 0)) {
+    other.prepared = Slots(prepared.get_allocator());
+  }
+
+  RobinHoodIndex& operator=(RobinHoodIndex&& other) noexcept {
+    if (this != &other) {
+      table = std::move(other.table);
+      old = std::move(other.old);
+      prepared = std::move(other.prepared);
+      other.prepared = Slots(prepared.get_allocator());
+      cursor = std::exchange(other.cursor, 0);
+      count = std::exchange(other.count, 0);
+    }
+    return *this;
+  }
+
+  /**
+   * Find the slot holding a handle.
+   * @param hash mixed hash of the key
+   * @param matches predicate called with candidate handles
+   * @return position of the slot or npos if nothing matched
+   */
+  template <class TPredicate>
+  std::size_t Find(std::uint32_t hash, TPredicate&& matches) const {
+    // Test for a rehash first: a branch on the result of the lookup would be
+    // mispredicted for every other miss.
+    if (!Rehashing()) return table.Find(hash, matches);
+
+    const std::size_t pos = table.Find(hash, matches);
+    if (pos != npos) return pos;
+    const std::size_t oldPos = old.Find(hash, matches);
+    return oldPos == npos ? npos : table.slots.size() + oldPos;
+  }
+
+  /**
+   * Start loading the slot array where a lookup of hash begins, so that
+   *     lookups of many keys can overlap their cache misses.
+   * @param hash mixed hash of the key
+   */
+  void Prefetch(std::uint32_t hash) const {
+    PrefetchSlot(table, hash);
+    if (Rehashing()) PrefetchSlot(old, hash);
+  }
+
+  /**
+   * Find the first handle whose fingerprint matches, without calling a
+   *     predicate.  Meant to prefetch the entry a lookup is going to compare.
+   * @param hash mixed hash of the key
+   * @return the handle, or a value-initialized handle if none matched
+   */
+  THandle Candidate(std::uint32_t hash) const {
+    const std::size_t pos = Find(hash, [](const THandle&) { return true; });
+    return pos == npos ? THandle() : At(pos);
+  }
+
+  THandle& At(std::size_t pos) { return SlotAt(pos).handle; }
+  const THandle& At(std::size_t pos) const { return SlotAt(pos).handle; }
+
+  /**
+   * Insert a handle.  The caller must ensure that no handle with the same key
+   *     is already present and that there is at least one free slot.
+   * @param hash mixed hash of the key
+   * @param handle handle to store
+   */
+  void Insert(std::uint32_t hash, THandle handle) {
+    table.Insert(Slot{std::move(handle), hash, 1});
+    ++count;
+  }
+
+  /**
+   * Remove the slot at the given position.
+   * @param pos position returned by Find()
+   */
+  void EraseAt(std::size_t pos) {
+    if (pos < table.slots.size())
+      table.EraseAt(pos);
+    else
+      old.EraseAt(pos - table.slots.size());
+    --count;
+  }
+
+  /**
+   * Remove a handle if present.
+   * @param hash mixed hash of the key
+   * @param matches predicate called with candidate handles
+   * @return true if a handle was removed
+   */
+  template <class TPredicate>
+  bool Erase(std::uint32_t hash, TPredicate&& matches) {
+    const std::size_t pos = Find(hash, matches);
+    if (pos == npos) return false;
+    EraseAt(pos);
+    return true;
+  }
+
+  /**
+   * Resize the slot array and reinsert all handles at once.  Stored
+   *     fingerprints are reused, so handles are never dereferenced.
+   * @param bucketCount requested number of slots, rounded up to a power of
+   *     two; must be greater than Size()
+   */
+  void Rehash(std::size_t bucketCount) {
+    StartRehash(bucketCount);
+    FinishRehash();
+  }
+
+  /**
+   * Allocate the slot array for a later StartRehash() with the same bucket
+   *     count.  Initializing a large array takes as long as rehashing it, so
+   *     RehashStep() does that piecewise as well.  Does nothing if the array
+   *     would not be larger than the current one.
+   * @param bucketCount requested number of slots, rounded up to a power of
+   *     two
+   */
+  void PrepareRehash(std::size_t bucketCount) {
+    bucketCount = RoundUpToPowerOfTwo(bucketCount);
+    if (bucketCount <= BucketCount() || prepared.capacity() == bucketCount)
+      return;
+    prepared = Slots(prepared.get_allocator());
+    prepared.reserve(bucketCount);
+  }
+
+  /**
+   * Switch to a new slot array, but leave the handles in the old one.  They
+   *     are moved over by RehashStep(), until then lookups check both arrays.
+   *     A rehash which is still in progress is finished first.
+   * @param bucketCount requested number of slots, rounded up to a power of
+   *     two; must be greater than Size()
+   */
+  void StartRehash(std::size_t bucketCount) {
+    FinishRehash();
+    bucketCount = RoundUpToPowerOfTwo(bucketCount);
+    Slots next(prepared.get_allocator());
+    if (prepared.capacity() == bucketCount) next.swap(prepared);
+    next.resize(bucketCount);
+
+    old = std::move(table);
+    table = Table(std::move(next));
+    cursor = 0;
+    if (count == 0) old = Table(0, table.slots.get_allocator());
+  }
+
+  /**
+   * Continue a rehash: initialize part of a prepared slot array and move
+   *     some handles from the old slot array to the new one.
+   * @param handles number of handles to move; at most ten times as many
+   *     empty slots are skipped and eight times as many slots are
+   *     initialized
+   */
+  void RehashStep(std::size_t handles) {
+    if (handles == 0) return;
+    if (prepared.size() < prepared.capacity())
+      prepared.resize(std::min(prepared.capacity(),
+                               prepared.size() + handles * PrepareStep));
+
+    std::size_t emptyVisits = handles * 10;
+    while (cursor < old.slots.size()) {
+      Slot& slot = old.slots[cursor];
+      if (slot.distance == 0) {
+        ++cursor;
+        if (--emptyVisits == 0) return;
+        continue;
+      }
+      if (handles-- == 0) return;
+      // Erasing shifts the rest of the cluster back into the cursor slot.
+      // Slots before the cursor stay empty: they are never shifted into,
+      // since that would need an entry displaced past the cursor.
+      table.Insert(std::move(slot));
+      old.EraseAt(cursor);
+    }
+    old = Table(0, table.slots.get_allocator());
+  }
+
+  /**
+   * @return true while handles are left in the old slot array
+   */
+  bool Rehashing() const { return !old.slots.empty(); }
+
+  /**
+   * @return true if RehashStep() has any work to do
+   */
+  bool RehashPending() const {
+    return Rehashing() || prepared.size() < prepared.capacity();
+  }
+
+  void Clear() {
+    for (auto& slot : table.slots) slot = Slot();
+    old = Table(0, table.slots.get_allocator());
+    count = 0;
+  }
+
+  std::size_t Size() const { return count; }
+  std::size_t BucketCount() const { return table.slots.size(); }
+
+ private:
+  static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+    if (value == 0) return 0;
+    std::size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+  }
+
+  static void PrefetchSlot(const Table& table, std::uint32_t hash) {
+#if defined(__GNUC__)
+    if (!table.slots.empty())
+      __builtin_prefetch(&table.slots[hash & table.mask]);
+#endif
+  }
+
+  Slot& SlotAt(std::size_t pos) {
+    if (pos < table.slots.size()) return table.slots[pos];
+    return old.slots[pos - table.slots.size()];
+  }
+  const Slot& SlotAt(std::size_t pos) const {
+    if (pos < table.slots.size()) return table.slots[pos];
+    return old.slots[pos - table.slots.size()];
+  }
+
+  void FinishRehash() {
+    if (Rehashing()) RehashStep(old.slots.size());
+  }
+
+  constexpr static std::size_t PrepareStep = 8;
+
+  Table table;
+  // Slot array being migrated away from, empty unless rehashing.  Slots
+  // before the cursor have already been moved.
+  Table old;
+  // Slot array for the next rehash, initialized up to its size
+  Slots prepared;
+  std::size_t cursor = 0;
+  std::size_t count = 0;
+};
+
+#endif  // INCLUDE_ROBINHOODINDEX_H_
@@ -0,0 +1,360 @@
+#ifndef INCLUDE_SEGMENTLOG_H_
+#define INCLUDE_SEGMENTLOG_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * How SegmentLog picks the segment to reclaim once all of them are full.
+ */
+enum class SegmentReclamation {
+  // The oldest segment
+  Fifo,
+  // The segment whose records were read least recently
+  Lru
+};
+
+/**
+ * Append-only log of fixed-size records in segment files, used as the file
+ *     tier of a TieredCache.  Keys and values must be trivially copyable and
+ *     are stored as raw bytes.
+ *
+ * Records are appended to the active segment, which is buffered in memory
+ *     and written with a single pwrite() once it is full.  An index in memory
+ *     maps every key to the segment and offset of its latest record;
+ *     overwritten and taken records stay in their segment as garbage until
+ *     it is reclaimed.  When all segments are full, one is reclaimed as a
+ *     whole, chosen by SegmentReclamation, and the keys still pointing into
+ *     it are dropped.  Nothing is compacted or copied.
+ *
+ * Reads use pread().  TakeMany() sorts the records of a batch by position and
+ *     reads neighbouring ones with one call.
+ *
+ * The segment files are created in a directory when the log is constructed,
+ *     truncating files left by an earlier log, and removed when it is
+ *     destroyed: the log is a cache, not a store.  Not thread-safe.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>>
+class SegmentLog final {
+  static_assert(std::is_trivially_copyable_v<TKey> &&
+                    std::is_trivially_copyable_v<TValue>,
+                "SegmentLog stores keys and values as raw bytes");
+
+ public:
+  // A record is the key followed by the value
+  constexpr static std::size_t RecordSize = sizeof(TKey) + sizeof(TValue);
+
+  /**
+   * Construct a SegmentLog
+   * @param directory existing directory for the segment files
+   * @param segmentSize size of a segment in bytes, at least one record and
+   *     at most 4 GiB, the range of a record offset
+   * @param segmentCount number of segments, at least two
+   * @param reclamation which segment to reclaim once all are full
+   */
+  SegmentLog(const std::string& directory, std::size_t segmentSize,
+             std::size_t segmentCount,
+             SegmentReclamation reclamation = SegmentReclamation::Fifo)
+      : recordsPerSegment(RecordsPerSegment(segmentSize)),
+        reclamation(reclamation),
+        buffer(recordsPerSegment * RecordSize) {
+    if (segmentCount < 2)
+      throw std::invalid_argument("SegmentLog needs at least two segments");
+    segments.resize(segmentCount);
+    try {
+      for (std::size_t i = 0; i < segmentCount; ++i) {
+        Segment& segment = segments[i];
+        segment.path = directory + "/segment-" + std::to_string(i) + ".log";
+        segment.fd = ::open(segment.path.c_str(),
+                            O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (segment.fd < 0)
+          throw std::runtime_error("Unable to create " + segment.path);
+        segment.keys.reserve(recordsPerSegment);
+      }
+    } catch (...) {
+      Close();
+      throw;
+    }
+  }
+
+  SegmentLog(const SegmentLog&) = delete;
+  SegmentLog& operator=(const SegmentLog&) = delete;
+
+  ~SegmentLog() { Close(); }
+
+  /**
+   * Append a record, replacing the record of the key if there is one.  May
+   *     write the active segment and reclaim another one.
+   */
+  void Put(const TKey& key, const TValue& value) {
+    if (segments[active].keys.size() == recordsPerSegment) Seal();
+    Segment& segment = segments[active];
+    const auto offset =
+        static_cast<std::uint32_t>(segment.keys.size() * RecordSize);
+    char* record = buffer.data() + offset;
+    std::memcpy(record, &key, sizeof(TKey));
+    std::memcpy(record + sizeof(TKey), &value, sizeof(TValue));
+    segment.keys.push_back(key);
+
+    index.insert_or_assign(
+        key, Location{static_cast<std::uint32_t>(active), offset});
+  }
+
+  /**
+   * Remove a key and return its value, e.g. to move it to a faster tier.
+   * @return the value, nothing if the key is not in the log
+   */
+  std::optional<TValue> Take(const TKey& key) {
+    auto position = index.find(key);
+    if (position == index.end()) return {};
+    const Location location = position->second;
+    char record[RecordSize];
+    Read(location, record, RecordSize);
+    index.erase(position);
+    return Decode(key, record);
+  }
+
+  /**
+   * Take() many keys at once.  Records in the same segment which are at
+   *     most MaxGap bytes apart are read with one pread().
+   * @param first beginning of the range of keys
+   * @param last end of the range of keys
+   * @param out output iterator receiving a std::optional<TValue> per key
+   * @return output iterator past the last value written
+   */
+  template <class TForwardIt, class TOutputIt>
+  TOutputIt TakeMany(TForwardIt first, TForwardIt last, TOutputIt out) {
+    struct Request {
+      Location location;
+      std::size_t slot;
+    };
+    std::vector<std::optional<TValue>> values;
+    std::vector<TKey> keys;
+    std::vector<Request> requests;
+    for (; first != last; ++first) {
+      const TKey& key = *first;
+      values.emplace_back();
+      keys.push_back(key);
+      auto position = index.find(key);
+      if (position == index.end()) continue;
+      requests.push_back(Request{position->second, values.size() - 1});
+      // A key listed twice is only found once
+      index.erase(position);
+    }
+    std::sort(requests.begin(), requests.end(),
+              [](const Request& lhs, const Request& rhs) {
+                return std::make_pair(lhs.location.segment,
+                                      lhs.location.offset) <
+                       std::make_pair(rhs.location.segment,
+                                      rhs.location.offset);
+              });
+
+    std::vector<char> scratch;
+    for (std::size_t begin = 0; begin < requests.size();) {
+      // Extend the run while the next record is close enough
+      const Location start = requests[begin].location;
+      std::size_t end = begin + 1;
+      while (end < requests.size() &&
+             requests[end].location.segment == start.segment &&
+             requests[end].location.offset -
+                     requests[end - 1].location.offset <=
+                 RecordSize + MaxGap)
+        ++end;
+      const std::size_t length =
+          requests[end - 1].location.offset - start.offset + RecordSize;
+      scratch.resize(length);
+      Read(start, scratch.data(), length);
+      for (std::size_t i = begin; i < end; ++i) {
+        const Request& request = requests[i];
+        values[request.slot] =
+            Decode(keys[request.slot],
+                   scratch.data() + request.location.offset - start.offset);
+      }
+      begin = end;
+    }
+    for (auto& value : values) {
+      *out = std::move(value);
+      ++out;
+    }
+    return out;
+  }
+
+  /**
+   * Remove a key if it is in the log.
+   * @return true if it was
+   */
+  bool Erase(const TKey& key) {
+    auto position = index.find(key);
+    if (position == index.end()) return false;
+    index.erase(position);
+    return true;
+  }
+
+  bool Contains(const TKey& key) const { return index.count(key) != 0; }
+
+  /**
+   * @return number of keys in the log
+   */
+  std::size_t Size() const { return index.size(); }
+
+  /**
+   * @return number of pread() calls
+   */
+  std::size_t Reads() const { return reads; }
+
+  /**
+   * @return number of segments written
+   */
+  std::size_t Writes() const { return writes; }
+
+  /**
+   * @return number of segments reclaimed
+   */
+  std::size_t Reclaims() const { return reclaims; }
+
+ private:
+  // Offsets within a segment are 32-bit
+  static std::size_t RecordsPerSegment(std::size_t segmentSize) {
+    const std::size_t records =
+        std::max<std::size_t>(segmentSize / RecordSize, 1);
+    if (static_cast<std::uint64_t>(records) * RecordSize >
+        std::uint64_t(1) << 32)
+      throw std::invalid_argument("SegmentLog segments are at most 4 GiB");
+    return records;
+  }
+
+  // Largest gap between two records TakeMany() reads over instead of issuing
+  // another pread()
+  constexpr static std::size_t MaxGap = 4096;
+
+  struct Location {
+    std::uint32_t segment = 0;
+    std::uint32_t offset = 0;
+  };
+
+  struct Segment {
+    std::string path;
+    int fd = -1;
+    // Keys of the records, in order, to find those left when reclaiming
+    std::vector<TKey> keys;
+    // When it was sealed, or read from for SegmentReclamation::Lru
+    std::uint64_t used = 0;
+    bool sealed = false;
+  };
+
+  using Index = std::unordered_map<TKey, Location, THash, TKeyEqual>;
+
+  // Write the active segment and make another one active, reclaiming one if
+  // none is empty
+  void Seal() {
+    Segment& segment = segments[active];
+    const std::size_t size = segment.keys.size() * RecordSize;
+    std::size_t written = 0;
+    while (written < size) {
+      const ssize_t result =
+          ::pwrite(segment.fd, buffer.data() + written, size - written,
+                   static_cast<off_t>(written));
+      if (result < 0 && errno == EINTR) continue;
+      if (result <= 0)
+        throw std::runtime_error("Unable to write " + segment.path);
+      written += static_cast<std::size_t>(result);
+    }
+    ++writes;
+    segment.sealed = true;
+    segment.used = ++tick;
+
+    std::size_t next = segments.size();
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+      if (!segments[i].sealed) {
+        next = i;
+        break;
+      }
+      if (next == segments.size() || segments[i].used < segments[next].used)
+        next = i;
+    }
+    if (segments[next].sealed) Reclaim(next);
+    active = next;
+  }
+
+  void Reclaim(std::size_t slot) {
+    Segment& segment = segments[slot];
+    for (const TKey& key : segment.keys) {
+      auto position = index.find(key);
+      if (position != index.end() && position->second.segment == slot)
+        index.erase(position);
+    }
+    segment.keys.clear();
+    segment.sealed = false;
+    ++reclaims;
+  }
+
+  void Read(Location location, char* destination, std::size_t length) {
+    Segment& segment = segments[location.segment];
+    if (!segment.sealed) {
+      std::memcpy(destination, buffer.data() + location.offset, length);
+      return;
+    }
+    if (reclamation == SegmentReclamation::Lru) segment.used = ++tick;
+    std::size_t done = 0;
+    while (done < length) {
+      const ssize_t result =
+          ::pread(segment.fd, destination + done, length - done,
+                  static_cast<off_t>(location.offset + done));
+      if (result < 0 && errno == EINTR) continue;
+      if (result <= 0)
+        throw std::runtime_error("Unable to read " + segment.path);
+      done += static_cast<std::size_t>(result);
+    }
+    ++reads;
+  }
+
+  // Value of a record, after checking it belongs to the key
+  TValue Decode(const TKey& key, const char* record) const {
+    TKey stored;
+    std::memcpy(&stored, record, sizeof(TKey));
+    if (!keyEqual(stored, key))
+      throw std::runtime_error("Corrupted segment record");
+    TValue value;
+    std::memcpy(&value, record + sizeof(TKey), sizeof(TValue));
+    return value;
+  }
+
+  void Close() {
+    for (Segment& segment : segments) {
+      if (segment.fd < 0) continue;
+      ::close(segment.fd);
+      ::unlink(segment.path.c_str());
+    }
+  }
+
+  std::size_t recordsPerSegment;
+  SegmentReclamation reclamation;
+  std::vector<Segment> segments;
+  // Contents of the active segment
+  std::vector<char> buffer;
+  std::size_t active = 0;
+  Index index;
+  TKeyEqual keyEqual;
+  // Logical clock ordering seals and reads of segments
+  std::uint64_t tick = 0;
+  std::size_t reads = 0;
+  std::size_t writes = 0;
+  std::size_t reclaims = 0;
+};
+
+#endif  // INCLUDE_SEGMENTLOG_H_
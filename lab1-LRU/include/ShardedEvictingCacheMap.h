@@ -0,0 +1,537 @@
+#ifndef INCLUDE_SHARDEDEVICTINGCACHEMAP_H_
+#define INCLUDE_SHARDEDEVICTINGCACHEMAP_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "EvictingCacheMap.h"
+
+/**
+ * Reads lock their shard exclusively and report the access to the eviction
+ *     policy right away, which keeps the eviction order exact.
+ */
+struct LockedReads {};
+
+/**
+ * Reads lock their shard in shared mode, so they run in parallel with each
+ *     other and with exists() and size(), and record the entry they found
+ *     into one of Stripes lock-free ring buffers of Slots entries per
+ *     shard.  The recorded accesses are replayed against
+ *     the eviction policy in batches: by every operation which locks the
+ *     shard exclusively, and by a reader which found its buffer full and
+ *     gets the lock without waiting.  Records that do not fit into a full
+ *     buffer are dropped, so the eviction order is only approximate.
+ */
+template <unsigned Stripes = 4, unsigned Slots = 32>
+struct BufferedReads {
+  static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0,
+                "Slots must be a power of two");
+  static_assert(Stripes > 0, "Stripes must be positive");
+};
+
+/**
+ * Thread-safe EvictingCacheMap split into independently locked shards.  Keys
+ *     are distributed over the shards by hash, every shard is a separate LRU
+ *     with its own share of the capacity and its own eviction policy state,
+ *     so eviction order is only exact within a shard.
+ *
+ * Iterators are not exposed since they could not outlive the shard lock;
+ *     get() returns a copy of the value instead.
+ *
+ * getOrLoad() computes missing values with at most one load in flight per
+ *     key: concurrent misses of the same key wait for the first one instead
+ *     of repeating an expensive computation.
+ *
+ * With a TStats other than NoStats all shards record into one CacheStats,
+ *     whose per-thread stripes keep threads on different shards from writing
+ *     to the same cache lines.  Latencies are measured inside the shard lock
+ *     and do not include waiting for it.
+ *
+ * Entries removed while a shard is locked are queued, and the thread which
+ *     removed them hands them to the removal listener in one batch after the
+ *     lock is released, so a slow listener delays its caller but never
+ *     blocks other threads on the shard.
+ *
+ * TReads selects how get() reports accesses, LockedReads or BufferedReads.
+ *     With BufferedReads, get() does not record latencies.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>,
+          class TEvictionPolicy = LruEviction,
+          class TAllocator = std::allocator<std::pair<const TKey, TValue>>,
+          class TStats = NoStats, class TReads = LockedReads>
+class ShardedEvictingCacheMap final {
+  using Map =
+      EvictingCacheMap<TKey, TValue, THash, TKeyEqual, TEvictionPolicy,
+                       TAllocator, UnitWeigher, NoExpiration, TStats>;
+
+  template <class K>
+  using IfTransparent =
+      std::enable_if_t<IsTransparent<THash>::value &&
+                       IsTransparent<TKeyEqual>::value &&
+                       !std::is_same_v<K, TKey>>;
+
+  constexpr static std::size_t CacheLineSize = 64;
+  constexpr static bool IsRecording = !std::is_same_v<TStats, NoStats>;
+
+  template <class T>
+  struct ReadBuffering : std::false_type {
+    constexpr static unsigned Stripes = 0;
+    constexpr static unsigned Slots = 0;
+  };
+  template <unsigned S, unsigned N>
+  struct ReadBuffering<BufferedReads<S, N>> : std::true_type {
+    constexpr static unsigned Stripes = S;
+    constexpr static unsigned Slots = N;
+  };
+  constexpr static bool IsBuffered = ReadBuffering<TReads>::value;
+
+  using Mutex =
+      std::conditional_t<IsBuffered, std::shared_mutex, std::mutex>;
+  // Held by readers which do not touch the eviction order
+  using ReadLock = std::conditional_t<IsBuffered, std::shared_lock<Mutex>,
+                                      std::lock_guard<Mutex>>;
+  using Entry = typename Map::const_iterator;
+
+  // Bounded ring of entries found by get(), filled by any number of readers
+  // and drained by the thread holding the shard lock exclusively
+  struct alignas(CacheLineSize) ReadBuffer {
+    constexpr static std::uint32_t Mask = ReadBuffering<TReads>::Slots - 1;
+
+    // @return false if the buffer was full or another reader raced for the
+    //     slot, in which case the access is dropped
+    bool Record(Entry entry) {
+      std::uint32_t tail = writes.load(std::memory_order_relaxed);
+      const std::uint32_t head = reads.load(std::memory_order_acquire);
+      if (tail - head > Mask) return false;
+      if (!writes.compare_exchange_strong(tail, tail + 1,
+                                          std::memory_order_relaxed))
+        return false;
+      slots[tail & Mask].store(entry, std::memory_order_release);
+      return true;
+    }
+
+    template <class TFunction>
+    void Drain(TFunction&& function) {
+      std::uint32_t head = reads.load(std::memory_order_relaxed);
+      const std::uint32_t tail = writes.load(std::memory_order_acquire);
+      for (; head != tail; ++head) {
+        // A reader claimed the slot but did not fill it yet
+        const Entry entry = slots[head & Mask].load(std::memory_order_acquire);
+        if (entry == Entry()) break;
+        slots[head & Mask].store(Entry(), std::memory_order_relaxed);
+        function(entry);
+      }
+      reads.store(head, std::memory_order_release);
+    }
+
+    std::atomic<std::uint32_t> writes{0};
+    std::atomic<std::uint32_t> reads{0};
+    std::array<std::atomic<Entry>, Mask + 1> slots{};
+  };
+  using ReadBuffers = std::array<ReadBuffer, ReadBuffering<TReads>::Stripes>;
+
+  struct Removal {
+    TKey key;
+    TValue value;
+    RemovalCause cause;
+  };
+  using Removals = std::vector<Removal>;
+
+  // A getOrLoad() in flight
+  struct Load {
+    std::shared_future<TValue> result;
+    // Set by a put() or erase() of the key, or clear(), meanwhile; the
+    // loaded value is then older than the map and not inserted
+    bool invalidated = false;
+  };
+
+  // Each shard starts on its own cache line, so threads working on different
+  // shards never write to the same line.
+  struct alignas(CacheLineSize) Shard {
+    Shard(std::size_t capacity, const TAllocator& allocator)
+        : map(capacity, allocator) {}
+
+    mutable Mutex mutex;
+    Map map;
+    ReadBuffers reads;
+    // Keys being loaded by getOrLoad()
+    std::unordered_map<TKey, Load, THash, TKeyEqual> loads;
+    // Entries removed by the operation holding the lock
+    Removals pending;
+  };
+
+  // Holds the lock of a shard and, once it is released, hands the entries
+  // removed meanwhile to the listener
+  class Batch final {
+   public:
+    Batch(const ShardedEvictingCacheMap& owner, Shard& shard)
+        : owner(owner), shard(shard), lock(shard.mutex) {
+      // Before anything is removed, as Map::promote() requires
+      DrainReads(shard);
+    }
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+    ~Batch() {
+      Removals removals;
+      removals.swap(shard.pending);
+      lock.unlock();
+      for (Removal& removal : removals)
+        owner.listener(removal.key, std::move(removal.value), removal.cause);
+    }
+
+   private:
+    const ShardedEvictingCacheMap& owner;
+    Shard& shard;
+    std::unique_lock<Mutex> lock;
+  };
+
+ public:
+  /**
+   * @return the shard count used by default, four per hardware thread
+   */
+  static std::size_t DefaultShardCount() {
+    return std::max(1u, std::thread::hardware_concurrency()) * 4;
+  }
+
+  /**
+   * Construct a ShardedEvictingCacheMap
+   * @param capacity total maximum size, split evenly between the shards
+   * @param shardCount number of shards, rounded up to a power of two and
+   *     reduced if the capacity is too small to give every shard an entry
+   * @param allocator allocator used by every shard
+   */
+  explicit ShardedEvictingCacheMap(std::size_t capacity,
+                                   std::size_t shardCount = DefaultShardCount(),
+                                   const TAllocator& allocator = TAllocator()) {
+    if (capacity == 0)
+      throw std::logic_error("Unable to create cache of size 0");
+    if (shardCount == 0)
+      throw std::logic_error("Unable to create cache with 0 shards");
+
+    std::size_t count = 1;
+    while (count < shardCount) count <<= 1;
+    while (count > capacity) count >>= 1;
+
+    shardBits = 0;
+    while ((std::size_t(1) << shardBits) < count) ++shardBits;
+
+    shards.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      const std::size_t share = capacity / count + (i < capacity % count);
+      shards.emplace_back(std::make_unique<Shard>(share, allocator));
+    }
+    if constexpr (IsRecording)
+      for (std::size_t i = 1; i < count; ++i)
+        shards[i]->map.shareStats(shards[0]->map.statsRecorder());
+  }
+
+  ShardedEvictingCacheMap(const ShardedEvictingCacheMap&) = delete;
+  ShardedEvictingCacheMap& operator=(const ShardedEvictingCacheMap&) = delete;
+
+  /**
+   * Check for existence of a specific key in the map.  This operation has
+   *     no effect on eviction order.
+   * @param key key to search for
+   * @return true if exists, false otherwise
+   */
+  bool exists(const TKey& key) const {
+    const Shard& shard = ShardFor(key);
+    ReadLock lock(shard.mutex);
+    return shard.map.exists(key);
+  }
+
+  /**
+   * Heterogeneous exists(), available if lookups are transparent.
+   */
+  template <class K, class = IfTransparent<K>>
+  bool exists(const K& key) const {
+    const Shard& shard = ShardFor(key);
+    ReadLock lock(shard.mutex);
+    return shard.map.exists(key);
+  }
+
+  /**
+   * Get a copy of the value associated with a specific key.  A found value
+   *     is reported as accessed to the eviction policy of its shard.
+   * @param key key associated with the value
+   * @return the value if it exists
+   */
+  std::optional<TValue> get(const TKey& key) {
+    Shard& shard = ShardFor(key);
+    if constexpr (IsBuffered) return BufferedGet(shard, key);
+    std::lock_guard<Mutex> lock(shard.mutex);
+    return shard.map.get(key);
+  }
+
+  /**
+   * Heterogeneous get(), available if lookups are transparent.
+   */
+  template <class K, class = IfTransparent<K>>
+  std::optional<TValue> get(const K& key) {
+    Shard& shard = ShardFor(key);
+    if constexpr (IsBuffered) return BufferedGet(shard, key);
+    std::lock_guard<Mutex> lock(shard.mutex);
+    return shard.map.get(key);
+  }
+
+  /**
+   * Erase the key-value pair associated with key if it exists.
+   * @param key key associated with the value
+   * @return true if the key existed and was erased, else false
+   */
+  bool erase(const TKey& key) {
+    Shard& shard = ShardFor(key);
+    Batch batch(*this, shard);
+    InvalidateLoad(shard, key);
+    return shard.map.erase(key);
+  }
+
+  /**
+   * Heterogeneous erase(), available if lookups are transparent.
+   */
+  template <class K, class = IfTransparent<K>>
+  bool erase(const K& key) {
+    Shard& shard = ShardFor(key);
+    Batch batch(*this, shard);
+    InvalidateLoad(shard, key);
+    return shard.map.erase(key);
+  }
+
+  /**
+   * Set a key-value pair in the dictionary
+   * @param key key to associate with value
+   * @param value value to associate with the key
+   */
+  template <class T, class E>
+  void put(T&& key, E&& value) {
+    Shard& shard = ShardFor(key);
+    Batch batch(*this, shard);
+    InvalidateLoad(shard, key);
+    shard.map.put(std::forward<T>(key), std::forward<E>(value));
+  }
+
+  /**
+   * Get the value associated with a key, loading and inserting it on a miss.
+   *     Only one load of a key is in flight at a time: callers missing a key
+   *     which is already being loaded block until that load completes and
+   *     share its result.  The loader runs without any lock held.
+   *
+   * If the loader throws, nothing is inserted, the exception is rethrown to
+   *     the loading caller and all its waiters, and the next call loads the
+   *     key again.  If the key is put or erased, or the map cleared, while
+   *     it is loading, the loaded value is still returned to the caller and
+   *     its waiters but not inserted, so it neither overwrites the newer
+   *     value nor undoes an invalidation.  The loader must not call
+   *     getOrLoad() for the same key, which would wait for itself.
+   * @param key key associated with the value
+   * @param loader callable invoked as loader(key) to compute a missing value
+   * @return the cached or loaded value
+   */
+  template <class TLoader>
+  TValue getOrLoad(const TKey& key, TLoader&& loader) {
+    Shard& shard = ShardFor(key);
+    std::promise<TValue> promise;
+    {
+      std::unique_lock<Mutex> lock(shard.mutex);
+      if (auto value = shard.map.get(key)) return std::move(*value);
+
+      auto load = shard.loads.find(key);
+      if (load != shard.loads.end()) {
+        std::shared_future<TValue> result = load->second.result;
+        lock.unlock();
+        return result.get();
+      }
+      shard.loads.emplace(key, Load{promise.get_future().share()});
+    }
+
+    std::optional<TValue> value;
+    try {
+      value.emplace(std::forward<TLoader>(loader)(key));
+    } catch (...) {
+      {
+        std::lock_guard<Mutex> lock(shard.mutex);
+        shard.loads.erase(key);
+      }
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+
+    {
+      Batch batch(*this, shard);
+      auto load = shard.loads.find(key);
+      const bool invalidated = load->second.invalidated;
+      shard.loads.erase(load);
+      if (!invalidated) shard.map.put(key, *value);
+    }
+    promise.set_value(*value);
+    return std::move(*value);
+  }
+
+  /**
+   * Get the number of elements.  Shards are locked one after another, so the
+   *     result is only a snapshot if other threads modify the map.
+   * @return the size of the dictionary
+   */
+  std::size_t size() const {
+    std::size_t result = 0;
+    for (const auto& shard : shards) {
+      ReadLock lock(shard->mutex);
+      result += shard->map.size();
+    }
+    return result;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  void clear() {
+    for (auto& shard : shards) {
+      Batch batch(*this, *shard);
+      for (auto& load : shard->loads) load.second.invalidated = true;
+      shard->map.clear();
+    }
+  }
+
+  /**
+   * Register a function called with every entry that leaves the map, see
+   *     EvictingCacheMap::setRemovalListener().  Removals are delivered in
+   *     batches by the thread which caused them after it released the shard
+   *     lock, so the listener may be called by several threads at once and
+   *     may use the map.  Must not be called while other threads use the map.
+   * @param removalListener the listener, an empty function to remove it
+   */
+  void setRemovalListener(typename Map::RemovalListener removalListener) {
+    listener = std::move(removalListener);
+    for (auto& shard : shards) {
+      std::lock_guard<Mutex> lock(shard->mutex);
+      if (listener) {
+        Removals& pending = shard->pending;
+        shard->map.setRemovalListener(
+            [&pending](const TKey& key, TValue&& value, RemovalCause cause) {
+              pending.push_back(Removal{key, std::move(value), cause});
+            });
+      } else {
+        shard->map.setRemovalListener(nullptr);
+      }
+    }
+  }
+
+  std::size_t shardCount() const { return shards.size(); }
+
+  /**
+   * Take a snapshot of the statistics of all shards.  Only available if
+   *     TStats keeps any.  No shard is locked.
+   */
+  CacheStatsSnapshot stats() const {
+    static_assert(IsRecording, "stats() needs a statistics mode");
+    return shards[0]->map.statsRecorder()->Snapshot();
+  }
+
+  void resetStats() {
+    static_assert(IsRecording, "resetStats() needs a statistics mode");
+    shards[0]->map.statsRecorder()->Reset();
+  }
+
+ private:
+  template <class K>
+  std::optional<TValue> BufferedGet(Shard& shard, const K& key) {
+    std::optional<TValue> value;
+    bool recorded;
+    {
+      std::shared_lock<Mutex> lock(shard.mutex);
+      const Entry entry = shard.map.findWithoutPromotion(key);
+      if (entry == shard.map.cend()) {
+        if constexpr (IsRecording)
+          shard.map.statsRecorder()->Add(CacheStats::Counter::Misses);
+        return value;
+      }
+      value.emplace(entry->second);
+      recorded = shard.reads[ReadStripe()].Record(entry);
+    }
+    if constexpr (IsRecording)
+      shard.map.statsRecorder()->Add(CacheStats::Counter::Hits);
+
+    // The buffer is full: drain it unless another thread holds the lock,
+    // which then drains it when it is done
+    if (!recorded) {
+      std::unique_lock<Mutex> lock(shard.mutex, std::try_to_lock);
+      if (lock) DrainReads(shard);
+    }
+    return value;
+  }
+
+  // Keep a getOrLoad() of the key in flight from inserting its value, with
+  // the shard locked
+  template <class K>
+  static void InvalidateLoad(Shard& shard, const K& key) {
+    if (shard.loads.empty()) return;
+    if constexpr (std::is_convertible_v<const K&, TKey>) {
+      auto load = shard.loads.find(key);
+      if (load != shard.loads.end()) load->second.invalidated = true;
+    } else {
+      // Heterogeneous lookup in unordered_map needs C++20
+      for (auto& load : shard.loads)
+        if (shard.loads.key_eq()(load.first, key))
+          load.second.invalidated = true;
+    }
+  }
+
+  // Replay the accesses recorded by get(), with the shard locked exclusively
+  static void DrainReads([[maybe_unused]] Shard& shard) {
+    if constexpr (IsBuffered)
+      for (ReadBuffer& buffer : shard.reads)
+        buffer.Drain([&shard](Entry entry) { shard.map.promote(entry); });
+  }
+
+  // Threads are spread over the read buffers round-robin on their first read
+  static std::size_t ReadStripe() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t stripe =
+        next.fetch_add(1, std::memory_order_relaxed) %
+        ReadBuffering<TReads>::Stripes;
+    return stripe;
+  }
+
+  // Shards are picked by the top bits of a multiplicative hash, which are
+  // independent of the low bits the per-shard index uses.
+  template <class K>
+  std::size_t ShardIndex(const K& key) const {
+    if (shardBits == 0) return 0;
+    const std::uint64_t hash =
+        static_cast<std::uint64_t>(hasher(key)) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<std::size_t>(hash >> (64 - shardBits));
+  }
+
+  template <class K>
+  Shard& ShardFor(const K& key) {
+    return *shards[ShardIndex(key)];
+  }
+  template <class K>
+  const Shard& ShardFor(const K& key) const {
+    return *shards[ShardIndex(key)];
+  }
+
+  std::vector<std::unique_ptr<Shard>> shards;
+  unsigned shardBits;
+  THash hasher;
+  typename Map::RemovalListener listener;
+};
+
+#endif  // INCLUDE_SHARDEDEVICTINGCACHEMAP_H_
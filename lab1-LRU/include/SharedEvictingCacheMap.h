@@ -0,0 +1,468 @@
+#ifndef INCLUDE_SHAREDEVICTINGCACHEMAP_H_
+#define INCLUDE_SHAREDEVICTINGCACHEMAP_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RobinHoodIndex.h"
+
+/**
+ * Fixed-capacity LRU cache living in a file mapped into memory, shared by
+ *     all processes which open the same path.  Put the file on a memory
+ *     filesystem such as /dev/shm to share memory only, e.g. one cache for
+ *     all worker processes of a host instead of one per process.
+ *
+ * The mapping may have another address in every process, so the structure
+ *     holds no pointers: nodes live in an arena allocated when the file is
+ *     created and refer to each other by their index in it.  Like
+ *     ShardedEvictingCacheMap the cache is split into shards by hash, each
+ *     with its own lock, LRU list, hash chains and share of the arena, so
+ *     eviction order is exact within a shard only.
+ *
+ * Shards are locked with robust process-shared mutexes.  If a process dies
+ *     while holding one, the next process to lock it can not tell how far
+ *     the dead one got, so it empties the shard and carries on; for a cache
+ *     losing entries is always safe.
+ *
+ * Keys and values must be trivially copyable and are copied in and out.
+ *     Every process has to use the same key and value types, hash function
+ *     and layout parameters; the sizes and parameters are checked when the
+ *     file is opened.  The file stays until remove() is called.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>>
+class SharedEvictingCacheMap final {
+  static_assert(std::is_trivially_copyable_v<TKey> &&
+                    std::is_trivially_copyable_v<TValue>,
+                "SharedEvictingCacheMap copies keys and values as bytes");
+
+ public:
+  /**
+   * Open a shared cache, creating and initializing its file if it does not
+   *     exist.  If another process is creating it at the same time, wait
+   *     for it to finish.  Opening is serialized by flock() on the file, so
+   *     a file left behind half initialized by a process which died while
+   *     creating it is initialized again.
+   * @param path path of the file
+   * @param capacity maximum number of entries
+   * @param shardCount number of independently locked shards
+   */
+  SharedEvictingCacheMap(const std::string& path, std::size_t capacity,
+                         std::size_t shardCount = 16) {
+    if (capacity == 0 || capacity > Npos)
+      throw std::invalid_argument("Unsupported capacity");
+    shardCount = std::clamp<std::size_t>(shardCount, 1, capacity);
+    const Layout layout(capacity, shardCount);
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) throw std::runtime_error("Unable to open " + path);
+    // Released explicitly, since the mapping keeps the open file alive, or
+    // when the process dies
+    while (::flock(fd, LOCK_EX) != 0) {
+      if (errno != EINTR) {
+        ::close(fd);
+        throw std::runtime_error("Unable to lock " + path);
+      }
+    }
+
+    offsets = layout;
+    shards = shardCount;
+    nodesPerShard = layout.nodesPerShard;
+    bucketMask = layout.bucketsPerShard - 1;
+    try {
+      if (IsReady(fd)) {
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+          throw std::runtime_error("Unable to stat " + path);
+        if (static_cast<std::size_t>(status.st_size) != layout.size)
+          throw std::runtime_error(path + " was created with other parameters");
+        MapFile(fd, layout.size, path);
+        CheckHeader(capacity, path);
+      } else {
+        // New, or its creator died: nobody else uses it, start from zeros
+        if (::ftruncate(fd, 0) != 0 ||
+            ::ftruncate(fd, static_cast<off_t>(layout.size)) != 0)
+          throw std::runtime_error("Unable to size " + path);
+        MapFile(fd, layout.size, path);
+        Initialize(capacity);
+      }
+    } catch (...) {
+      ::flock(fd, LOCK_UN);
+      ::close(fd);
+      throw;
+    }
+    ::flock(fd, LOCK_UN);
+    ::close(fd);
+  }
+
+  SharedEvictingCacheMap(const SharedEvictingCacheMap&) = delete;
+  SharedEvictingCacheMap& operator=(const SharedEvictingCacheMap&) = delete;
+
+  // Unmaps the file; the cache and its entries stay for other processes
+  ~SharedEvictingCacheMap() { ::munmap(base, mappedSize); }
+
+  /**
+   * Delete the file of a cache.  Processes which have it open keep using
+   *     it, new ones create another one.
+   */
+  static void remove(const std::string& path) { ::unlink(path.c_str()); }
+
+  /**
+   * Check for existence of a specific key in the map.  This operation has
+   *     no effect on eviction order.
+   */
+  bool exists(const TKey& key) const {
+    const std::uint32_t hash = HashOf(key);
+    const std::size_t shard = ShardOf(hash);
+    Lock lock(*this, shard);
+    return Find(shard, hash, key) != Npos;
+  }
+
+  /**
+   * Get a copy of the value associated with a specific key, promoting it to
+   *     the head of the LRU of its shard.
+   * @return the value if it exists
+   */
+  std::optional<TValue> get(const TKey& key) {
+    const std::uint32_t hash = HashOf(key);
+    const std::size_t shard = ShardOf(hash);
+    Lock lock(*this, shard);
+    const std::uint32_t found = Find(shard, hash, key);
+    if (found == Npos) return {};
+    Unlink(shard, found);
+    PushFront(shard, found);
+    return NodeAt(shard, found).value;
+  }
+
+  /**
+   * Set a key-value pair, evicting the least recently used entry of the
+   *     shard if it is full.
+   */
+  void put(const TKey& key, const TValue& value) {
+    const std::uint32_t hash = HashOf(key);
+    const std::size_t shard = ShardOf(hash);
+    Lock lock(*this, shard);
+    std::uint32_t node = Find(shard, hash, key);
+    if (node != Npos) {
+      NodeAt(shard, node).value = value;
+      Unlink(shard, node);
+      PushFront(shard, node);
+      return;
+    }
+
+    ShardState& state = StateAt(shard);
+    if (state.free != Npos) {
+      node = state.free;
+      state.free = NodeAt(shard, node).next;
+      ++state.size;
+    } else {
+      node = state.back;
+      Unlink(shard, node);
+      Unchain(shard, node);
+    }
+    Node& target = NodeAt(shard, node);
+    target.hash = hash;
+    target.key = key;
+    target.value = value;
+    std::uint32_t& bucket = BucketAt(shard, hash);
+    target.chain = bucket;
+    bucket = node;
+    PushFront(shard, node);
+  }
+
+  /**
+   * Erase the key-value pair associated with key if it exists.
+   * @return true if the key existed and was erased, else false
+   */
+  bool erase(const TKey& key) {
+    const std::uint32_t hash = HashOf(key);
+    const std::size_t shard = ShardOf(hash);
+    Lock lock(*this, shard);
+    const std::uint32_t node = Find(shard, hash, key);
+    if (node == Npos) return false;
+    Unlink(shard, node);
+    Unchain(shard, node);
+    ShardState& state = StateAt(shard);
+    NodeAt(shard, node).next = state.free;
+    state.free = node;
+    --state.size;
+    return true;
+  }
+
+  /**
+   * @return number of entries, locking the shards one after another
+   */
+  std::size_t size() const {
+    std::size_t total = 0;
+    for (std::size_t shard = 0; shard < shards; ++shard) {
+      Lock lock(*this, shard);
+      total += StateAt(shard).size;
+    }
+    return total;
+  }
+
+  /**
+   * @return the number of entries the shards can hold together, which may
+   *     be a little more than the requested capacity
+   */
+  std::size_t capacity() const { return nodesPerShard * shards; }
+
+  void clear() {
+    for (std::size_t shard = 0; shard < shards; ++shard) {
+      Lock lock(*this, shard);
+      Reset(shard);
+    }
+  }
+
+ private:
+  constexpr static std::uint32_t Npos = 0xffffffff;
+  constexpr static std::uint64_t Magic = 0x50414d454843414eULL;
+  constexpr static std::uint32_t Version = 1;
+  constexpr static std::size_t CacheLineSize = 64;
+
+  struct Header {
+    std::uint64_t magic;
+    std::uint32_t version;
+    // Set by the creator once everything else is initialized, read with
+    // pread() by the next process to open the file
+    std::atomic<std::uint32_t> ready;
+    std::uint64_t keySize;
+    std::uint64_t valueSize;
+    std::uint64_t capacity;
+    std::uint64_t shardCount;
+  };
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+                "The ready flag must work across processes");
+
+  // Per-shard state, each on its own cache line
+  struct alignas(CacheLineSize) ShardState {
+    pthread_mutex_t mutex;
+    std::uint32_t size;
+    // Head of the list of unused nodes, linked through next
+    std::uint32_t free;
+    // Most and least recently used nodes
+    std::uint32_t front;
+    std::uint32_t back;
+  };
+
+  struct Node {
+    std::uint32_t prev;
+    std::uint32_t next;
+    // Next node in the same hash bucket
+    std::uint32_t chain;
+    std::uint32_t hash;
+    TKey key;
+    TValue value;
+  };
+
+  // The file is a Header, the ShardStates, then the buckets and nodes of
+  // every shard
+  struct Layout {
+    Layout() = default;
+    Layout(std::size_t capacity, std::size_t shardCount) {
+      nodesPerShard = (capacity + shardCount - 1) / shardCount;
+      bucketsPerShard = 1;
+      while (bucketsPerShard < nodesPerShard) bucketsPerShard *= 2;
+      states = Align(sizeof(Header), alignof(ShardState));
+      buckets = states + shardCount * sizeof(ShardState);
+      shardBuckets = bucketsPerShard * sizeof(std::uint32_t);
+      nodes = Align(buckets + shardCount * shardBuckets, alignof(Node));
+      size = nodes + shardCount * nodesPerShard * sizeof(Node);
+    }
+
+    static std::size_t Align(std::size_t offset, std::size_t alignment) {
+      return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    std::size_t nodesPerShard = 0;
+    std::size_t bucketsPerShard = 0;
+    std::size_t states = 0;
+    std::size_t buckets = 0;
+    std::size_t shardBuckets = 0;
+    std::size_t nodes = 0;
+    std::size_t size = 0;
+  };
+
+  class Lock {
+   public:
+    Lock(const SharedEvictingCacheMap& owner, std::size_t shard)
+        : mutex(&owner.StateAt(shard).mutex) {
+      const int result = ::pthread_mutex_lock(mutex);
+      if (result == EOWNERDEAD) {
+        // The previous owner died inside an update
+        const_cast<SharedEvictingCacheMap&>(owner).Reset(shard);
+        ::pthread_mutex_consistent(mutex);
+      } else if (result != 0) {
+        throw std::runtime_error("Unable to lock a shard");
+      }
+    }
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+    ~Lock() { ::pthread_mutex_unlock(mutex); }
+
+   private:
+    pthread_mutex_t* mutex;
+  };
+
+  // Check the ready flag of the header, with the file locked
+  static bool IsReady(int fd) {
+    std::uint32_t ready = 0;
+    const ssize_t done = ::pread(fd, &ready, sizeof(ready),
+                                 static_cast<off_t>(offsetof(Header, ready)));
+    return done == static_cast<ssize_t>(sizeof(ready)) && ready != 0;
+  }
+
+  void CheckHeader(std::size_t capacity, const std::string& path) {
+    const Header& header = GetHeader();
+    std::string error;
+    if (header.magic != Magic || header.version != Version)
+      error = path + " is not a shared cache";
+    else if (header.keySize != sizeof(TKey) ||
+             header.valueSize != sizeof(TValue) ||
+             header.capacity != capacity || header.shardCount != shards)
+      error = path + " was created with other parameters";
+    if (!error.empty()) {
+      ::munmap(base, mappedSize);
+      throw std::runtime_error(error);
+    }
+  }
+
+  void MapFile(int fd, std::size_t size, const std::string& path) {
+    void* mapped =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) throw std::runtime_error("Unable to map " + path);
+    base = static_cast<char*>(mapped);
+    mappedSize = size;
+  }
+
+  void Initialize(std::size_t capacity) {
+    Header* header = new (base) Header{};
+    header->magic = Magic;
+    header->version = Version;
+    header->keySize = sizeof(TKey);
+    header->valueSize = sizeof(TValue);
+    header->capacity = capacity;
+    header->shardCount = shards;
+
+    pthread_mutexattr_t attributes;
+    ::pthread_mutexattr_init(&attributes);
+    ::pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    ::pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    for (std::size_t shard = 0; shard < shards; ++shard) {
+      ShardState* state = new (&StateAt(shard)) ShardState{};
+      ::pthread_mutex_init(&state->mutex, &attributes);
+      Reset(shard);
+    }
+    ::pthread_mutexattr_destroy(&attributes);
+    header->ready.store(1, std::memory_order_release);
+  }
+
+  // Empty a shard, with its lock held
+  void Reset(std::size_t shard) {
+    ShardState& state = StateAt(shard);
+    state.size = 0;
+    state.front = state.back = Npos;
+    std::fill_n(&BucketAt(shard, 0), bucketMask + 1, Npos);
+    const auto count = static_cast<std::uint32_t>(nodesPerShard);
+    for (std::uint32_t node = 0; node < count; ++node)
+      NodeAt(shard, node).next = node + 1 < count ? node + 1 : Npos;
+    state.free = 0;
+  }
+
+  std::uint32_t Find(std::size_t shard, std::uint32_t hash,
+                     const TKey& key) const {
+    std::uint32_t node = BucketAt(shard, hash);
+    while (node != Npos) {
+      const Node& candidate = NodeAt(shard, node);
+      if (candidate.hash == hash && keyEqual(candidate.key, key)) return node;
+      node = candidate.chain;
+    }
+    return Npos;
+  }
+
+  // Remove a node from its hash chain
+  void Unchain(std::size_t shard, std::uint32_t node) {
+    std::uint32_t* link = &BucketAt(shard, NodeAt(shard, node).hash);
+    while (*link != node) link = &NodeAt(shard, *link).chain;
+    *link = NodeAt(shard, node).chain;
+  }
+
+  void Unlink(std::size_t shard, std::uint32_t node) {
+    ShardState& state = StateAt(shard);
+    Node& target = NodeAt(shard, node);
+    if (target.prev != Npos)
+      NodeAt(shard, target.prev).next = target.next;
+    else
+      state.front = target.next;
+    if (target.next != Npos)
+      NodeAt(shard, target.next).prev = target.prev;
+    else
+      state.back = target.prev;
+  }
+
+  void PushFront(std::size_t shard, std::uint32_t node) {
+    ShardState& state = StateAt(shard);
+    Node& target = NodeAt(shard, node);
+    target.prev = Npos;
+    target.next = state.front;
+    if (state.front != Npos)
+      NodeAt(shard, state.front).prev = node;
+    else
+      state.back = node;
+    state.front = node;
+  }
+
+  std::uint32_t HashOf(const TKey& key) const {
+    return RobinHoodIndex<std::uint32_t>::Mix(hasher(key));
+  }
+
+  // The shard comes from the high bits of the hash, the bucket from the low
+  // ones
+  std::size_t ShardOf(std::uint32_t hash) const {
+    return static_cast<std::size_t>((std::uint64_t(hash) * shards) >> 32);
+  }
+
+  Header& GetHeader() const { return *reinterpret_cast<Header*>(base); }
+
+  ShardState& StateAt(std::size_t shard) const {
+    return reinterpret_cast<ShardState*>(base + offsets.states)[shard];
+  }
+
+  std::uint32_t& BucketAt(std::size_t shard, std::uint32_t hash) const {
+    auto* buckets = reinterpret_cast<std::uint32_t*>(
+        base + offsets.buckets + shard * offsets.shardBuckets);
+    return buckets[hash & bucketMask];
+  }
+
+  Node& NodeAt(std::size_t shard, std::uint32_t node) const {
+    auto* nodes = reinterpret_cast<Node*>(base + offsets.nodes);
+    return nodes[shard * nodesPerShard + node];
+  }
+
+  char* base = nullptr;
+  std::size_t mappedSize = 0;
+  Layout offsets;
+  std::size_t shards = 0;
+  std::size_t nodesPerShard = 0;
+  std::size_t bucketMask = 0;
+  THash hasher;
+  TKeyEqual keyEqual;
+};
+
+#endif  // INCLUDE_SHAREDEVICTINGCACHEMAP_H_
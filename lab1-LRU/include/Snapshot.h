@@ -0,0 +1,414 @@
+#ifndef INCLUDE_SNAPSHOT_H_
+#define INCLUDE_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "EvictingCacheMap.h"
+
+/*
+  Binary snapshots of an EvictingCacheMap, written by SaveSnapshot() and
+    read back by LoadSnapshot().  They live in this header rather than in
+    EvictingCacheMap.h, so only the users of snapshots depend on the POSIX
+    file and mapping calls.
+
+  A snapshot is a SnapshotHeader followed by one record per entry, from the
+    least to the most recently used one.  A record is the key and the value
+    as written by their serializers, then for maps with an expiration mode
+    the time-to-live and the time left of the entry in nanoseconds.  Numbers
+    are stored in native byte order, so a snapshot is only meant to be
+    reloaded on the same kind of machine, e.g. by the next version of the
+    process after a restart.
+
+  A serializer for T is a type with
+
+    static void Write(SnapshotWriter& out, const T& value);
+    static T Read(SnapshotReader& in);
+
+    and, if every value takes the same number of bytes, a
+    `static constexpr std::size_t Size` with that number.  Serializer<T>
+    covers trivially copyable types, which are copied byte for byte, and
+    std::string; other types need a specialization of Serializer or a
+    serializer passed to SaveSnapshot() and LoadSnapshot().
+*/
+
+struct SnapshotHeader {
+  constexpr static char ExpectedMagic[8] = {'E', 'C', 'M', 'S',
+                                            'N', 'A', 'P', '\n'};
+  constexpr static std::uint32_t CurrentVersion = 1;
+  // Records carry time-to-live and time left
+  constexpr static std::uint32_t HasTtl = 1;
+
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t flags;
+  // Serializer sizes, 0 for variable-sized keys or values
+  std::uint64_t keySize;
+  std::uint64_t valueSize;
+  std::uint64_t count;
+};
+
+/**
+ * Buffered output of a snapshot.  The snapshot is written next to its path,
+ *     flushed to the disk and renamed over it by Commit(), which then
+ *     flushes the directory too, so a crash while saving, even of the whole
+ *     machine, leaves the previous snapshot intact.
+ */
+class SnapshotWriter final {
+ public:
+  explicit SnapshotWriter(const std::string& path)
+      : path(path), temporaryPath(path + ".tmp") {
+    file.open(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Unable to create " + temporaryPath);
+    buffer.reserve(BufferSize);
+  }
+
+  SnapshotWriter(const SnapshotWriter&) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+  ~SnapshotWriter() {
+    if (committed) return;
+    file.close();
+    std::remove(temporaryPath.c_str());
+  }
+
+  void Write(const void* data, std::size_t size) {
+    if (buffer.size() + size > BufferSize) Drain();
+    if (size > BufferSize) {
+      file.write(static_cast<const char*>(data),
+                 static_cast<std::streamsize>(size));
+      return;
+    }
+    const auto* bytes = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  }
+
+  /**
+   * Finish the snapshot and replace the file at the path with it.
+   */
+  void Commit() {
+    Drain();
+    file.close();
+    if (!file) throw std::runtime_error("Unable to write " + temporaryPath);
+    // The data has to be on the disk before the rename is
+    Sync(temporaryPath, O_RDONLY);
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+      throw std::runtime_error("Unable to rename " + temporaryPath);
+    committed = true;
+    const std::size_t slash = path.rfind('/');
+    Sync(slash == std::string::npos ? "."
+         : slash == 0              ? "/"
+                                   : path.substr(0, slash),
+         O_RDONLY | O_DIRECTORY);
+  }
+
+ private:
+  constexpr static std::size_t BufferSize = 1 << 20;
+
+  static void Sync(const std::string& syncPath, int flags) {
+    const int fd = ::open(syncPath.c_str(), flags);
+    if (fd < 0) throw std::runtime_error("Unable to open " + syncPath);
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    if (!synced) throw std::runtime_error("Unable to sync " + syncPath);
+  }
+
+  void Drain() {
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+
+  std::string path;
+  std::string temporaryPath;
+  std::ofstream file;
+  std::vector<char> buffer;
+  bool committed = false;
+};
+
+/**
+ * Input of a snapshot, mapped into memory as a whole.  Reading past the end
+ *     throws, so a truncated snapshot is detected and never read out of
+ *     bounds.
+ */
+class SnapshotReader final {
+ public:
+  explicit SnapshotReader(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Unable to open " + path);
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Unable to stat " + path);
+    }
+    size = static_cast<std::size_t>(status.st_size);
+    if (size > 0) {
+      int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+      // The whole file is read anyway, so fault it in with one call
+      flags |= MAP_POPULATE;
+#endif
+      void* mapped = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+      if (mapped == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Unable to map " + path);
+      }
+      data = static_cast<const char*>(mapped);
+      ::madvise(mapped, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+    cursor = data;
+  }
+
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+  ~SnapshotReader() {
+    if (data) ::munmap(const_cast<char*>(data), size);
+  }
+
+  /**
+   * Consume bytes of the snapshot.
+   * @param bytes number of bytes
+   * @return pointer to the bytes, valid as long as the reader
+   */
+  const char* Take(std::size_t bytes) {
+    if (bytes > Remaining()) throw std::runtime_error("Truncated snapshot");
+    const char* result = cursor;
+    cursor += bytes;
+    return result;
+  }
+
+  void Skip(std::size_t bytes) { Take(bytes); }
+
+  std::size_t Remaining() const {
+    return size - static_cast<std::size_t>(cursor - data);
+  }
+
+ private:
+  const char* data = nullptr;
+  const char* cursor = nullptr;
+  std::size_t size = 0;
+};
+
+template <class T, class = void>
+struct Serializer {
+  static_assert(sizeof(T) == 0, "No Serializer for this type");
+};
+
+/**
+ * Trivially copyable values are stored as their bytes.
+ */
+template <class T>
+struct Serializer<T, std::enable_if_t<std::is_trivially_copyable_v<T>>> {
+  constexpr static std::size_t Size = sizeof(T);
+
+  static void Write(SnapshotWriter& out, const T& value) {
+    out.Write(&value, sizeof(T));
+  }
+
+  static T Read(SnapshotReader& in) {
+    T value;
+    std::memcpy(&value, in.Take(sizeof(T)), sizeof(T));
+    return value;
+  }
+};
+
+/**
+ * Strings are stored as their length followed by their characters.
+ */
+template <>
+struct Serializer<std::string> {
+  static void Write(SnapshotWriter& out, const std::string& value) {
+    const std::uint64_t length = value.size();
+    out.Write(&length, sizeof(length));
+    out.Write(value.data(), value.size());
+  }
+
+  static std::string Read(SnapshotReader& in) {
+    const auto length = Serializer<std::uint64_t>::Read(in);
+    if (length > in.Remaining()) throw std::runtime_error("Truncated snapshot");
+    return std::string(in.Take(static_cast<std::size_t>(length)),
+                       static_cast<std::size_t>(length));
+  }
+};
+
+namespace detail {
+
+// Size of every value written by TSerializer, 0 if it varies
+template <class TSerializer, class = void>
+struct SerializedSize : std::integral_constant<std::size_t, 0> {};
+
+template <class TSerializer>
+struct SerializedSize<TSerializer, std::void_t<decltype(TSerializer::Size)>>
+    : std::integral_constant<std::size_t, TSerializer::Size> {};
+
+// Friend of EvictingCacheMap behind SaveSnapshot() and LoadSnapshot()
+struct SnapshotAccess {
+  template <class TKeySerializer, class TValueSerializer, class TMap>
+  static void Save(const TMap& map, const std::string& path) {
+    using Node = typename TMap::Node;
+    std::uint64_t now = 0;
+    if constexpr (TMap::IsExpiring) now = map.Now();
+    SnapshotHeader header = HeaderOf<TKeySerializer, TValueSerializer, TMap>();
+    for (auto* it = map.list.Front(); it != map.list.End(); it = it->next)
+      if (!map.HasExpired(static_cast<const Node*>(it), now)) ++header.count;
+
+    SnapshotWriter out(path);
+    out.Write(&header, sizeof(header));
+    for (auto* it = map.list.Back(); it != map.list.End(); it = it->prev) {
+      const Node* node = static_cast<const Node*>(it);
+      if (map.HasExpired(node, now)) continue;
+      TKeySerializer::Write(out, node->Value()->first);
+      TValueSerializer::Write(out, node->Value()->second);
+      if constexpr (TMap::IsExpiring) {
+        const std::uint64_t times[2] = {
+            node->ttl, node->deadline == TMap::Wheel::Never
+                           ? TMap::NoTtl
+                           : node->deadline - now};
+        out.Write(times, sizeof(times));
+      }
+    }
+    out.Commit();
+  }
+
+  template <class TKeySerializer, class TValueSerializer, class TMap>
+  static void Load(TMap& map, const std::string& path) {
+    using TKey = typename TMap::key_type;
+    using TValue = typename TMap::mapped_type;
+    constexpr std::size_t KeySize = SerializedSize<TKeySerializer>::value;
+    constexpr std::size_t ValueSize = SerializedSize<TValueSerializer>::value;
+    constexpr std::size_t TtlSize =
+        TMap::IsExpiring ? 2 * sizeof(std::uint64_t) : 0;
+    // Fixed-size records can be checked against the file size and skipped
+    // without being read
+    constexpr std::size_t RecordSize =
+        KeySize != 0 && ValueSize != 0 ? KeySize + ValueSize + TtlSize : 0;
+
+    // The map keeps its entries unless the snapshot passes these checks
+    SnapshotReader in(path);
+    SnapshotHeader header;
+    std::memcpy(&header, in.Take(sizeof(header)), sizeof(header));
+    const SnapshotHeader expected =
+        HeaderOf<TKeySerializer, TValueSerializer, TMap>();
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.version != expected.version ||
+        header.flags != expected.flags ||
+        header.keySize != expected.keySize ||
+        header.valueSize != expected.valueSize)
+      throw std::runtime_error("Incompatible snapshot " + path);
+    // Every record takes at least one byte
+    if (header.count > in.Remaining() ||
+        (RecordSize != 0 && header.count * RecordSize != in.Remaining()))
+      throw std::runtime_error("Truncated snapshot " + path);
+
+    map.Clear();
+    try {
+      std::uint64_t skipped = 0;
+      if (!TMap::IsWeighted && header.count > map.capacity)
+        skipped = header.count - map.capacity;
+      map.reserve(static_cast<std::size_t>(header.count - skipped));
+      if constexpr (RecordSize != 0) {
+        in.Skip(static_cast<std::size_t>(skipped * RecordSize));
+      } else {
+        for (std::uint64_t i = 0; i < skipped; ++i) {
+          TKeySerializer::Read(in);
+          TValueSerializer::Read(in);
+          if constexpr (TMap::IsExpiring) in.Skip(TtlSize);
+        }
+      }
+
+      std::uint64_t now = 0;
+      if constexpr (TMap::IsExpiring) now = map.ReclaimExpired();
+      for (std::uint64_t i = skipped; i < header.count; ++i) {
+        TKey key = TKeySerializer::Read(in);
+        TValue value = TValueSerializer::Read(in);
+        std::uint64_t times[2] = {TMap::NoTtl, TMap::NoTtl};
+        if constexpr (TMap::IsExpiring)
+          std::memcpy(times, in.Take(sizeof(times)), sizeof(times));
+        map.LoadEntry(std::move(key), std::move(value), times[0], times[1],
+                      now);
+      }
+      if (in.Remaining() != 0)
+        throw std::runtime_error("Trailing data in snapshot " + path);
+    } catch (...) {
+      map.Clear();
+      throw;
+    }
+  }
+
+  template <class TKeySerializer, class TValueSerializer, class TMap>
+  static SnapshotHeader HeaderOf() {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SnapshotHeader::ExpectedMagic,
+                sizeof(header.magic));
+    header.version = SnapshotHeader::CurrentVersion;
+    header.flags = TMap::IsExpiring ? SnapshotHeader::HasTtl : 0;
+    header.keySize = SerializedSize<TKeySerializer>::value;
+    header.valueSize = SerializedSize<TValueSerializer>::value;
+    return header;
+  }
+};
+
+}  // namespace detail
+
+/**
+ * Write all entries of a map which have not expired to a snapshot file, from
+ *     the least to the most recently used one.  The file is replaced only
+ *     once the snapshot is complete.  Per-entry eviction policy state is not
+ *     saved.  This operation has no effect on eviction order.
+ * @tparam TKeySerializer serializer of the keys
+ * @tparam TValueSerializer serializer of the values
+ * @param map an EvictingCacheMap
+ * @param path path of the snapshot file
+ */
+template <class TKeySerializer, class TValueSerializer, class TMap>
+void SaveSnapshot(const TMap& map, const std::string& path) {
+  detail::SnapshotAccess::Save<TKeySerializer, TValueSerializer>(map, path);
+}
+
+template <class TMap>
+void SaveSnapshot(const TMap& map, const std::string& path) {
+  SaveSnapshot<Serializer<typename TMap::key_type>,
+               Serializer<typename TMap::mapped_type>>(map, path);
+}
+
+/**
+ * Replace the entries of a map with those of a snapshot written by
+ *     SaveSnapshot() with the same serializers.  The snapshot is mapped into
+ *     memory and read in one pass into an index sized for it up front.  If
+ *     it holds more entries than fit, the least recently used ones are left
+ *     out.  Replaced entries are not reported to the removal listener.
+ *
+ * A snapshot which can not be opened, was written for other types or is
+ *     shorter than its header says is rejected with an exception before the
+ *     map is touched.  If it turns out to be corrupt only while its records
+ *     are read, the exception leaves the map empty.
+ * @tparam TKeySerializer serializer of the keys
+ * @tparam TValueSerializer serializer of the values
+ * @param map an EvictingCacheMap
+ * @param path path of the snapshot file
+ */
+template <class TKeySerializer, class TValueSerializer, class TMap>
+void LoadSnapshot(TMap& map, const std::string& path) {
+  detail::SnapshotAccess::Load<TKeySerializer, TValueSerializer>(map, path);
+}
+
+template <class TMap>
+void LoadSnapshot(TMap& map, const std::string& path) {
+  LoadSnapshot<Serializer<typename TMap::key_type>,
+               Serializer<typename TMap::mapped_type>>(map, path);
+}
+
+#endif  // INCLUDE_SNAPSHOT_H_
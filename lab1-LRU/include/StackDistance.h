@@ -0,0 +1,168 @@
+#ifndef INCLUDE_STACKDISTANCE_H_
+#define INCLUDE_STACKDISTANCE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * LRU stack distances of a stream of accesses (Mattson's stack algorithm).
+ *     The distance of an access is the number of distinct keys accessed since
+ *     the previous access of the same key, including the key itself, so an
+ *     LRU cache of capacity C hits exactly the accesses with a distance of at
+ *     most C.  One pass therefore yields the hit ratio of every capacity.
+ *
+ * Every key is stamped with the logical time of its last access, and a
+ *     Fenwick tree over time counts the stamps in a time range, which makes
+ *     an access O(log n) in the number of distinct keys.  The tree also sums
+ *     the sizes of the keys, giving the distance in bytes used for caches
+ *     bounded by total size.  Once time reaches the end of the tree the live
+ *     stamps are renumbered from the start, so memory stays proportional to
+ *     the number of distinct keys however long the stream is.
+ */
+class StackDistance final {
+ public:
+  constexpr static std::uint64_t Infinite =
+      std::numeric_limits<std::uint64_t>::max();
+
+  struct Distance {
+    // Distinct keys accessed since the previous access, Infinite if the key
+    // is accessed for the first time
+    std::uint64_t entries;
+    // Total size of those keys, counting the accessed key with its new size
+    std::uint64_t bytes;
+  };
+
+  explicit StackDistance(std::size_t expectedKeys = 0)
+      : tree(TreeSize(expectedKeys)) {
+    stamps.reserve(expectedKeys);
+  }
+
+  /**
+   * Record an access and compute its stack distance.
+   * @param key hash or other unique identifier of the key
+   * @param size size of the key's value
+   * @return the distance, Infinite for both fields on a first access
+   */
+  Distance Access(std::uint64_t key, std::uint64_t size = 1) {
+    if (now + 1 == tree.size()) Compact();
+    const std::size_t time = ++now;
+
+    auto inserted = stamps.try_emplace(key, Stamp{time, size});
+    Distance distance{Infinite, Infinite};
+    if (!inserted.second) {
+      Stamp& stamp = inserted.first->second;
+      const Sums before = Prefix(stamp.time);
+      distance.entries = stamps.size() - before.count + 1;
+      distance.bytes = totalBytes - before.bytes + size;
+      Add(stamp.time, -1, -static_cast<std::int64_t>(stamp.size));
+      stamp = Stamp{time, size};
+    }
+    Add(time, 1, static_cast<std::int64_t>(size));
+    return distance;
+  }
+
+  /**
+   * Forget a key, as if it had never been accessed.
+   * @return true if the key was known
+   */
+  bool Remove(std::uint64_t key) {
+    auto found = stamps.find(key);
+    if (found == stamps.end()) return false;
+    const Stamp& stamp = found->second;
+    Add(stamp.time, -1, -static_cast<std::int64_t>(stamp.size));
+    stamps.erase(found);
+    return true;
+  }
+
+  void Clear() {
+    stamps.clear();
+    std::fill(tree.begin(), tree.end(), Sums{});
+    totalBytes = 0;
+    now = 0;
+  }
+
+  /**
+   * @return number of distinct keys being tracked
+   */
+  std::size_t Size() const { return stamps.size(); }
+
+ private:
+  struct Stamp {
+    std::size_t time;
+    std::uint64_t size;
+  };
+
+  constexpr static std::size_t MinTreeSize = 1024;
+
+  static std::size_t TreeSize(std::size_t keys) {
+    return std::max(MinTreeSize, 2 * keys + 1);
+  }
+
+  // Number and total size of the stamps in a range of time
+  struct Sums {
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+  };
+
+  // The Fenwick tree is 1-based, index 0 is unused
+  void Add(std::size_t time, std::int64_t count, std::int64_t size) {
+    totalBytes += static_cast<std::uint64_t>(size);
+    for (; time < tree.size(); time += time & (~time + 1)) {
+      tree[time].count += static_cast<std::uint64_t>(count);
+      tree[time].bytes += static_cast<std::uint64_t>(size);
+    }
+  }
+
+  // Sums over the stamps up to time; the ones after it are the rest of the
+  // live keys, whose number and size are known without a second walk
+  Sums Prefix(std::size_t time) const {
+    Sums sums;
+    for (; time > 0; time &= time - 1) {
+      sums.count += tree[time].count;
+      sums.bytes += tree[time].bytes;
+    }
+    return sums;
+  }
+
+  // Renumber the stamps 1..Size() in the order of time, growing the trees so
+  // that at least half of them is free afterwards
+  void Compact() {
+    std::vector<std::pair<std::size_t, Stamp*>> order;
+    order.reserve(stamps.size());
+    for (auto& entry : stamps)
+      order.emplace_back(entry.second.time, &entry.second);
+    std::sort(order.begin(), order.end(),
+              [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+              });
+
+    const std::size_t size = std::max(tree.size(), TreeSize(order.size()));
+    tree.assign(size, Sums{});
+    now = 0;
+    for (auto& entry : order) {
+      entry.second->time = ++now;
+      tree[now] = Sums{1, entry.second->size};
+    }
+    // Linear construction: push every node's sum into its parent
+    for (std::size_t time = 1; time < size; ++time) {
+      const std::size_t parent = time + (time & (~time + 1));
+      if (parent < size) {
+        tree[parent].count += tree[time].count;
+        tree[parent].bytes += tree[time].bytes;
+      }
+    }
+  }
+
+  std::unordered_map<std::uint64_t, Stamp> stamps;
+  std::vector<Sums> tree;
+  std::uint64_t totalBytes = 0;
+  // Time of the last access, stamps are never greater
+  std::size_t now = 0;
+};
+
+#endif  // INCLUDE_STACKDISTANCE_H_
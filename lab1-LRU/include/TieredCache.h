@@ -0,0 +1,176 @@
+#ifndef INCLUDE_TIEREDCACHE_H_
+#define INCLUDE_TIEREDCACHE_H_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "EvictingCacheMap.h"
+#include "SegmentLog.h"
+
+/**
+ * Two-tier cache: an EvictingCacheMap in memory in front of a SegmentLog on
+ *     a local disk.  Entries evicted from memory are demoted to the log
+ *     instead of being dropped, and a hit in the log promotes the entry back
+ *     into memory, taking it out of the log.  A key lives in at most one
+ *     tier.  The log drops whole segments once it is full, so the total
+ *     capacity is roughly the memory capacity plus the size of the log.
+ *
+ * Keys and values must be trivially copyable, see SegmentLog.  Not
+ *     thread-safe.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>,
+          class TEvictionPolicy = LruEviction>
+class TieredCache final {
+ public:
+  using Map = EvictingCacheMap<TKey, TValue, THash, TKeyEqual,
+                               TEvictionPolicy>;
+  using Log = SegmentLog<TKey, TValue, THash, TKeyEqual>;
+
+  /**
+   * Construct a TieredCache
+   * @param capacity maximum number of entries in memory
+   * @param directory existing directory for the segment files of the log
+   * @param segmentSize size of a segment of the log in bytes
+   * @param segmentCount number of segments of the log, at least two
+   * @param reclamation which segment the log reclaims once it is full
+   */
+  TieredCache(std::size_t capacity, const std::string& directory,
+              std::size_t segmentSize, std::size_t segmentCount,
+              SegmentReclamation reclamation = SegmentReclamation::Fifo)
+      : map(capacity),
+        log(directory, segmentSize, segmentCount, reclamation) {
+    map.setRemovalListener(
+        [this](const TKey& key, TValue&& value, RemovalCause cause) {
+          if (cause == RemovalCause::Capacity)
+            demoted.emplace_back(key, std::move(value));
+        });
+  }
+
+  // The listener of the map points to this cache
+  TieredCache(const TieredCache&) = delete;
+  TieredCache& operator=(const TieredCache&) = delete;
+
+  /**
+   * Get the value associated with a specific key from either tier.  A value
+   *     found in the log is moved into memory.
+   * @param key key associated with the value
+   * @return the value if it exists
+   */
+  std::optional<TValue> get(const TKey& key) {
+    if (auto value = map.get(key)) return value;
+    std::optional<TValue> value = log.Take(key);
+    if (value) Promote(key, *value);
+    return value;
+  }
+
+  /**
+   * Look up many keys at once, with the same effect as calling get() for
+   *     each of them.  Keys missing in memory are read from the log in one
+   *     batch (see SegmentLog::TakeMany()) and then promoted.
+   * @param first beginning of the range of keys, which is traversed twice
+   * @param last end of the range of keys
+   * @param out output iterator receiving a std::optional<TValue> per key
+   * @return output iterator past the last value written
+   */
+  template <class TForwardIt, class TOutputIt>
+  TOutputIt multiGet(TForwardIt first, TForwardIt last, TOutputIt out) {
+    std::vector<std::optional<TValue>> values;
+    map.multiGet(first, last, std::back_inserter(values));
+
+    std::vector<TKey> missing;
+    TForwardIt key = first;
+    for (const auto& value : values) {
+      if (!value) missing.push_back(*key);
+      ++key;
+    }
+    std::vector<std::optional<TValue>> loaded;
+    loaded.reserve(missing.size());
+    log.TakeMany(missing.begin(), missing.end(), std::back_inserter(loaded));
+
+    // The log hands out a key listed twice only once; get() finds the
+    // later copies where the promotion of the first one has put them
+    std::unordered_set<TKey, THash, TKeyEqual> promoted;
+    std::size_t next = 0;
+    for (auto& value : values) {
+      if (!value) {
+        const TKey& missingKey = missing[next];
+        value = std::move(loaded[next]);
+        if (value) {
+          Promote(missingKey, *value);
+          promoted.insert(missingKey);
+        } else if (promoted.count(missingKey) != 0) {
+          value = get(missingKey);
+        }
+        ++next;
+      }
+      *out = std::move(value);
+      ++out;
+    }
+    return out;
+  }
+
+  /**
+   * Set a key-value pair in memory, dropping an older value from the log.
+   * @param key key to associate with value
+   * @param value value to associate with the key
+   */
+  void put(const TKey& key, const TValue& value) {
+    log.Erase(key);
+    map.put(key, value);
+    Demote();
+  }
+
+  /**
+   * Erase a key from both tiers.
+   * @return true if the key existed and was erased, else false
+   */
+  bool erase(const TKey& key) {
+    const bool inMemory = map.erase(key);
+    return log.Erase(key) || inMemory;
+  }
+
+  /**
+   * Check for existence of a key in either tier without moving it.
+   */
+  bool exists(const TKey& key) const {
+    return map.exists(key) || log.Contains(key);
+  }
+
+  /**
+   * @return number of entries in both tiers
+   */
+  std::size_t size() const { return map.size() + log.Size(); }
+
+  const Map& memoryTier() const { return map; }
+  const Log& fileTier() const { return log; }
+
+ private:
+  void Promote(const TKey& key, const TValue& value) {
+    map.put(key, value);
+    Demote();
+  }
+
+  // Move what the map evicted into the log
+  void Demote() {
+    std::vector<std::pair<TKey, TValue>> batch;
+    batch.swap(demoted);
+    for (const auto& entry : batch) log.Put(entry.first, entry.second);
+    // Keep the capacity for the next eviction
+    batch.clear();
+    demoted.swap(batch);
+  }
+
+  Map map;
+  Log log;
+  // Entries evicted from memory by the current operation
+  std::vector<std::pair<TKey, TValue>> demoted;
+};
+
+#endif  // INCLUDE_TIEREDCACHE_H_
@@ -0,0 +1,166 @@
+#ifndef INCLUDE_TIMERWHEEL_H_
+#define INCLUDE_TIMERWHEEL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * Hierarchical timing wheel of externally owned timers.  Every level has 64
+ *     buckets; a bucket of level 0 spans 2^20 ns (about a millisecond) and
+ *     every further level is 64 times coarser, so five levels cover about
+ *     13 days.  A timer is put into the finest level whose range still
+ *     reaches its deadline, and when time passes a bucket of a coarser
+ *     level its timers are redistributed to the finer ones.
+ *
+ * Scheduling and removing a timer is O(1).  Advance() only visits buckets
+ *     whose span has passed, at most 64 per level however much time went by,
+ *     plus the timers in them; expired timers are handed to a callback in one
+ *     batch.
+ *
+ * Times are unsigned nanoseconds on an arbitrary monotonic scale.  Buckets
+ *     are circular lists with a sentinel, allocated on the first call to
+ *     Schedule() or Advance() from a rebound copy of TAllocator; timers never
+ *     point into the wheel object itself, so it can be moved.
+ */
+template <class TAllocator = std::allocator<char>>
+class TimerWheel final {
+ public:
+  constexpr static std::uint64_t Never =
+      std::numeric_limits<std::uint64_t>::max();
+
+  struct Timer {
+    Timer* timerPrev = nullptr;
+    Timer* timerNext = nullptr;
+    std::uint64_t deadline = Never;
+  };
+
+ private:
+  using BucketAllocator = typename std::allocator_traits<
+      TAllocator>::template rebind_alloc<Timer>;
+
+ public:
+  explicit TimerWheel(const TAllocator& allocator = TAllocator())
+      : buckets(BucketAllocator(allocator)) {}
+
+  /**
+   * Schedule a timer which is not scheduled yet.
+   * @param timer timer to schedule
+   * @param deadline time the timer expires at, Never to only record it
+   *     without scheduling
+   */
+  void Schedule(Timer* timer, std::uint64_t deadline) {
+    timer->deadline = deadline;
+    if (deadline == Never) return;
+    if (buckets.empty()) Init();
+    Link(timer);
+  }
+
+  /**
+   * Unschedule a timer.  Unscheduled timers are left alone.
+   */
+  void Remove(Timer* timer) {
+    if (timer->timerNext == nullptr) return;
+    timer->timerPrev->timerNext = timer->timerNext;
+    timer->timerNext->timerPrev = timer->timerPrev;
+    timer->timerPrev = timer->timerNext = nullptr;
+  }
+
+  /**
+   * Move the wheel forward and expire timers.  A timer may only be expired
+   *     once the bucket holding it has passed, so timers are reported with a
+   *     delay of up to one level 0 bucket.
+   * @param now current time, earlier times are ignored
+   * @param expire callback invoked with every expired timer, which is
+   *     already unscheduled
+   */
+  template <class TExpire>
+  void Advance(std::uint64_t now, TExpire&& expire) {
+    if (now <= current) return;
+    const std::uint64_t previous = current;
+    current = now;
+    if (buckets.empty()) return;
+
+    for (unsigned level = 0; level < Levels; ++level) {
+      const unsigned shift = ResolutionBits + SlotBits * level;
+      const std::uint64_t previousTicks = previous >> shift;
+      const std::uint64_t ticks = now >> shift;
+      if (ticks == previousTicks) break;
+
+      // The bucket of the previous time is visited again, it may hold timers
+      // which were not due yet last time.
+      const std::uint64_t steps =
+          std::min<std::uint64_t>(ticks - previousTicks + 1, Slots);
+      for (std::uint64_t step = 0; step < steps; ++step)
+        Drain(Bucket(level, previousTicks + step), expire);
+    }
+  }
+
+  /**
+   * Forget all timers.  The timers themselves are not touched.
+   */
+  void Clear() {
+    for (Timer& sentinel : buckets)
+      sentinel.timerPrev = sentinel.timerNext = &sentinel;
+  }
+
+  std::uint64_t Now() const { return current; }
+
+ private:
+  constexpr static unsigned ResolutionBits = 20;
+  constexpr static unsigned SlotBits = 6;
+  constexpr static std::uint64_t Slots = std::uint64_t(1) << SlotBits;
+  constexpr static unsigned Levels = 5;
+
+  void Init() {
+    buckets.resize(Levels * Slots);
+    Clear();
+  }
+
+  Timer& Bucket(unsigned level, std::uint64_t ticks) {
+    return buckets[level * Slots + (ticks & (Slots - 1))];
+  }
+
+  // Put a timer into the finest level which covers its deadline.  Overdue
+  // timers go to the current bucket of level 0, deadlines beyond the last
+  // level wrap around and are redistributed when their bucket is passed.
+  void Link(Timer* timer) {
+    const std::uint64_t ticks =
+        std::max(timer->deadline, current) >> ResolutionBits;
+    const std::uint64_t delta = ticks - (current >> ResolutionBits);
+    unsigned level = 0;
+    while (level + 1 < Levels && (delta >> (SlotBits * (level + 1))) != 0)
+      ++level;
+
+    Timer& sentinel = Bucket(level, ticks >> (SlotBits * level));
+    timer->timerPrev = sentinel.timerPrev;
+    timer->timerNext = &sentinel;
+    sentinel.timerPrev->timerNext = timer;
+    sentinel.timerPrev = timer;
+  }
+
+  // Detach the bucket first: timers which are not due yet may be linked back
+  // into it.
+  template <class TExpire>
+  void Drain(Timer& sentinel, TExpire& expire) {
+    Timer* timer = sentinel.timerNext;
+    sentinel.timerPrev = sentinel.timerNext = &sentinel;
+    while (timer != &sentinel) {
+      Timer* next = timer->timerNext;
+      timer->timerPrev = timer->timerNext = nullptr;
+      if (timer->deadline <= current)
+        expire(timer);
+      else
+        Link(timer);
+      timer = next;
+    }
+  }
+
+  std::vector<Timer, BucketAllocator> buckets;
+  std::uint64_t current = 0;
+};
+
+#endif  // INCLUDE_TIMERWHEEL_H_
@@ -0,0 +1,264 @@
+#ifndef INCLUDE_TINYLFUEVICTION_H_
+#define INCLUDE_TINYLFUEVICTION_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "EvictionPolicies.h"
+#include "IntrusiveList.h"
+
+/**
+ * Approximate access frequency of hashes: a count-min sketch of 4-bit
+ *     counters behind a doorkeeper Bloom filter.
+ *
+ * The first occurrence of a hash only sets its doorkeeper bits, so the one-hit
+ *     wonders that make up most of a typical trace never reach the counters.
+ *     Once the number of recorded accesses reaches ten times the capacity,
+ *     every counter is halved and the doorkeeper is cleared, so old
+ *     popularity fades away.
+ */
+class FrequencySketch final {
+ public:
+  /**
+   * Maximum value of a counter; Frequency() may return one more for hashes
+   *     which are also in the doorkeeper.
+   */
+  constexpr static unsigned MaxCount = 15;
+
+  /**
+   * Construct a FrequencySketch
+   * @param capacity number of distinct hashes the sketch should be able to
+   *     tell apart, usually the capacity of the cache
+   */
+  explicit FrequencySketch(std::size_t capacity)
+      : table(RoundUpToPowerOfTwo(std::max<std::size_t>(capacity, 8))),
+        doorkeeper(table.size()),
+        sampleSize(10 * std::max<std::size_t>(capacity, 1)) {}
+
+  /**
+   * Record an access.
+   * @param hash mixed hash of the key
+   */
+  void Increment(std::uint32_t hash) {
+    // Only a moved-from sketch has no table
+    if (table.empty()) return;
+
+    if (DoorkeeperAdd(hash)) {
+      for (unsigned row = 0; row < Depth; ++row) {
+        const std::size_t counter = CounterIndex(hash, row);
+        std::uint64_t& word = table[counter / 16];
+        const unsigned shift = (counter % 16) * 4;
+        if (((word >> shift) & 0xf) < MaxCount)
+          word += std::uint64_t(1) << shift;
+      }
+    }
+
+    if (++additions == sampleSize) Age();
+  }
+
+  /**
+   * Estimate the number of recorded accesses.
+   * @param hash mixed hash of the key
+   * @return estimated frequency, never lower than the true one since the
+   *     last aging
+   */
+  unsigned Frequency(std::uint32_t hash) const {
+    if (table.empty()) return 0;
+
+    unsigned result = MaxCount;
+    for (unsigned row = 0; row < Depth; ++row) {
+      const std::size_t counter = CounterIndex(hash, row);
+      const unsigned value =
+          static_cast<unsigned>(table[counter / 16] >> ((counter % 16) * 4)) &
+          0xf;
+      result = std::min(result, value);
+    }
+    return result + (DoorkeeperContains(hash) ? 1 : 0);
+  }
+
+  void Clear() {
+    std::fill(table.begin(), table.end(), 0);
+    std::fill(doorkeeper.begin(), doorkeeper.end(), 0);
+    additions = 0;
+  }
+
+ private:
+  static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+    std::size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+  }
+
+  // Halve all counters.  Shifting a whole word moves the low bit of every
+  // counter into the high bit of the next one, the mask drops those.
+  void Age() {
+    for (auto& word : table) word = (word >> 1) & 0x7777777777777777ULL;
+    std::fill(doorkeeper.begin(), doorkeeper.end(), 0);
+    additions /= 2;
+  }
+
+  static std::uint32_t Rehash(std::uint32_t hash, unsigned seed) {
+    std::uint64_t h = (hash + std::uint64_t(seed) * 0x9e3779b97f4a7c15ULL) *
+                      0xbf58476d1ce4e5b9ULL;
+    return static_cast<std::uint32_t>(h >> 32);
+  }
+
+  std::size_t CounterIndex(std::uint32_t hash, unsigned row) const {
+    return Rehash(hash, row) & (table.size() * 16 - 1);
+  }
+
+  std::size_t DoorkeeperBit(std::uint32_t hash, unsigned probe) const {
+    return Rehash(hash, Depth + probe) & (doorkeeper.size() * 64 - 1);
+  }
+
+  bool DoorkeeperContains(std::uint32_t hash) const {
+    for (unsigned probe = 0; probe < DoorkeeperProbes; ++probe) {
+      const std::size_t bit = DoorkeeperBit(hash, probe);
+      if (!(doorkeeper[bit / 64] & (std::uint64_t(1) << (bit % 64))))
+        return false;
+    }
+    return true;
+  }
+
+  // Returns true if the hash was already present
+  bool DoorkeeperAdd(std::uint32_t hash) {
+    bool present = true;
+    for (unsigned probe = 0; probe < DoorkeeperProbes; ++probe) {
+      const std::size_t bit = DoorkeeperBit(hash, probe);
+      const std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+      if (!(doorkeeper[bit / 64] & mask)) {
+        present = false;
+        doorkeeper[bit / 64] |= mask;
+      }
+    }
+    return present;
+  }
+
+  constexpr static unsigned Depth = 4;
+  constexpr static unsigned DoorkeeperProbes = 2;
+
+  // 16 counters per word, 16 counters per entry of capacity
+  std::vector<std::uint64_t> table;
+  // 64 bits per entry of capacity
+  std::vector<std::uint64_t> doorkeeper;
+  std::size_t sampleSize;
+  std::size_t additions = 0;
+};
+
+/**
+ * Window TinyLFU.  New entries enter a small LRU window (1% of the capacity).
+ *     Entries leaving the window compete with the least recently used entry
+ *     of the main region for a place there, and the one with the lower
+ *     estimated frequency is evicted.  The main region is a segmented LRU: a
+ *     hit in its probation segment promotes the entry to the protected
+ *     segment (80% of the main region), which in turn demotes its least
+ *     recently used entry back to probation.
+ *
+ * This keeps a scan of keys seen once from flushing frequently used entries,
+ *     while the window still lets bursts of new keys be served.  The list of
+ *     the map is left in insertion order.
+ */
+struct WTinyLfuEviction {
+  template <class TNode>
+  class Policy {
+    enum class Segment : std::uint8_t { Window, Probation, Protected };
+
+   public:
+    struct Hook {
+      TNode* policyPrev = nullptr;
+      TNode* policyNext = nullptr;
+      Segment segment = Segment::Window;
+    };
+
+    explicit Policy(std::size_t capacity)
+        : sketch(capacity),
+          maxWindow(std::max<std::size_t>(1, capacity / 100)),
+          maxProtected((capacity - std::min(capacity, maxWindow)) * 4 / 5) {}
+
+    void Inserted(TNode* node, IntrusiveList&) {
+      sketch.Increment(node->hash);
+      node->segment = Segment::Window;
+      window.PushFront(node);
+      if (window.Size() > maxWindow) {
+        TNode* oldest = window.Back();
+        window.Remove(oldest);
+        oldest->segment = Segment::Probation;
+        probation.PushFront(oldest);
+      }
+    }
+
+    void Accessed(TNode* node, IntrusiveList&) {
+      sketch.Increment(node->hash);
+      switch (node->segment) {
+        case Segment::Window:
+          window.MoveToFront(node);
+          break;
+        case Segment::Probation:
+          probation.Remove(node);
+          node->segment = Segment::Protected;
+          protectedSegment.PushFront(node);
+          if (protectedSegment.Size() > maxProtected) {
+            TNode* demoted = protectedSegment.Back();
+            protectedSegment.Remove(demoted);
+            demoted->segment = Segment::Probation;
+            probation.PushFront(demoted);
+          }
+          break;
+        case Segment::Protected:
+          protectedSegment.MoveToFront(node);
+          break;
+      }
+    }
+
+    TNode* Victim(std::uint32_t, IntrusiveList&) {
+      TNode* victim = probation.Empty() ? protectedSegment.Back()
+                                        : probation.Back();
+      if (window.Size() < maxWindow || window.Empty())
+        return victim ? victim : window.Back();
+
+      // The new entry is going to push the oldest window entry out
+      TNode* candidate = window.Back();
+      if (victim == nullptr) return candidate;
+      if (sketch.Frequency(candidate->hash) <= sketch.Frequency(victim->hash))
+        return candidate;
+
+      window.Remove(candidate);
+      candidate->segment = Segment::Probation;
+      probation.PushFront(candidate);
+      return victim;
+    }
+
+    void Removed(TNode* node, IntrusiveList&) { ListOf(node).Remove(node); }
+
+    void Cleared() {
+      window.Clear();
+      probation.Clear();
+      protectedSegment.Clear();
+    }
+
+    const FrequencySketch& Sketch() const { return sketch; }
+
+   private:
+    PolicyList<TNode>& ListOf(TNode* node) {
+      switch (node->segment) {
+        case Segment::Window:
+          return window;
+        case Segment::Probation:
+          return probation;
+        default:
+          return protectedSegment;
+      }
+    }
+
+    FrequencySketch sketch;
+    PolicyList<TNode> window;
+    PolicyList<TNode> probation;
+    PolicyList<TNode> protectedSegment;
+    std::size_t maxWindow;
+    std::size_t maxProtected;
+  };
+};
+
+#endif  // INCLUDE_TINYLFUEVICTION_H_
@@ -0,0 +1,242 @@
+#ifndef INCLUDE_WRITEBACKCACHE_H_
+#define INCLUDE_WRITEBACKCACHE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BackingStore.h"
+#include "EvictingCacheMap.h"
+
+/**
+ * Write-back cache in front of a BackingStore.  put() only marks the entry
+ *     dirty, and dirty values reach the store in batches: when flush() is
+ *     called, when flushIfDue() finds the flush interval passed, or when
+ *     maxDirty values are waiting.  Repeated puts of a key between two
+ *     flushes cost a single write.
+ *
+ * A dirty entry evicted from the cache is kept in a buffer until the next
+ *     flush, so eviction never writes on its own and get() still returns the
+ *     latest value.  Misses are read through from the store and cached as
+ *     clean entries.
+ *
+ * Flushing is driven by the caller, there is no background thread; a caller
+ *     wanting periodic flushes calls flushIfDue() from its event loop or
+ *     timer.  The destructor flushes what is left and ignores errors, so a
+ *     caller that must know whether everything was written calls flush()
+ *     first.  Not thread-safe.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>,
+          class TKeyEqual = std::equal_to<TKey>,
+          class TEvictionPolicy = LruEviction,
+          class TClock = std::chrono::steady_clock>
+class WriteBackCache final {
+ public:
+  using Store = BackingStore<TKey, TValue>;
+  using Clock = TClock;
+
+  /**
+   * Construct a WriteBackCache
+   * @param capacity maximum number of cached entries
+   * @param store store read on misses and written on flushes, which must
+   *     outlive the cache
+   * @param maxDirty number of dirty values which triggers a flush
+   * @param flushInterval time after the last flush when flushIfDue() flushes
+   */
+  WriteBackCache(std::size_t capacity, Store& store,
+                 std::size_t maxDirty = 1024,
+                 typename TClock::duration flushInterval =
+                     std::chrono::seconds(1))
+      : map(capacity),
+        store(store),
+        maxDirty(maxDirty),
+        flushInterval(flushInterval),
+        lastFlush(TClock::now()) {
+    map.setRemovalListener(
+        [this](const TKey& key, Entry&& entry, RemovalCause cause) {
+          if (cause != RemovalCause::Capacity || !entry.dirty) return;
+          --dirtyCount;
+          evicted.insert_or_assign(key, std::move(entry.value));
+        });
+  }
+
+  // The listener of the map points to this cache
+  WriteBackCache(const WriteBackCache&) = delete;
+  WriteBackCache& operator=(const WriteBackCache&) = delete;
+
+  ~WriteBackCache() {
+    try {
+      flush();
+    } catch (...) {
+      // Nobody to report to; flush() before destruction to see errors
+    }
+  }
+
+  /**
+   * Get the value associated with a specific key, reading it from the store
+   *     if it is not cached.  Like put(), this call flushes if maxDirty values
+   *     are waiting once it returns.
+   * @param key key associated with the value
+   * @return the value if it exists in the cache or in the store
+   */
+  std::optional<TValue> get(const TKey& key) {
+    auto iter = map.find(key);
+    if (iter != map.end()) return iter->second.value;
+
+    // Evicted but not written yet: the buffer has the latest value
+    auto pending = evicted.find(key);
+    if (pending != evicted.end()) {
+      auto node = evicted.extract(pending);
+      std::optional<TValue> value(node.mapped());
+      // Listed already when it turned dirty
+      Insert(std::move(node.key()), std::move(node.mapped()), true, false);
+      FlushIfFull();
+      return value;
+    }
+
+    std::optional<TValue> value = store.Read(key);
+    if (value) Insert(key, *value, false);
+    return value;
+  }
+
+  /**
+   * Set a key-value pair.  The value is written to the store by a later
+   *     flush; this call flushes if it makes maxDirty values wait.
+   * @param key key to associate with value
+   * @param value value to associate with the key
+   */
+  template <class T, class E>
+  void put(T&& key, E&& value) {
+    auto iter = map.find(key);
+    if (iter != map.end()) {
+      iter->second.value = std::forward<E>(value);
+      if (!iter->second.dirty) {
+        iter->second.dirty = true;
+        ++dirtyCount;
+        dirtyKeys.push_back(iter->first);
+      }
+    } else {
+      const bool listed = evicted.erase(key) != 0;
+      Insert(std::forward<T>(key), std::forward<E>(value), true, !listed);
+    }
+    FlushIfFull();
+  }
+
+  /**
+   * Erase a key from the cache and from the store.
+   * @param key key associated with the value
+   */
+  void erase(const TKey& key) {
+    auto iter = map.findWithoutPromotion(key);
+    if (iter != map.end()) {
+      if (iter->second.dirty) --dirtyCount;
+      map.erase(key);
+    }
+    evicted.erase(key);
+    store.Remove(key);
+  }
+
+  /**
+   * Write all dirty values to the store in one batch.  If the store throws,
+   *     the values stay dirty and the next flush tries again.
+   */
+  void flush() {
+    typename Store::Batch batch;
+    batch.reserve(dirty());
+    for (const auto& entry : evicted) batch.emplace_back(entry);
+
+    // A key erased while dirty is listed again if it turns dirty once more,
+    // so entries are marked clean as they are taken to write each of them
+    // once
+    std::vector<Entry*> taken;
+    taken.reserve(dirtyCount);
+    try {
+      for (const TKey& key : dirtyKeys) {
+        auto iter = map.findWithoutPromotion(key);
+        if (iter == map.end() || !iter->second.dirty) continue;
+        taken.push_back(&iter->second);
+        iter->second.dirty = false;
+        batch.emplace_back(key, iter->second.value);
+      }
+      if (!batch.empty()) store.Write(batch);
+    } catch (...) {
+      for (Entry* entry : taken) entry->dirty = true;
+      throw;
+    }
+
+    if (!batch.empty()) ++flushes;
+    evicted.clear();
+    dirtyKeys.clear();
+    dirtyCount = 0;
+    lastFlush = TClock::now();
+  }
+
+  /**
+   * Flush if the flush interval passed since the last flush.
+   * @return true if it flushed
+   */
+  bool flushIfDue() {
+    if (TClock::now() - lastFlush < flushInterval) return false;
+    flush();
+    return true;
+  }
+
+  /**
+   * @return number of values waiting to be written, cached or evicted
+   */
+  std::size_t dirty() const { return dirtyCount + evicted.size(); }
+
+  /**
+   * @return number of cached entries
+   */
+  std::size_t size() const { return map.size(); }
+
+  /**
+   * @return number of batches written to the store
+   */
+  std::size_t flushCount() const { return flushes; }
+
+ private:
+  struct Entry {
+    TValue value;
+    bool dirty = false;
+  };
+
+  using Map = EvictingCacheMap<TKey, Entry, THash, TKeyEqual,
+                               TEvictionPolicy>;
+
+  // @param list add the key to dirtyKeys, unless it is there already
+  template <class T, class E>
+  void Insert(T&& key, E&& value, bool dirty, bool list = true) {
+    if (dirty) {
+      if (list) dirtyKeys.push_back(key);
+      ++dirtyCount;
+    }
+    map.put(std::forward<T>(key), Entry{std::forward<E>(value), dirty});
+  }
+
+  // Keys erased while dirty stay listed, so dirtyKeys is bounded as well
+  void FlushIfFull() {
+    if (dirty() >= maxDirty || dirtyKeys.size() > 2 * maxDirty) flush();
+  }
+
+  Map map;
+  Store& store;
+  std::size_t maxDirty;
+  typename TClock::duration flushInterval;
+  typename TClock::time_point lastFlush;
+  // Values of dirty entries evicted since the last flush
+  std::unordered_map<TKey, TValue, THash, TKeyEqual> evicted;
+  // Keys which turned dirty since the last flush, possibly listed twice or
+  // no longer cached
+  std::vector<TKey> dirtyKeys;
+  // Dirty entries in the map
+  std::size_t dirtyCount = 0;
+  std::size_t flushes = 0;
+};
+
+#endif  // INCLUDE_WRITEBACKCACHE_H_
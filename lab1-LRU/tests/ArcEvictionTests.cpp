@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "ArcEviction.h"
+#include "EvictingCacheMap.h"
+
+using ArcMapii = EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+    ArcEviction>;
+
+TEST(GhostList, PushContainsErase)
+{
+    GhostList ghosts(4);
+    EXPECT_TRUE(ghosts.Empty());
+    ghosts.Push(1);
+    ghosts.Push(2);
+    ghosts.Push(2);
+    EXPECT_EQ(ghosts.Size(), 2u);
+    EXPECT_TRUE(ghosts.Contains(1));
+    EXPECT_TRUE(ghosts.Erase(1));
+    EXPECT_FALSE(ghosts.Erase(1));
+    EXPECT_FALSE(ghosts.Contains(1));
+    EXPECT_EQ(ghosts.Size(), 1u);
+
+    ghosts.Clear();
+    EXPECT_FALSE(ghosts.Contains(2));
+    EXPECT_TRUE(ghosts.Empty());
+}
+
+TEST(GhostList, DropsOldest)
+{
+    GhostList ghosts(3);
+    const std::size_t memory = ghosts.MemoryUsage();
+    for (std::uint32_t hash = 0; hash < 5; ++hash)
+        ghosts.Push(hash);
+    EXPECT_EQ(ghosts.Size(), 3u);
+    EXPECT_FALSE(ghosts.Contains(1));
+    EXPECT_TRUE(ghosts.Contains(2));
+    EXPECT_EQ(ghosts.MemoryUsage(), memory);
+
+    // The dead slot of 3 is skipped
+    ghosts.Erase(3);
+    ghosts.PopOldest();
+    EXPECT_FALSE(ghosts.Contains(2));
+    EXPECT_TRUE(ghosts.Contains(4));
+    ghosts.PopOldest();
+    EXPECT_TRUE(ghosts.Empty());
+    ghosts.PopOldest();
+}
+
+TEST(GhostList, MatchesReference)
+{
+    // Hashes sharing table slots exercise the backward shift deletion
+    const std::size_t capacity = 64;
+    GhostList ghosts(capacity);
+    std::deque<std::uint32_t> reference;
+    std::mt19937 random(1);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const std::uint32_t hash = (random() % 200) * 128;
+        const auto it = std::find(reference.begin(), reference.end(), hash);
+        switch (random() % 3)
+        {
+        case 0:
+            EXPECT_EQ(ghosts.Erase(hash), it != reference.end());
+            if (it != reference.end())
+                reference.erase(it);
+            break;
+        case 1:
+            ghosts.PopOldest();
+            if (!reference.empty())
+                reference.pop_front();
+            break;
+        default:
+            if (it != reference.end())
+                reference.erase(it);
+            reference.push_back(hash);
+            // Only live hashes count, so dead slots may drop one more
+            ghosts.Push(hash);
+            break;
+        }
+        ASSERT_LE(ghosts.Size(), reference.size());
+        if (ghosts.Size() < reference.size())
+            reference.erase(reference.begin(),
+                reference.end() - static_cast<long>(ghosts.Size()));
+        for (std::uint32_t ghost : reference)
+            ASSERT_TRUE(ghosts.Contains(ghost));
+    }
+}
+
+TEST(ArcEviction, ScanResistance)
+{
+    const int capacity = 100;
+    ArcMapii map(capacity);
+    for (int round = 0; round < 10; ++round)
+        for (int i = 0; i < capacity / 2; ++i)
+            if (!map.get(i))
+                map.put(i, i);
+
+    for (int i = 1000; i < 1000 + 10 * capacity; ++i)
+        if (!map.get(i))
+            map.put(i, i);
+
+    int survivors = 0;
+    for (int i = 0; i < capacity / 2; ++i)
+        survivors += map.exists(i);
+    EXPECT_EQ(survivors, capacity / 2);
+}
+
+TEST(ArcEviction, RecencyGhostHitsGrowRecentList)
+{
+    ArcMapii map(10);
+    // 0 to 9 become frequent, so that recent entries are evicted first
+    for (int round = 0; round < 2; ++round)
+        for (int i = 0; i < 10; ++i)
+            if (!map.get(i))
+                map.put(i, i);
+    EXPECT_EQ(map.evictionPolicy().RecentTarget(), 0u);
+
+    // 100 to 109 are evicted from T2 and T1 and come back as ghost hits
+    for (int i = 100; i < 110; ++i)
+        map.put(i, i);
+    for (int i = 100; i < 110; ++i)
+        map.put(i, i);
+    EXPECT_GT(map.evictionPolicy().RecentTarget(), 0u);
+}
+
+TEST(ArcEviction, GhostsAreBounded)
+{
+    const std::size_t capacity = 50;
+    ArcMapii map(capacity);
+    std::mt19937 random(2);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const int key = static_cast<int>(random() % 1000);
+        if (!map.get(key))
+            map.put(key, key);
+        ASSERT_LE(map.evictionPolicy().GhostCount() + map.size(),
+            2 * capacity);
+    }
+    EXPECT_GT(map.evictionPolicy().GhostCount(), 0u);
+    EXPECT_GT(map.evictionPolicy().GhostMemoryUsage(), 0u);
+
+    // Erased entries leave no ghost, clear() drops them all
+    const std::size_t ghosts = map.evictionPolicy().GhostCount();
+    const int erased = map.begin()->first;
+    map.erase(erased);
+    EXPECT_EQ(map.evictionPolicy().GhostCount(), ghosts);
+    map.clear();
+    EXPECT_EQ(map.evictionPolicy().GhostCount(), 0u);
+    map.put(1, 1);
+    EXPECT_EQ(map.get(1), 1);
+}
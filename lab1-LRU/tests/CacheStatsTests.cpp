@@ -0,0 +1,303 @@
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "CacheStats.h"
+#include "EvictingCacheMap.h"
+#include "ShardedEvictingCacheMap.h"
+
+namespace
+{
+
+// Every reading is 100ns after the previous one
+struct SteppingClock
+{
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<SteppingClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now()
+    {
+        current += std::chrono::nanoseconds(100);
+        return time_point(current);
+    }
+
+    static inline duration current{0};
+};
+
+template <class TStats>
+using StatsMap = EvictingCacheMap<int, int, std::hash<int>,
+    std::equal_to<int>, LruEviction, std::allocator<std::pair<const int, int>>,
+    UnitWeigher, NoExpiration, TStats>;
+
+// The weight of a value is the value itself
+struct ValueWeigher
+{
+    std::size_t operator()(int, int value) const
+    {
+        return static_cast<std::size_t>(value);
+    }
+};
+
+}  // namespace
+
+TEST(LatencyHistogram, Percentiles)
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.Percentile(0.5), 0u);
+
+    for (std::uint64_t value = 1; value <= 100; ++value)
+        histogram.Record(value);
+    EXPECT_EQ(histogram.Count(), 100u);
+    EXPECT_EQ(histogram.Sum(), 5050u);
+
+    // Small values are exact, larger ones known within their bucket
+    EXPECT_EQ(histogram.Percentile(0.05), 5u);
+    const std::uint64_t median = histogram.Percentile(0.5);
+    EXPECT_GE(median, 50u);
+    EXPECT_LE(median, 50u * 9 / 8);
+    EXPECT_GE(histogram.Percentile(1.0), 100u);
+    EXPECT_LE(histogram.Percentile(1.0), 100u * 9 / 8);
+
+    for (std::uint64_t value : {0ull, 7ull, 8ull, 1000ull, 1ull << 39})
+    {
+        const std::size_t bucket = LatencyHistogram::BucketOf(value);
+        EXPECT_LE(LatencyHistogram::LowerBound(bucket), value);
+        EXPECT_GT(LatencyHistogram::LowerBound(bucket + 1), value);
+    }
+    EXPECT_EQ(LatencyHistogram::BucketOf(~0ull),
+        LatencyHistogram::Buckets - 1);
+}
+
+TEST(CacheStats, Counters)
+{
+    StatsMap<CountStats> map(2);
+    map.put(1, 1);
+    map.put(2, 2);
+    map.put(1, 10);
+    EXPECT_EQ(map.get(1), 10);
+    EXPECT_FALSE(map.get(3));
+    map.put(3, 3);
+    EXPECT_NE(map.find(3), map.end());
+    EXPECT_TRUE(map.exists(1));
+
+    const CacheStatsSnapshot stats = map.stats();
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.inserts, 3u);
+    EXPECT_EQ(stats.updates, 1u);
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_DOUBLE_EQ(stats.HitRatio(), 2.0 / 3);
+    EXPECT_EQ(stats.getLatency.Count(), 0u);
+
+    map.resetStats();
+    EXPECT_EQ(map.stats().hits, 0u);
+    EXPECT_EQ(map.stats().inserts, 0u);
+}
+
+TEST(CacheStats, Rehashes)
+{
+    StatsMap<CountStats> map(1000);
+    for (int i = 0; i < 1000; ++i)
+        map.put(i, i);
+    EXPECT_GT(map.stats().rehashes, 0u);
+
+    StatsMap<CountStats> reserved(1000);
+    reserved.reserve(1000);
+    EXPECT_EQ(reserved.stats().rehashes, 1u);
+    for (int i = 0; i < 1000; ++i)
+        reserved.put(i, i);
+    EXPECT_EQ(reserved.stats().rehashes, 1u);
+}
+
+TEST(CacheStats, Latencies)
+{
+    StatsMap<RecordStats<SteppingClock>> map(10);
+    map.put(1, 1);
+    map.put(2, 2);
+    map.get(1);
+    map.find(3);
+    map.erase(2);
+
+    const CacheStatsSnapshot stats = map.stats();
+    EXPECT_EQ(stats.putLatency.Count(), 2u);
+    EXPECT_EQ(stats.getLatency.Count(), 2u);
+    EXPECT_EQ(stats.eraseLatency.Count(), 1u);
+    EXPECT_EQ(stats.getLatency.Sum(), 200u);
+    const std::uint64_t median = stats.getLatency.Percentile(0.5);
+    EXPECT_GE(median, 100u);
+    EXPECT_LE(median, 100u * 9 / 8);
+}
+
+TEST(CacheStats, SampledLatencies)
+{
+    // Every fourth operation is measured and stands for four
+    StatsMap<RecordStats<SteppingClock, 4>> map(10);
+    for (int i = 0; i < 8; ++i)
+        map.get(i);
+
+    const CacheStatsSnapshot stats = map.stats();
+    EXPECT_EQ(stats.misses, 8u);
+    EXPECT_EQ(stats.getLatency.Count(), 8u);
+    EXPECT_EQ(stats.getLatency.Sum(), 800u);
+}
+
+TEST(CacheStats, Merge)
+{
+    StatsMap<RecordStats<SteppingClock>> first(10);
+    StatsMap<RecordStats<SteppingClock>> second(10);
+    first.put(1, 1);
+    first.get(1);
+    second.get(1);
+
+    CacheStatsSnapshot total = first.stats();
+    total.Merge(second.stats());
+    EXPECT_EQ(total.hits, 1u);
+    EXPECT_EQ(total.misses, 1u);
+    EXPECT_EQ(total.inserts, 1u);
+    EXPECT_EQ(total.getLatency.Count(), 2u);
+    EXPECT_EQ(total.putLatency.Count(), 1u);
+}
+
+TEST(CacheStats, SharedRecorder)
+{
+    auto shared = std::make_shared<CacheStats>(false);
+    StatsMap<CountStats> first(10);
+    StatsMap<CountStats> second(10);
+    first.shareStats(shared);
+    second.shareStats(shared);
+    first.put(1, 1);
+    second.put(1, 1);
+    EXPECT_EQ(shared->Snapshot().inserts, 2u);
+
+    // Copies record on their own, moves keep recording into the same stats
+    StatsMap<CountStats> copy(first);
+    copy.get(1);
+    EXPECT_EQ(shared->Snapshot().hits, 0u);
+    StatsMap<CountStats> moved(std::move(first));
+    moved.get(1);
+    EXPECT_EQ(shared->Snapshot().hits, 1u);
+}
+
+TEST(CacheStats, SharedRecorderWithoutLatencies)
+{
+    // Nothing would keep the latencies, so the clock is not read
+    auto shared = std::make_shared<CacheStats>(false);
+    StatsMap<RecordStats<SteppingClock>> map(10);
+    map.shareStats(shared);
+    const auto before = SteppingClock::current;
+    map.put(1, 1);
+    map.get(1);
+    map.erase(1);
+    EXPECT_EQ(SteppingClock::current, before);
+    EXPECT_EQ(shared->Snapshot().hits, 1u);
+}
+
+TEST(CacheStats, ConcurrentThreads)
+{
+    CacheStats stats(true, 4);
+    EXPECT_EQ(stats.Stripes(), 4u);
+
+    const int threadCount = 8;
+    const int perThread = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+        threads.emplace_back([&stats]()
+        {
+            for (int i = 0; i < perThread; ++i)
+            {
+                stats.Add(CacheStats::Counter::Hits);
+                stats.Record(CacheStats::Operation::Get, 50);
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    const CacheStatsSnapshot snapshot = stats.Snapshot();
+    EXPECT_EQ(snapshot.hits, std::uint64_t(threadCount) * perThread);
+    EXPECT_EQ(snapshot.getLatency.Count(),
+        std::uint64_t(threadCount) * perThread);
+    EXPECT_EQ(snapshot.getLatency.Sum(),
+        std::uint64_t(threadCount) * perThread * 50);
+}
+
+TEST(CacheStats, OversizeEntriesAreEvictions)
+{
+    EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+        LruEviction, std::allocator<std::pair<const int, int>>, ValueWeigher,
+        NoExpiration, CountStats>
+        map(10, 4, ValueWeigher());
+    std::size_t notified = 0;
+    map.setRemovalListener([&notified](const int&, int&&, RemovalCause cause)
+    {
+        notified += cause == RemovalCause::Capacity;
+    });
+
+    // Rejected when inserted, and when updated
+    map.put(1, 11);
+    map.put(2, 2);
+    map.put(2, 12);
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(notified, 2u);
+    EXPECT_EQ(map.stats().evictions, notified);
+}
+
+TEST(CacheStats, ShardedMap)
+{
+    ShardedEvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+        LruEviction, std::allocator<std::pair<const int, int>>, CountStats>
+        map(100, 4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&map, t]()
+        {
+            for (int i = 0; i < 1000; ++i)
+                map.getOrLoad(t * 1000 + i % 10,
+                    [](int key) { return key; });
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    const CacheStatsSnapshot stats = map.stats();
+    EXPECT_EQ(stats.hits + stats.misses, 4000u);
+    EXPECT_EQ(stats.misses, 40u);
+    EXPECT_EQ(stats.inserts, 40u);
+}
+
+TEST(CacheStats, Prometheus)
+{
+    StatsMap<RecordStats<SteppingClock>> map(1);
+    map.put(1, 1);
+    map.put(2, 2);
+    map.get(2);
+
+    std::ostringstream out;
+    WritePrometheus(out, map.stats(), "users_cache");
+    const std::string text = out.str();
+    EXPECT_NE(text.find("# TYPE users_cache_hits_total counter\n"),
+        std::string::npos);
+    EXPECT_NE(text.find("\nusers_cache_hits_total 1\n"), std::string::npos);
+    EXPECT_NE(text.find("\nusers_cache_evictions_total 1\n"),
+        std::string::npos);
+    EXPECT_NE(text.find(
+        "# TYPE users_cache_operation_duration_seconds histogram\n"),
+        std::string::npos);
+    EXPECT_NE(text.find("users_cache_operation_duration_seconds_bucket"
+        "{op=\"put\",le=\"+Inf\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("users_cache_operation_duration_seconds_count"
+        "{op=\"get\"} 1\n"), std::string::npos);
+
+    // Counters only, no histogram
+    StatsMap<CountStats> counting(1);
+    std::ostringstream countersOnly;
+    WritePrometheus(countersOnly, counting.stats());
+    EXPECT_NE(countersOnly.str().find("\ncache_misses_total 0\n"),
+        std::string::npos);
+    EXPECT_EQ(countersOnly.str().find("histogram"), std::string::npos);
+}
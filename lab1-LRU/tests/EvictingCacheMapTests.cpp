@@ -1,3 +1,13 @@
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "EvictingCacheMap.h"
 
@@ -173,6 +183,26 @@ TEST(EvictingCacheMap, FindMethod)
     }
 }
 
+TEST(EvictingCacheMap, PromoteMethod)
+{
+    EvictingCacheMapii map(4);
+    for (int i = 0; i < 4; ++i)
+        map.put(i, i);
+
+    auto it = map.findWithoutPromotion(0);
+    EXPECT_EQ(map.begin()->first, 3);
+    EXPECT_TRUE(map.promote(it));
+    EXPECT_EQ(map.begin()->first, 0);
+
+    // A removed entry is skipped as long as its node has not been reused
+    auto erased = map.findWithoutPromotion(1);
+    map.erase(1);
+    EXPECT_FALSE(map.promote(erased));
+    EXPECT_EQ(map.begin()->first, 0);
+    EXPECT_FALSE(map.promote(map.cend()));
+    EXPECT_EQ(map.size(), 3u);
+}
+
 TEST(EvictingCacheMap, EraseMethod)
 {
     EvictingCacheMapii map(4);
@@ -233,4 +263,514 @@ TEST(EvictingCacheMap, Iterators)
         EXPECT_EQ(it->first,  expected[counter++]);
         EXPECT_EQ(it->second,  expected[counter++]);
     }
-}
\ No newline at end of file
+}
+TEST(EvictingCacheMap, ManyKeys)
+{
+    const int capacity = 1000;
+    EvictingCacheMapii map(capacity);
+    for (int i = 0; i < 10 * capacity; ++i)
+        map.put(i, -i);
+
+    EXPECT_EQ(map.size(), static_cast<size_t>(capacity));
+    for (int i = 0; i < 9 * capacity; ++i)
+        EXPECT_FALSE(map.exists(i));
+    for (int i = 9 * capacity; i < 10 * capacity; ++i)
+    {
+        auto opt = map.get(i);
+        ASSERT_TRUE(opt.has_value());
+        EXPECT_EQ(opt.value(), -i);
+    }
+
+    for (int i = 9 * capacity; i < 10 * capacity; i += 2)
+        EXPECT_TRUE(map.erase(i));
+    for (int i = 9 * capacity; i < 10 * capacity; ++i)
+        EXPECT_EQ(map.exists(i), i % 2 != 0);
+}
+
+struct ConstantHash
+{
+    size_t operator()(int) const { return 42; }
+};
+
+TEST(EvictingCacheMap, CollidingHashes)
+{
+    EvictingCacheMap<int, int, ConstantHash> map(16);
+    for (int i = 0; i < 16; ++i)
+        map.put(i, i);
+
+    for (int i = 0; i < 16; i += 3)
+        EXPECT_TRUE(map.erase(i));
+    for (int i = 0; i < 16; ++i)
+        EXPECT_EQ(map.exists(i), i % 3 != 0);
+
+    for (int i = 16; i < 32; ++i)
+        map.put(i, i);
+    EXPECT_EQ(map.size(), 16u);
+    for (int i = 16; i < 32; ++i)
+        EXPECT_EQ(map.get(i).value(), i);
+}
+
+struct StringHash
+{
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const
+    {
+        return std::hash<std::string_view>()(s);
+    }
+};
+
+struct StringEqual
+{
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const
+    {
+        return a == b;
+    }
+};
+
+TEST(EvictingCacheMap, TransparentLookup)
+{
+    EvictingCacheMap<std::string, int, StringHash, StringEqual> map(2);
+    map.put(std::string("one"), 1);
+    map.put(std::string("two"), 2);
+
+    const std::string_view one = "one";
+    EXPECT_TRUE(map.exists(one));
+    EXPECT_FALSE(map.exists("three"));
+    ASSERT_NE(map.find("two"), map.end());
+    EXPECT_EQ(map.find("two")->second, 2);
+    EXPECT_EQ(map.get(one).value(), 1);
+
+    // "one" was used last, "two" is evicted
+    map.put(std::string("three"), 3);
+    EXPECT_FALSE(map.exists("two"));
+    EXPECT_TRUE(map.erase(one));
+    EXPECT_FALSE(map.erase(one));
+    EXPECT_EQ(map.size(), 1u);
+}
+
+struct CaseInsensitiveHash
+{
+    size_t operator()(const std::string& s) const
+    {
+        size_t hash = 0;
+        for (char c : s)
+            hash = hash * 31 + std::tolower(static_cast<unsigned char>(c));
+        return hash;
+    }
+};
+
+struct CaseInsensitiveEqual
+{
+    bool operator()(const std::string& a, const std::string& b) const
+    {
+        return a.size() == b.size() &&
+               std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+                   return std::tolower(static_cast<unsigned char>(x)) ==
+                          std::tolower(static_cast<unsigned char>(y));
+               });
+    }
+};
+
+TEST(EvictingCacheMap, CustomKeyEqual)
+{
+    EvictingCacheMap<std::string, int, CaseInsensitiveHash,
+        CaseInsensitiveEqual> map(4);
+    map.put(std::string("Key"), 1);
+    EXPECT_TRUE(map.exists("KEY"));
+    map.put(std::string("kEy"), 2);
+    EXPECT_EQ(map.size(), 1u);
+    EXPECT_EQ(map.get("key").value(), 2);
+    // The key keeps the spelling of its first insertion
+    EXPECT_EQ(map.begin()->first, "Key");
+    EXPECT_TRUE(map.erase("KEY"));
+    EXPECT_EQ(map.size(), 0u);
+}
+
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+    size_t deallocations = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        ++deallocations;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+        noexcept override
+    {
+        return this == &other;
+    }
+};
+
+TEST(EvictingCacheMap, PmrAllocator)
+{
+    CountingResource resource;
+    {
+        pmr::EvictingCacheMap<std::pmr::string, int> map(4, &resource);
+        map.put(std::pmr::string("a key long enough to skip SSO"), 1);
+
+        EXPECT_GT(resource.allocations, 0u);
+        EXPECT_EQ(map.begin()->first.get_allocator().resource(), &resource);
+        EXPECT_EQ(map.get_allocator().resource(), &resource);
+    }
+    EXPECT_EQ(resource.allocations, resource.deallocations);
+}
+
+TEST(EvictingCacheMap, NoAllocationsOnceWarm)
+{
+    const int capacity = 1000;
+    CountingResource resource;
+    pmr::EvictingCacheMap<int, int> map(capacity, &resource);
+    for (int i = 0; i < capacity; ++i)
+        map.put(i, i);
+
+    const size_t warmAllocations = resource.allocations;
+    const size_t warmDeallocations = resource.deallocations;
+    for (int i = capacity; i < 100 * capacity; ++i)
+    {
+        map.put(i, i);
+        map.get(i - capacity / 2);
+        if (i % 3 == 0)
+            map.erase(i - 1);
+    }
+    map.clear();
+    for (int i = 0; i < capacity; ++i)
+        map.put(i, i);
+
+    EXPECT_EQ(resource.allocations, warmAllocations);
+    EXPECT_EQ(resource.deallocations, warmDeallocations);
+}
+
+template <class T>
+struct CountingAllocator
+{
+    using value_type = T;
+
+    explicit CountingAllocator(size_t* live) : live(live) {}
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>& other) : live(other.live) {}
+
+    T* allocate(size_t n)
+    {
+        ++*live;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        --*live;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <class U>
+    bool operator==(const CountingAllocator<U>& other) const
+    {
+        return live == other.live;
+    }
+    template <class U>
+    bool operator!=(const CountingAllocator<U>& other) const
+    {
+        return live != other.live;
+    }
+
+    size_t* live;
+};
+
+TEST(EvictingCacheMap, CustomAllocator)
+{
+    using Map = EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+        LruEviction, CountingAllocator<std::pair<const int, int>>>;
+
+    size_t live = 0;
+    {
+        Map map(64, CountingAllocator<std::pair<const int, int>>(&live));
+        for (int i = 0; i < 1000; ++i)
+            map.put(i, i);
+        EXPECT_GT(live, 0u);
+
+        Map mapcpy(map);
+        Map mapmoved(std::move(mapcpy));
+        mapcpy = mapmoved;
+        EXPECT_EQ(mapcpy.size(), 64u);
+        EXPECT_EQ(mapcpy.begin()->first, 999);
+    }
+    EXPECT_EQ(live, 0u);
+}
+
+struct LengthWeigher
+{
+    size_t operator()(int, const std::string& value) const
+    {
+        return value.size();
+    }
+};
+
+using WeightedMap = EvictingCacheMap<int, std::string, std::hash<int>,
+    std::equal_to<int>, LruEviction,
+    std::allocator<std::pair<const int, std::string>>, LengthWeigher>;
+
+TEST(EvictingCacheMap, WeightedEvictsUntilFits)
+{
+    WeightedMap map(10, 4, LengthWeigher());
+    map.put(1, "aaaa");
+    map.put(2, "bbbb");
+    map.put(3, "cc");
+    EXPECT_EQ(map.size(), 3u);
+    EXPECT_EQ(map.weight(), 10u);
+
+    map.put(4, "ddddd");
+    EXPECT_FALSE(map.exists(1));
+    EXPECT_FALSE(map.exists(2));
+    EXPECT_TRUE(map.exists(3));
+    EXPECT_TRUE(map.exists(4));
+    EXPECT_EQ(map.weight(), 7u);
+
+    map.put(5, "");
+    EXPECT_EQ(map.size(), 3u);
+    EXPECT_EQ(map.weight(), 7u);
+}
+
+TEST(EvictingCacheMap, WeightedOversizeEntry)
+{
+    WeightedMap map(10, 4, LengthWeigher());
+    map.put(1, "aaaa");
+    map.put(2, "bbbbbbbbbbb");
+    EXPECT_FALSE(map.exists(2));
+    EXPECT_TRUE(map.exists(1));
+
+    map.put(1, "aaaaaaaaaaa");
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.weight(), 0u);
+}
+
+TEST(EvictingCacheMap, WeightedUpdate)
+{
+    WeightedMap map(10, 4, LengthWeigher());
+    map.put(1, "aa");
+    map.put(2, "bb");
+    map.put(3, "cc");
+
+    map.put(2, "bbbbbbb");
+    EXPECT_EQ(map.weight(), 9u);
+    EXPECT_FALSE(map.exists(1));
+
+    map.put(2, "b");
+    EXPECT_EQ(map.weight(), 3u);
+    EXPECT_EQ(map.size(), 2u);
+
+    map.erase(3);
+    EXPECT_EQ(map.weight(), 1u);
+    map.clear();
+    EXPECT_EQ(map.weight(), 0u);
+}
+
+TEST(EvictingCacheMap, WeightedCopyAndMove)
+{
+    WeightedMap map(10, 4, LengthWeigher());
+    map.put(1, "aaa");
+    map.put(2, "bbbb");
+
+    WeightedMap mapcpy(map);
+    EXPECT_EQ(mapcpy.weight(), 7u);
+    WeightedMap mapmoved(std::move(mapcpy));
+    EXPECT_EQ(mapmoved.weight(), 7u);
+    EXPECT_EQ(mapcpy.weight(), 0u);
+
+    mapmoved.put(3, "cccc");
+    EXPECT_FALSE(mapmoved.exists(1));
+    EXPECT_EQ(map.weight(), 7u);
+}
+
+TEST(EvictingCacheMap, ReserveAllocatesUpFront)
+{
+    const int capacity = 100000;
+    CountingResource resource;
+    pmr::EvictingCacheMap<int, int> map(capacity, &resource);
+    map.reserve(2 * capacity);
+
+    const size_t allocations = resource.allocations;
+    for (int i = 0; i < capacity; ++i)
+        map.put(i, i);
+    EXPECT_EQ(resource.allocations, allocations);
+    for (int i = 0; i < capacity; ++i)
+        ASSERT_EQ(map.get(i), i);
+}
+
+TEST(EvictingCacheMap, GrowsIncrementally)
+{
+    EvictingCacheMapii map(100000);
+    for (int i = 0; i < 100000; ++i)
+    {
+        map.put(i, i);
+        if (i % 3 == 0)
+            map.erase(i / 2);
+    }
+    for (int i = 0; i < 100000; ++i)
+    {
+        const bool erased = (2 * i) % 3 == 0 || (2 * i + 1) % 3 == 0;
+        ASSERT_EQ(map.exists(i), i >= 50000 || !erased) << i;
+    }
+}
+
+TEST(EvictingCacheMap, MultiGet)
+{
+    EvictingCacheMapii map(100);
+    for (int i = 0; i < 100; ++i)
+        map.put(i, i * 2);
+
+    std::vector<int> keys;
+    for (int i = 0; i < 150; i += 3)
+        keys.push_back(i);
+    std::vector<std::optional<int>> values;
+    map.multiGet(keys.begin(), keys.end(), std::back_inserter(values));
+
+    ASSERT_EQ(values.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (keys[i] < 100)
+            EXPECT_EQ(values[i], keys[i] * 2);
+        else
+            EXPECT_FALSE(values[i].has_value());
+    }
+
+    // Found keys were accessed in order, so the last one is the most recent
+    EXPECT_EQ(map.begin()->first, 99);
+}
+
+TEST(EvictingCacheMap, MultiPut)
+{
+    EvictingCacheMapii map(50);
+    EvictingCacheMapii expected(50);
+    std::vector<std::pair<int, int>> entries;
+    for (int i = 0; i < 200; ++i)
+        entries.emplace_back(i % 70, i);
+    for (const auto& entry : entries)
+        expected.put(entry.first, entry.second);
+
+    map.multiPut(entries.begin(), entries.end());
+    ASSERT_EQ(map.size(), expected.size());
+    for (auto it = map.begin(), jt = expected.begin(); it != map.end();
+         ++it, ++jt)
+    {
+        EXPECT_EQ(it->first, jt->first);
+        EXPECT_EQ(it->second, jt->second);
+    }
+}
+
+TEST(EvictingCacheMap, MultiPutMovesEntries)
+{
+    EvictingCacheMap<std::string, std::string, StringHash, StringEqual>
+        map(10);
+    std::vector<std::pair<std::string, std::string>> entries = {
+        {"one", std::string(100, '1')}, {"two", std::string(100, '2')}};
+    map.multiPut(std::make_move_iterator(entries.begin()),
+                 std::make_move_iterator(entries.end()));
+    EXPECT_TRUE(entries[0].second.empty());
+
+    const std::string_view keys[] = {"two", "three", "one"};
+    std::optional<std::string> values[3];
+    map.multiGet(std::begin(keys), std::end(keys), values);
+    EXPECT_EQ(values[0], std::string(100, '2'));
+    EXPECT_FALSE(values[1].has_value());
+    EXPECT_EQ(values[2], std::string(100, '1'));
+}
+
+struct Removed
+{
+    std::string key;
+    std::string value;
+    RemovalCause cause;
+};
+
+TEST(EvictingCacheMap, RemovalListener)
+{
+    EvictingCacheMap<std::string, std::string> map(2);
+    std::vector<Removed> removed;
+    map.setRemovalListener(
+        [&removed](const std::string& key, std::string&& value,
+            RemovalCause cause)
+        {
+            removed.push_back({key, std::move(value), cause});
+        });
+
+    map.put("one", "1");
+    map.put("two", "2");
+    map.put("one", "uno");
+    map.put("three", "3");
+    map.erase("three");
+    map.erase("three");
+    map.put("four", "4");
+    map.clear();
+
+    ASSERT_EQ(removed.size(), 5u);
+    EXPECT_EQ(removed[0].key, "one");
+    EXPECT_EQ(removed[0].value, "1");
+    EXPECT_EQ(removed[0].cause, RemovalCause::Replaced);
+    EXPECT_EQ(removed[1].key, "two");
+    EXPECT_EQ(removed[1].cause, RemovalCause::Capacity);
+    EXPECT_EQ(removed[2].key, "three");
+    EXPECT_EQ(removed[2].cause, RemovalCause::Erased);
+    EXPECT_EQ(removed[3].cause, RemovalCause::Cleared);
+    EXPECT_EQ(removed[4].cause, RemovalCause::Cleared);
+    EXPECT_EQ(removed[3].value + removed[4].value, "4uno");
+
+    // Destruction and assignment are not reported
+    map.put("five", "5");
+    removed.clear();
+    map = EvictingCacheMap<std::string, std::string>(2);
+    EXPECT_TRUE(removed.empty());
+
+    map.setRemovalListener(nullptr);
+    map.put("six", "6");
+    map.clear();
+    EXPECT_TRUE(removed.empty());
+}
+
+TEST(EvictingCacheMap, RemovalListenerMovesValue)
+{
+    EvictingCacheMap<int, std::unique_ptr<int>> map(1);
+    std::vector<int> released;
+    map.setRemovalListener(
+        [&released](int, std::unique_ptr<int>&& value, RemovalCause)
+        {
+            std::unique_ptr<int> owned = std::move(value);
+            released.push_back(*owned);
+        });
+    map.put(1, std::make_unique<int>(10));
+    map.put(2, std::make_unique<int>(20));
+    map.put(2, std::make_unique<int>(21));
+    EXPECT_EQ(released, (std::vector<int>{10, 20}));
+}
+
+TEST(EvictingCacheMap, WeightedRemovalListener)
+{
+    WeightedMap map(10, 4, LengthWeigher());
+    std::vector<std::pair<int, RemovalCause>> removed;
+    map.setRemovalListener(
+        [&removed](int key, std::string&&, RemovalCause cause)
+        {
+            removed.emplace_back(key, cause);
+        });
+    map.put(1, "aaaa");
+    map.put(2, "bbbb");
+    map.put(3, "ccccc");
+    map.put(4, "ddddddddddd");
+    map.put(3, "ccccccccccc");
+
+    const std::vector<std::pair<int, RemovalCause>> expected = {
+        {1, RemovalCause::Capacity}, {4, RemovalCause::Capacity},
+        {3, RemovalCause::Replaced}, {3, RemovalCause::Capacity}};
+    EXPECT_EQ(removed, expected);
+    EXPECT_EQ(map.size(), 1u);
+}
@@ -0,0 +1,170 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ArcEviction.h"
+#include "EvictingCacheMap.h"
+#include "LfuEviction.h"
+#include "TinyLfuEviction.h"
+
+template <class TPolicy>
+class EvictionPolicy : public ::testing::Test
+{
+protected:
+    using Map =
+        EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>, TPolicy>;
+};
+
+using EvictionPolicyTypes = ::testing::Types<
+    LruEviction, ClockEviction, SieveEviction, WTinyLfuEviction, ArcEviction,
+    LfuEviction<>, LfuEviction<1>>;
+TYPED_TEST_SUITE(EvictionPolicy, EvictionPolicyTypes);
+
+TYPED_TEST(EvictionPolicy, SizeIsBounded)
+{
+    typename TestFixture::Map map(16);
+    for (int i = 0; i < 1000; ++i)
+    {
+        map.put(i, i);
+        map.get(i / 2);
+        EXPECT_LE(map.size(), 16u);
+        EXPECT_TRUE(map.exists(i));
+    }
+    EXPECT_EQ(map.size(), 16u);
+
+    size_t counted = 0;
+    for (auto it = map.begin(); it != map.end(); ++it)
+    {
+        EXPECT_EQ(it->first, it->second);
+        ++counted;
+    }
+    EXPECT_EQ(counted, 16u);
+}
+
+TYPED_TEST(EvictionPolicy, EraseAndClear)
+{
+    typename TestFixture::Map map(8);
+    for (int i = 0; i < 8; ++i)
+        map.put(i, i);
+    for (int i = 0; i < 8; i += 2)
+        map.get(i);
+    for (int i = 1; i < 8; i += 2)
+        EXPECT_TRUE(map.erase(i));
+
+    for (int i = 8; i < 40; ++i)
+        map.put(i, i);
+    EXPECT_EQ(map.size(), 8u);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    for (int i = 0; i < 40; ++i)
+        map.put(i, i);
+    EXPECT_EQ(map.size(), 8u);
+}
+
+TYPED_TEST(EvictionPolicy, CopyAndMove)
+{
+    typename TestFixture::Map map(8);
+    for (int i = 0; i < 20; ++i)
+    {
+        map.put(i, i);
+        map.get(i - 3);
+    }
+
+    typename TestFixture::Map mapcpy(map);
+    std::vector<int> expected, actual;
+    for (auto& entry : map)
+        expected.push_back(entry.first);
+    for (auto& entry : mapcpy)
+        actual.push_back(entry.first);
+    EXPECT_EQ(expected, actual);
+
+    typename TestFixture::Map mapmoved(std::move(mapcpy));
+    for (int i = 20; i < 40; ++i)
+    {
+        mapmoved.put(i, i);
+        mapcpy.put(i, i);
+    }
+    EXPECT_EQ(mapmoved.size(), 8u);
+    EXPECT_EQ(mapcpy.size(), 8u);
+}
+
+TEST(SieveEviction, HitsDoNotReorder)
+{
+    EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+        SieveEviction> map(4);
+    for (int i = 0; i < 4; ++i)
+        map.put(i, i);
+
+    map.get(0);
+    map.find(2);
+
+    int expected[] = {3, 2, 1, 0};
+    int counter = 0;
+    for (auto& entry : map)
+        EXPECT_EQ(entry.first, expected[counter++]);
+}
+
+TEST(SieveEviction, HandSweep)
+{
+    EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+        SieveEviction> map(4);
+    for (int i = 0; i < 4; ++i)
+        map.put(i, i);
+    map.get(0);
+    map.get(2);
+
+    // The hand clears 0 and evicts 1, then stops at 2
+    map.put(4, 4);
+    EXPECT_FALSE(map.exists(1));
+    EXPECT_TRUE(map.exists(0));
+    EXPECT_TRUE(map.exists(2));
+
+    // 2 gets cleared, 3 is evicted
+    map.put(5, 5);
+    EXPECT_FALSE(map.exists(3));
+    EXPECT_TRUE(map.exists(2));
+
+    // The hand keeps moving towards the newer entries, the survivors of the
+    // first sweep stay at the back
+    map.put(6, 6);
+    EXPECT_FALSE(map.exists(4));
+    map.put(7, 7);
+    EXPECT_FALSE(map.exists(5));
+    map.put(8, 8);
+    EXPECT_FALSE(map.exists(6));
+    map.put(9, 9);
+    EXPECT_FALSE(map.exists(7));
+    EXPECT_TRUE(map.exists(0));
+    EXPECT_TRUE(map.exists(2));
+
+    // A stream of one-hit wonders never displaces the survivors
+    for (int i = 10; i < 100; ++i)
+    {
+        map.put(i, i);
+        EXPECT_FALSE(map.exists(i - 2));
+    }
+    EXPECT_TRUE(map.exists(0));
+    EXPECT_TRUE(map.exists(2));
+}
+
+TEST(ClockEviction, SecondChance)
+{
+    EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+        ClockEviction> map(4);
+    for (int i = 0; i < 4; ++i)
+        map.put(i, i);
+    map.get(0);
+    map.get(2);
+    EXPECT_EQ(map.begin()->first, 3);
+
+    map.put(4, 4);
+    EXPECT_FALSE(map.exists(1));
+
+    map.put(5, 5);
+    EXPECT_FALSE(map.exists(3));
+
+    int expected[] = {5, 2, 4, 0};
+    int counter = 0;
+    for (auto& entry : map)
+        EXPECT_EQ(entry.first, expected[counter++]);
+}
@@ -0,0 +1,203 @@
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "EvictingCacheMap.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct FakeClock
+{
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<FakeClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return time_point(current); }
+
+    static inline duration current{0};
+};
+
+template <class TExpiration>
+using ExpiringMap = EvictingCacheMap<int, int, std::hash<int>,
+    std::equal_to<int>, LruEviction, std::allocator<std::pair<const int, int>>,
+    UnitWeigher, TExpiration>;
+
+using WriteMap = ExpiringMap<ExpireAfterWrite<FakeClock>>;
+using AccessMap = ExpiringMap<ExpireAfterAccess<FakeClock>>;
+
+class Expiration : public ::testing::Test
+{
+protected:
+    void SetUp() override { FakeClock::current = 1s; }
+};
+
+}  // namespace
+
+TEST_F(Expiration, AfterWrite)
+{
+    WriteMap map(10);
+    map.put(1, 1, 10ms);
+    map.put(2, 2);
+
+    FakeClock::current += 5ms;
+    EXPECT_EQ(map.get(1), 1);
+    FakeClock::current += 6ms;
+    EXPECT_FALSE(map.exists(1));
+    EXPECT_FALSE(map.get(1));
+    EXPECT_EQ(map.size(), 1u);
+
+    FakeClock::current += 24h;
+    EXPECT_EQ(map.get(2), 2);
+}
+
+TEST_F(Expiration, PutRestartsTtl)
+{
+    WriteMap map(10);
+    map.put(1, 1, 10ms);
+    FakeClock::current += 8ms;
+    map.put(1, 2, 10ms);
+    FakeClock::current += 8ms;
+    EXPECT_EQ(map.get(1), 2);
+
+    map.put(1, 3);
+    FakeClock::current += 1h;
+    EXPECT_EQ(map.get(1), 3);
+}
+
+TEST_F(Expiration, AfterAccess)
+{
+    AccessMap map(10);
+    map.put(1, 1, 10ms);
+    map.put(2, 2, 10ms);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        FakeClock::current += 8ms;
+        EXPECT_EQ(map.get(1), 1);
+    }
+    EXPECT_FALSE(map.exists(2));
+    FakeClock::current += 11ms;
+    EXPECT_FALSE(map.exists(1));
+}
+
+TEST_F(Expiration, ExpiredEntryInvisibleBeforeReclaim)
+{
+    WriteMap map(10);
+    map.put(1, 1, 1us);
+    FakeClock::current += 2us;
+
+    EXPECT_FALSE(map.exists(1));
+    EXPECT_EQ(map.size(), 1u);
+    EXPECT_TRUE(map.find(1) == map.end());
+    EXPECT_EQ(map.size(), 0u);
+}
+
+TEST_F(Expiration, BatchReclaim)
+{
+    const int count = 1000;
+    WriteMap map(count);
+    for (int i = 0; i < count; ++i)
+        map.put(i, i, std::chrono::milliseconds(1 + i % 100));
+
+    FakeClock::current += 50ms;
+    map.cleanUp();
+    EXPECT_GT(map.size(), 0u);
+    EXPECT_LT(map.size(), count / 2 + count / 100 + 1u);
+
+    FakeClock::current += 1s;
+    map.put(count, count);
+    EXPECT_EQ(map.size(), 1u);
+}
+
+TEST_F(Expiration, EvictedAndErasedEntries)
+{
+    WriteMap map(2);
+    map.put(1, 1, 10ms);
+    map.put(2, 2, 10ms);
+    map.put(3, 3, 10ms);
+    map.erase(2);
+    EXPECT_FALSE(map.exists(1));
+
+    FakeClock::current += 20ms;
+    map.cleanUp();
+    EXPECT_TRUE(map.empty());
+
+    map.put(4, 4, 10ms);
+    map.clear();
+    FakeClock::current += 20ms;
+    map.cleanUp();
+    EXPECT_TRUE(map.empty());
+}
+
+TEST_F(Expiration, CopyAndMove)
+{
+    WriteMap map(10);
+    map.put(1, 1, 10ms);
+    map.put(2, 2, 1h);
+
+    WriteMap mapcpy(map);
+    WriteMap mapmoved(std::move(map));
+    FakeClock::current += 20ms;
+    mapcpy.cleanUp();
+    mapmoved.cleanUp();
+    EXPECT_EQ(mapcpy.size(), 1u);
+    EXPECT_EQ(mapmoved.size(), 1u);
+    EXPECT_TRUE(mapcpy.exists(2));
+
+    map.put(3, 3, 10ms);
+    FakeClock::current += 20ms;
+    EXPECT_FALSE(map.get(3));
+}
+
+TEST_F(Expiration, RemovalListener)
+{
+    WriteMap map(10);
+    std::vector<std::pair<int, RemovalCause>> removed;
+    map.setRemovalListener(
+        [&removed](int key, int&&, RemovalCause cause)
+        {
+            removed.emplace_back(key, cause);
+        });
+    map.put(1, 1, 10ms);
+    map.put(2, 2, 10ms);
+    map.put(3, 3, 1h);
+
+    FakeClock::current += 20ms;
+    EXPECT_FALSE(map.get(1));
+    map.cleanUp();
+
+    ASSERT_EQ(removed.size(), 2u);
+    EXPECT_EQ(removed[0].second, RemovalCause::Expired);
+    EXPECT_EQ(removed[1].second, RemovalCause::Expired);
+    EXPECT_EQ(removed[0].first + removed[1].first, 3);
+}
+
+TEST_F(Expiration, EraseOfExpiredEntry)
+{
+    WriteMap map(10);
+    std::vector<std::pair<int, RemovalCause>> removed;
+    map.setRemovalListener(
+        [&removed](int key, int&&, RemovalCause cause)
+        {
+            removed.emplace_back(key, cause);
+        });
+    map.put(1, 1, 1us);
+    map.put(2, 2, 1h);
+
+    // Due, but its bucket of the wheel has not passed yet
+    FakeClock::current += 2us;
+    EXPECT_FALSE(map.erase(1));
+    EXPECT_TRUE(map.erase(2));
+    EXPECT_TRUE(map.empty());
+
+    ASSERT_EQ(removed.size(), 2u);
+    EXPECT_EQ(removed[0], std::make_pair(1, RemovalCause::Expired));
+    EXPECT_EQ(removed[1], std::make_pair(2, RemovalCause::Erased));
+}
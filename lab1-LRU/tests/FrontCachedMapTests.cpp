@@ -0,0 +1,151 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "CacheStats.h"
+#include "FrontCachedMap.h"
+
+namespace
+{
+
+using CountingMap = FrontCachedMap<int, int, std::hash<int>,
+    std::equal_to<int>, LruEviction, std::allocator<std::pair<const int, int>>,
+    CountStats>;
+
+}  // namespace
+
+TEST(FrontCachedMap, RepeatedHitsStayInFront)
+{
+    CountingMap map(100, 16, 64, 4);
+    map.put(1, 10);
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(map.get(1), 10);
+    EXPECT_EQ(map.sharedMap().stats().hits, 1u);
+
+    // Misses are not cached
+    EXPECT_FALSE(map.get(2));
+    EXPECT_FALSE(map.get(2));
+    EXPECT_EQ(map.sharedMap().stats().misses, 2u);
+}
+
+TEST(FrontCachedMap, PutAndEraseInvalidate)
+{
+    FrontCachedMap<int, std::string> map(100, 16, 64, 4);
+    map.put(1, "one");
+    EXPECT_EQ(map.get(1), "one");
+    map.put(1, "uno");
+    EXPECT_EQ(map.get(1), "uno");
+    EXPECT_TRUE(map.erase(1));
+    EXPECT_FALSE(map.get(1));
+    EXPECT_FALSE(map.erase(1));
+
+    map.put(2, "two");
+    EXPECT_EQ(map.get(2), "two");
+    map.clear();
+    EXPECT_FALSE(map.get(2));
+    EXPECT_EQ(map.size(), 0u);
+}
+
+TEST(FrontCachedMap, CollidingKeys)
+{
+    // One front entry and one stamp for all keys
+    FrontCachedMap<int, int> map(100, 1, 1, 1);
+    for (int i = 0; i < 10; ++i)
+        map.put(i, i);
+    for (int round = 0; round < 3; ++round)
+        for (int i = 0; i < 10; ++i)
+            EXPECT_EQ(map.get(i), i);
+}
+
+TEST(FrontCachedMap, GetOrLoad)
+{
+    CountingMap map(100, 16, 64, 4);
+    int loads = 0;
+    auto loader = [&loads](int key) { ++loads; return key * 2; };
+    EXPECT_EQ(map.getOrLoad(5, loader), 10);
+    EXPECT_EQ(map.getOrLoad(5, loader), 10);
+    EXPECT_EQ(loads, 1);
+    EXPECT_EQ(map.sharedMap().stats().hits, 0u);
+
+    map.put(5, 11);
+    EXPECT_EQ(map.getOrLoad(5, loader), 11);
+}
+
+TEST(FrontCachedMap, OtherThreadsSeeUpdates)
+{
+    FrontCachedMap<int, int> map(100, 16, 64, 4);
+    map.put(1, 1);
+    std::thread([&map]() { EXPECT_EQ(map.get(1), 1); }).join();
+    map.put(1, 2);
+    std::thread([&map]() { EXPECT_EQ(map.get(1), 2); }).join();
+
+    // A reader thread which cached the value before the update
+    std::atomic<int> step{0};
+    std::thread reader([&map, &step]()
+    {
+        EXPECT_EQ(map.get(1), 2);
+        step = 1;
+        while (step != 2)
+            std::this_thread::yield();
+        EXPECT_EQ(map.get(1), 3);
+    });
+    while (step != 1)
+        std::this_thread::yield();
+    map.put(1, 3);
+    step = 2;
+    reader.join();
+}
+
+TEST(FrontCachedMap, ConcurrentReadersNeverGoBack)
+{
+    // Values of a key only grow, so a reader seeing a smaller value than it
+    // saw before read a stale front entry
+    FrontCachedMap<int, int> map(64, 8, 16, 4);
+    const int keyCount = 8;
+    for (int key = 0; key < keyCount; ++key)
+        map.put(key, 0);
+
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t)
+        readers.emplace_back([&map, &done, &failures]()
+        {
+            int seen[keyCount] = {};
+            while (!done)
+            {
+                for (int key = 0; key < keyCount; ++key)
+                {
+                    const auto value = map.get(key);
+                    if (!value || *value < seen[key])
+                        ++failures;
+                    else
+                        seen[key] = *value;
+                }
+            }
+        });
+    for (int value = 1; value <= 2000; ++value)
+        map.put(value % keyCount, value);
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+    EXPECT_EQ(failures, 0);
+}
+
+TEST(FrontCachedMap, DestroyedMapsReleaseFrontCaches)
+{
+    auto first = std::make_unique<FrontCachedMap<int, int>>(10);
+    first->put(1, 1);
+    EXPECT_EQ(first->get(1), 1);
+    first.reset();
+
+    // Possibly at the same address, but not sharing front entries
+    FrontCachedMap<int, int> second(10);
+    EXPECT_FALSE(second.get(1));
+    second.put(1, 2);
+    EXPECT_EQ(second.get(1), 2);
+}
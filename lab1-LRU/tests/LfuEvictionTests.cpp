@@ -0,0 +1,124 @@
+#include <random>
+
+#include "gtest/gtest.h"
+#include "EvictingCacheMap.h"
+#include "LfuEviction.h"
+
+using LfuMapii = EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+    LfuEviction<>>;
+using AgingLfuMapii = EvictingCacheMap<int, int, std::hash<int>,
+    std::equal_to<int>, LfuEviction<2>>;
+
+TEST(LfuEviction, EvictsLeastFrequent)
+{
+    LfuMapii map(4);
+    for (int i = 0; i < 4; ++i)
+        map.put(i, i);
+    // Counts 0:4, 1:1, 2:3, 3:2
+    for (int round = 0; round < 3; ++round)
+        map.get(0);
+    map.get(2);
+    map.get(2);
+    map.get(3);
+
+    map.put(4, 4);
+    EXPECT_FALSE(map.exists(1));
+    // 4 is the only entry seen once
+    map.put(5, 5);
+    EXPECT_FALSE(map.exists(4));
+    map.get(5);
+    // 3 and 5 are both seen twice, 3 less recently
+    map.put(6, 6);
+    map.put(7, 7);
+    EXPECT_FALSE(map.exists(6));
+    EXPECT_FALSE(map.exists(3));
+    EXPECT_TRUE(map.exists(0));
+    EXPECT_TRUE(map.exists(2));
+    EXPECT_TRUE(map.exists(5));
+}
+
+TEST(LfuEviction, Buckets)
+{
+    LfuMapii map(8);
+    for (int i = 0; i < 8; ++i)
+        map.put(i, i);
+    EXPECT_EQ(map.evictionPolicy().BucketCount(), 1u);
+
+    // An entry alone in its bucket only bumps the count
+    map.get(0);
+    map.get(0);
+    map.get(0);
+    EXPECT_EQ(map.evictionPolicy().BucketCount(), 2u);
+    map.get(1);
+    EXPECT_EQ(map.evictionPolicy().BucketCount(), 3u);
+    map.get(1);
+    map.get(1);
+    EXPECT_EQ(map.evictionPolicy().BucketCount(), 2u);
+
+    map.erase(0);
+    map.erase(1);
+    EXPECT_EQ(map.evictionPolicy().BucketCount(), 1u);
+    map.clear();
+    EXPECT_EQ(map.evictionPolicy().BucketCount(), 0u);
+    map.put(1, 1);
+    EXPECT_EQ(map.get(1), 1);
+}
+
+TEST(LfuEviction, AgingEvictsFormerlyPopular)
+{
+    const int capacity = 10;
+    LfuMapii plain(capacity);
+    AgingLfuMapii aging(capacity);
+    auto access = [](auto& map, int key) {
+        if (!map.get(key))
+            map.put(key, key);
+    };
+
+    // Keys 0 to 4 are very popular first, then 100 to 109 take over
+    for (int round = 0; round < 50; ++round)
+        for (int i = 0; i < 5; ++i)
+        {
+            access(plain, i);
+            access(aging, i);
+        }
+    for (int round = 0; round < 20; ++round)
+        for (int i = 100; i < 110; ++i)
+        {
+            access(plain, i);
+            access(aging, i);
+        }
+
+    int plainHits = 0;
+    int agingHits = 0;
+    for (int i = 100; i < 110; ++i)
+    {
+        plainHits += plain.exists(i);
+        agingHits += aging.exists(i);
+    }
+    EXPECT_LE(plainHits, capacity / 2);
+    EXPECT_GE(agingHits, capacity - 1);
+    // Aging merged the buckets of 0 to 4 with the ones of the new keys
+    EXPECT_LE(aging.evictionPolicy().BucketCount(), 4u);
+}
+
+TEST(LfuEviction, RandomAccessKeepsBucketsConsistent)
+{
+    AgingLfuMapii map(64);
+    std::mt19937 random(3);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const int key = static_cast<int>(random() % 256);
+        switch (random() % 8)
+        {
+        case 0:
+            map.erase(key);
+            break;
+        default:
+            if (!map.get(key))
+                map.put(key, key);
+            break;
+        }
+        ASSERT_LE(map.evictionPolicy().BucketCount(), map.size());
+    }
+    EXPECT_EQ(map.size(), 64u);
+}
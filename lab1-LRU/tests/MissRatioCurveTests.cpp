@@ -0,0 +1,112 @@
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "EvictingCacheMap.h"
+#include "MissRatioCurve.h"
+#include "RobinHoodIndex.h"
+#include "StackDistance.h"
+
+namespace
+{
+
+std::uint32_t HashOf(std::uint64_t key)
+{
+    return RobinHoodIndex<int>::Mix(key);
+}
+
+// Keys drawn with a skewed distribution, rank k with probability ~ 1/k
+std::vector<std::uint64_t> SkewedTrace(std::size_t length, std::uint64_t keys)
+{
+    std::mt19937_64 random(11);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<std::uint64_t> trace(length);
+    for (auto& key : trace)
+        key = static_cast<std::uint64_t>(
+            std::pow(static_cast<double>(keys), uniform(random))) - 1;
+    return trace;
+}
+
+double ExactMissRatio(const std::vector<std::uint64_t>& trace,
+    std::uint64_t capacity)
+{
+    StackDistance stack;
+    std::size_t misses = 0;
+    for (std::uint64_t key : trace)
+        misses += stack.Access(key).entries > capacity;
+    return static_cast<double>(misses) / trace.size();
+}
+
+}  // namespace
+
+TEST(MissRatioCurve, ExactWithoutSampling)
+{
+    // Keys 0..9 accessed round-robin: LRU needs all ten to hit
+    MissRatioCurve curve(100, 1.0);
+    for (int round = 0; round < 100; ++round)
+        for (std::uint64_t key = 0; key < 10; ++key)
+            curve.Reference(HashOf(key));
+
+    EXPECT_DOUBLE_EQ(curve.Rate(), 1.0);
+    EXPECT_EQ(curve.Samples(), 10u);
+    EXPECT_DOUBLE_EQ(curve.MissRatio(9), 1.0);
+    EXPECT_NEAR(curve.MissRatio(10), 0.01, 1e-9);
+    EXPECT_NEAR(curve.HitRatio(1000), 0.99, 1e-9);
+}
+
+TEST(MissRatioCurve, SampledEstimate)
+{
+    const auto trace = SkewedTrace(1000000, 100000);
+    MissRatioCurve curve(2000, 1.0);
+    for (std::uint64_t key : trace)
+        curve.Reference(HashOf(key));
+
+    // The sample bound forced the rate down
+    EXPECT_LE(curve.Samples(), 2000u);
+    EXPECT_LT(curve.Rate(), 0.1);
+    for (std::uint64_t capacity : {1000, 10000, 50000})
+        EXPECT_NEAR(curve.MissRatio(capacity),
+            ExactMissRatio(trace, capacity), 0.05) << capacity;
+}
+
+TEST(MissRatioCurve, Points)
+{
+    MissRatioCurve curve;
+    EXPECT_DOUBLE_EQ(curve.MissRatio(10), 1.0);
+    const auto points = curve.Points(1000);
+    ASSERT_EQ(points.size(), 10u);
+    EXPECT_EQ(points.front().first, 1u);
+    EXPECT_EQ(points.back().first, 512u);
+}
+
+TEST(EvictingCacheMap, TracksMissRatioCurve)
+{
+    EvictingCacheMap<int, int> map(100);
+    EXPECT_EQ(map.missRatioCurve(), nullptr);
+    map.trackMissRatioCurve(1000, 1.0);
+
+    // 200 keys in a loop: the map itself always misses, twice its capacity
+    // would always hit
+    for (int round = 0; round < 50; ++round)
+        for (int key = 0; key < 200; ++key)
+            if (!map.get(key))
+                map.put(key, key);
+
+    const MissRatioCurve* curve = map.missRatioCurve();
+    ASSERT_NE(curve, nullptr);
+    EXPECT_DOUBLE_EQ(curve->MissRatio(100), 1.0);
+    // Distances are bucketed, 200 is only counted in full from the end of
+    // its bucket [192, 208) on
+    EXPECT_NEAR(curve->MissRatio(208), 0.02, 1e-9);
+
+    // Copies do not track, moves take the tracker along
+    EvictingCacheMap<int, int> copy(map);
+    EXPECT_EQ(copy.missRatioCurve(), nullptr);
+    EvictingCacheMap<int, int> moved(std::move(map));
+    EXPECT_EQ(moved.missRatioCurve(), curve);
+
+    moved.stopTrackingMissRatioCurve();
+    EXPECT_EQ(moved.missRatioCurve(), nullptr);
+}
@@ -0,0 +1,156 @@
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "EpochReclamation.h"
+#include "ReadMostlyCacheMap.h"
+
+TEST(EpochReclamation, PinnedThreadsHoldBackReclamation)
+{
+    const std::uint64_t retired = EpochReclamation::Advance();
+    EXPECT_GT(EpochReclamation::MinPinned(), retired);
+    {
+        EpochReclamation::Guard guard;
+        const std::uint64_t later = EpochReclamation::Advance();
+        EXPECT_LE(EpochReclamation::MinPinned(), later);
+        {
+            EpochReclamation::Guard nested;
+            EXPECT_LE(EpochReclamation::MinPinned(), later);
+        }
+        EXPECT_LE(EpochReclamation::MinPinned(), later);
+
+        std::thread([later]()
+        {
+            // Pinned by another thread
+            EXPECT_LE(EpochReclamation::MinPinned(), later);
+        }).join();
+    }
+    EXPECT_GT(EpochReclamation::MinPinned(), retired);
+}
+
+TEST(ReadMostlyCacheMap, PutGetErase)
+{
+    ReadMostlyCacheMap<int, std::string> map(10);
+    EXPECT_EQ(map.capacity(), 10u);
+    EXPECT_FALSE(map.get(1));
+    map.put(1, "one");
+    map.put(2, "two");
+    EXPECT_EQ(map.get(1), "one");
+    EXPECT_TRUE(map.exists(2));
+    EXPECT_EQ(map.size(), 2u);
+
+    map.put(1, "uno");
+    EXPECT_EQ(map.get(1), "uno");
+    EXPECT_EQ(map.size(), 2u);
+
+    EXPECT_TRUE(map.erase(1));
+    EXPECT_FALSE(map.erase(1));
+    EXPECT_FALSE(map.exists(1));
+    EXPECT_EQ(map.size(), 1u);
+
+    map.clear();
+    EXPECT_FALSE(map.exists(2));
+    EXPECT_EQ(map.size(), 0u);
+    map.put(3, "three");
+    EXPECT_EQ(map.get(3), "three");
+
+    EXPECT_THROW((ReadMostlyCacheMap<int, int>(0)), std::logic_error);
+}
+
+TEST(ReadMostlyCacheMap, CollidingKeys)
+{
+    // A single bucket holds every key
+    struct ConstantHash
+    {
+        std::size_t operator()(int) const { return 0; }
+    };
+    ReadMostlyCacheMap<int, int, ConstantHash> map(1);
+    ReadMostlyCacheMap<int, int, ConstantHash> chained(8);
+    for (int i = 0; i < 8; ++i)
+        chained.put(i, i);
+    chained.erase(3);
+    chained.put(5, 50);
+    for (int i = 0; i < 8; ++i)
+    {
+        if (i == 3)
+            EXPECT_FALSE(chained.exists(i));
+        else
+            EXPECT_EQ(chained.get(i), i == 5 ? 50 : i);
+    }
+
+    map.put(1, 1);
+    map.put(2, 2);
+    EXPECT_FALSE(map.exists(1));
+    EXPECT_EQ(map.get(2), 2);
+}
+
+TEST(ReadMostlyCacheMap, EvictsSampledLeastRecentlyUsed)
+{
+    ReadMostlyCacheMap<int, int> map(100);
+    for (int key = 0; key < 100; ++key)
+        map.put(key, key);
+
+    int hotSurvivors = 0;
+    for (int key = 100; key < 1000; ++key)
+    {
+        for (int hot = 0; hot < 10; ++hot)
+            map.get(hot);
+        map.put(key, key);
+        EXPECT_EQ(map.size(), 100u);
+    }
+    for (int hot = 0; hot < 10; ++hot)
+        hotSurvivors += map.exists(hot);
+    EXPECT_GE(hotSurvivors, 9);
+}
+
+TEST(ReadMostlyCacheMap, ConcurrentReadersAndWriters)
+{
+    // Values encode their key, so a reader of a freed or torn node sees a
+    // mismatch; run under ThreadSanitizer and AddressSanitizer
+    ReadMostlyCacheMap<std::uint64_t, std::vector<std::uint64_t>> map(64);
+    const std::uint64_t keyCount = 256;
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t)
+        threads.emplace_back([&map, &done, &failures, t]()
+        {
+            std::uint64_t i = t;
+            while (!done)
+            {
+                const std::uint64_t key = (i++ * 7) % keyCount;
+                if (auto value = map.get(key))
+                {
+                    if (value->size() != 2 || (*value)[0] != key)
+                        ++failures;
+                }
+                map.exists(key);
+            }
+        });
+    for (int t = 0; t < 2; ++t)
+        threads.emplace_back([&map, t]()
+        {
+            for (std::uint64_t i = 0; i < 20000; ++i)
+            {
+                const std::uint64_t key = (i * 13 + t) % keyCount;
+                if (i % 5 == 0)
+                    map.erase(key);
+                else
+                    map.put(key, std::vector<std::uint64_t>{key, i});
+                if (i % 5000 == 0)
+                    map.clear();
+            }
+        });
+    threads[3].join();
+    threads[4].join();
+    done = true;
+    for (int t = 0; t < 3; ++t)
+        threads[t].join();
+
+    EXPECT_EQ(failures, 0);
+    EXPECT_LE(map.size(), 64u);
+}
@@ -0,0 +1,158 @@
+#include <cstdint>
+#include <unordered_set>
+
+#include "gtest/gtest.h"
+#include "RobinHoodIndex.h"
+
+using Index = RobinHoodIndex<std::uint64_t>;
+
+namespace
+{
+
+std::uint32_t HashOf(std::uint64_t key)
+{
+    return Index::Mix(key);
+}
+
+bool Contains(const Index& index, std::uint64_t key)
+{
+    return index.Find(HashOf(key),
+        [key](std::uint64_t handle) { return handle == key; }) != Index::npos;
+}
+
+bool Erase(Index& index, std::uint64_t key)
+{
+    return index.Erase(HashOf(key),
+        [key](std::uint64_t handle) { return handle == key; });
+}
+
+}  // namespace
+
+TEST(RobinHoodIndex, InsertFindErase)
+{
+    Index index(16);
+    for (std::uint64_t key = 0; key < 10; ++key)
+        index.Insert(HashOf(key), key);
+    EXPECT_EQ(index.Size(), 10u);
+
+    for (std::uint64_t key = 0; key < 10; key += 2)
+        EXPECT_TRUE(Erase(index, key));
+    for (std::uint64_t key = 0; key < 10; ++key)
+        EXPECT_EQ(Contains(index, key), key % 2 == 1);
+    EXPECT_FALSE(Erase(index, 0));
+    EXPECT_EQ(index.Size(), 5u);
+}
+
+TEST(RobinHoodIndex, Rehash)
+{
+    Index index(4);
+    index.Insert(HashOf(1), 1);
+    index.Insert(HashOf(2), 2);
+    index.Rehash(100);
+
+    EXPECT_EQ(index.BucketCount(), 128u);
+    EXPECT_FALSE(index.Rehashing());
+    EXPECT_TRUE(Contains(index, 1));
+    EXPECT_TRUE(Contains(index, 2));
+}
+
+TEST(RobinHoodIndex, IncrementalRehash)
+{
+    const std::uint64_t count = 3000;
+    Index index(4096);
+    std::unordered_set<std::uint64_t> expected;
+    for (std::uint64_t key = 0; key < count; ++key)
+    {
+        index.Insert(HashOf(key), key);
+        expected.insert(key);
+    }
+
+    index.StartRehash(8192);
+    EXPECT_TRUE(index.Rehashing());
+    EXPECT_EQ(index.BucketCount(), 8192u);
+
+    std::uint64_t next = count;
+    while (index.Rehashing())
+    {
+        index.RehashStep(4);
+        index.Insert(HashOf(next), next);
+        expected.insert(next++);
+        const std::uint64_t victim = next * 7 % count;
+        EXPECT_EQ(Erase(index, victim), expected.erase(victim) == 1);
+        for (std::uint64_t key = next - 10; key < next; ++key)
+            EXPECT_EQ(Contains(index, key), expected.count(key) == 1);
+    }
+
+    EXPECT_LT(next - count, count);
+    EXPECT_EQ(index.Size(), expected.size());
+    for (std::uint64_t key = 0; key < next; ++key)
+        EXPECT_EQ(Contains(index, key), expected.count(key) == 1);
+}
+
+TEST(RobinHoodIndex, StartRehashFinishesPrevious)
+{
+    Index index(64);
+    for (std::uint64_t key = 0; key < 40; ++key)
+        index.Insert(HashOf(key), key);
+
+    index.StartRehash(128);
+    index.RehashStep(1);
+    index.StartRehash(256);
+    index.RehashStep(1000);
+    EXPECT_FALSE(index.Rehashing());
+    for (std::uint64_t key = 0; key < 40; ++key)
+        EXPECT_TRUE(Contains(index, key));
+
+    index.StartRehash(512);
+    index.Clear();
+    EXPECT_FALSE(index.Rehashing());
+    EXPECT_EQ(index.Size(), 0u);
+}
+
+TEST(RobinHoodIndex, PrepareRehash)
+{
+    Index index(64);
+    index.PrepareRehash(32);
+    EXPECT_FALSE(index.RehashPending());
+
+    index.PrepareRehash(128);
+    EXPECT_TRUE(index.RehashPending());
+    EXPECT_FALSE(index.Rehashing());
+    for (std::uint64_t key = 0; key < 40; ++key)
+    {
+        index.Insert(HashOf(key), key);
+        index.RehashStep(1);
+    }
+    EXPECT_FALSE(index.RehashPending());
+
+    index.StartRehash(128);
+    EXPECT_EQ(index.BucketCount(), 128u);
+    while (index.RehashPending())
+        index.RehashStep(1);
+    for (std::uint64_t key = 0; key < 40; ++key)
+        EXPECT_TRUE(Contains(index, key));
+
+    index.PrepareRehash(256);
+    index.StartRehash(256);
+    EXPECT_EQ(index.BucketCount(), 256u);
+    index.RehashStep(100);
+    EXPECT_FALSE(index.RehashPending());
+    EXPECT_EQ(index.Size(), 40u);
+}
+
+TEST(RobinHoodIndex, Candidate)
+{
+    Index index(16);
+    index.Insert(HashOf(1), 1);
+    index.Insert(7, 70);
+    index.Insert(7, 71);
+
+    EXPECT_EQ(index.Candidate(HashOf(1)), 1u);
+    EXPECT_EQ(index.Candidate(HashOf(2)), 0u);
+    // Only the first handle with a matching fingerprint is reported
+    EXPECT_EQ(index.Candidate(7), 70u);
+
+    index.StartRehash(64);
+    ASSERT_TRUE(index.Rehashing());
+    EXPECT_EQ(index.Candidate(HashOf(1)), 1u);
+}
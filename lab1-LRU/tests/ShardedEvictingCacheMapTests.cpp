@@ -0,0 +1,393 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ShardedEvictingCacheMap.h"
+
+using ShardedEvictingCacheMapii = ShardedEvictingCacheMap<int, int>;
+
+TEST(ShardedEvictingCacheMap, CtorZeroCapacityThrow)
+{
+    EXPECT_THROW({ShardedEvictingCacheMapii map(0);}, std::logic_error);
+    EXPECT_THROW({ShardedEvictingCacheMapii map(1, 0);}, std::logic_error);
+}
+
+TEST(ShardedEvictingCacheMap, ShardCount)
+{
+    EXPECT_EQ(ShardedEvictingCacheMapii(100, 5).shardCount(), 8u);
+    EXPECT_EQ(ShardedEvictingCacheMapii(100, 8).shardCount(), 8u);
+    EXPECT_EQ(ShardedEvictingCacheMapii(3, 8).shardCount(), 2u);
+    EXPECT_EQ(ShardedEvictingCacheMapii(1, 8).shardCount(), 1u);
+}
+
+TEST(ShardedEvictingCacheMap, PutGetErase)
+{
+    ShardedEvictingCacheMapii map(64, 4);
+    EXPECT_TRUE(map.empty());
+
+    for (int i = 0; i < 32; ++i)
+        map.put(i, i * 2);
+    EXPECT_EQ(map.size(), 32u);
+
+    for (int i = 0; i < 32; ++i)
+    {
+        ASSERT_TRUE(map.exists(i));
+        EXPECT_EQ(map.get(i).value(), i * 2);
+    }
+    EXPECT_FALSE(map.get(32).has_value());
+
+    EXPECT_TRUE(map.erase(0));
+    EXPECT_FALSE(map.erase(0));
+    EXPECT_FALSE(map.exists(0));
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+}
+
+struct StringHash
+{
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const
+    {
+        return std::hash<std::string_view>()(s);
+    }
+};
+
+TEST(ShardedEvictingCacheMap, TransparentLookup)
+{
+    ShardedEvictingCacheMap<std::string, int, StringHash, std::equal_to<>>
+        map(64, 4);
+    for (int i = 0; i < 32; ++i)
+        map.put(std::to_string(i), i);
+
+    for (int i = 0; i < 32; ++i)
+    {
+        const std::string key = std::to_string(i);
+        const std::string_view view = key;
+        ASSERT_TRUE(map.exists(view));
+        EXPECT_EQ(map.get(view).value(), i);
+    }
+    EXPECT_TRUE(map.erase(std::string_view("7")));
+    EXPECT_FALSE(map.exists(std::string_view("7")));
+}
+
+TEST(ShardedEvictingCacheMap, CapacityIsSplit)
+{
+    ShardedEvictingCacheMapii map(100, 4);
+    for (int i = 0; i < 10000; ++i)
+        map.put(i, i);
+    EXPECT_EQ(map.size(), 100u);
+
+    // The most recent keys of every shard survive.
+    for (int i = 9990; i < 10000; ++i)
+        EXPECT_TRUE(map.exists(i));
+}
+
+TEST(ShardedEvictingCacheMap, ConcurrentAccess)
+{
+    const int threadCount = 8;
+    const int keysPerThread = 2000;
+    ShardedEvictingCacheMapii map(threadCount * keysPerThread, 16);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+        threads.emplace_back([&map, t]() {
+            for (int i = 0; i < keysPerThread; ++i)
+            {
+                const int key = t * keysPerThread + i;
+                map.put(key, key);
+                map.get(key / 2);
+                map.exists(key - 1);
+                if (i % 7 == 0)
+                    map.erase(key);
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    for (int key = 0; key < threadCount * keysPerThread; ++key)
+    {
+        auto value = map.get(key);
+        if (value)
+        {
+            EXPECT_EQ(value.value(), key);
+        }
+    }
+}
+
+TEST(ShardedEvictingCacheMap, GetOrLoad)
+{
+    ShardedEvictingCacheMapii map(64, 4);
+    int loads = 0;
+    auto loader = [&loads](int key) {
+        ++loads;
+        return key * 3;
+    };
+
+    EXPECT_EQ(map.getOrLoad(5, loader), 15);
+    EXPECT_EQ(map.getOrLoad(5, loader), 15);
+    EXPECT_EQ(loads, 1);
+    EXPECT_EQ(map.get(5).value(), 15);
+
+    map.put(6, 100);
+    EXPECT_EQ(map.getOrLoad(6, loader), 100);
+    EXPECT_EQ(loads, 1);
+}
+
+TEST(ShardedEvictingCacheMap, GetOrLoadFailureIsNotCached)
+{
+    ShardedEvictingCacheMapii map(64, 4);
+    EXPECT_THROW(map.getOrLoad(1, [](int) -> int {
+        throw std::runtime_error("load failed");
+    }), std::runtime_error);
+    EXPECT_FALSE(map.exists(1));
+
+    EXPECT_EQ(map.getOrLoad(1, [](int key) { return key + 1; }), 2);
+    EXPECT_EQ(map.get(1).value(), 2);
+}
+
+TEST(ShardedEvictingCacheMap, GetOrLoadSingleFlight)
+{
+    ShardedEvictingCacheMapii map(64, 4);
+    std::atomic<int> loads(0);
+    const int threadCount = 8;
+
+    std::vector<std::thread> threads;
+    std::vector<int> results(threadCount);
+    for (int t = 0; t < threadCount; ++t)
+        threads.emplace_back([&, t]() {
+            results[t] = map.getOrLoad(42, [&loads](int key) {
+                ++loads;
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                return key;
+            });
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(loads.load(), 1);
+    for (int result : results)
+        EXPECT_EQ(result, 42);
+}
+
+TEST(ShardedEvictingCacheMap, GetOrLoadYieldsToWritesWhileLoading)
+{
+    ShardedEvictingCacheMapii map(64, 4);
+    std::atomic<bool> loading(false);
+    std::atomic<bool> release(false);
+    auto blockingLoad = [&](int key) {
+        loading = true;
+        while (!release)
+            std::this_thread::yield();
+        return key * 10;
+    };
+    auto loadWhile = [&](int key, auto write) {
+        loading = false;
+        release = false;
+        int result = 0;
+        std::thread loader([&]() {
+            result = map.getOrLoad(key, blockingLoad);
+        });
+        while (!loading)
+            std::this_thread::yield();
+        write();
+        release = true;
+        loader.join();
+        return result;
+    };
+
+    // Invalidated while loading: the caller still gets the loaded value
+    EXPECT_EQ(loadWhile(1, [&]() { map.erase(1); }), 10);
+    EXPECT_FALSE(map.exists(1));
+
+    // A newer value is not overwritten
+    EXPECT_EQ(loadWhile(2, [&]() { map.put(2, 7); }), 20);
+    EXPECT_EQ(map.get(2), 7);
+
+    EXPECT_EQ(loadWhile(3, [&]() { map.clear(); }), 30);
+    EXPECT_FALSE(map.exists(3));
+
+    // Writes of other keys do not matter
+    EXPECT_EQ(loadWhile(4, [&]() { map.erase(5); }), 40);
+    EXPECT_EQ(map.get(4), 40);
+}
+
+TEST(ShardedEvictingCacheMap, GetOrLoadFailureReachesWaiters)
+{
+    ShardedEvictingCacheMapii map(64, 4);
+    std::atomic<bool> loading(false);
+    std::atomic<int> loads(0);
+    std::atomic<int> failures(0);
+
+    auto failingLoad = [&]() {
+        try
+        {
+            map.getOrLoad(7, [&](int) -> int {
+                ++loads;
+                loading = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                throw std::runtime_error("load failed");
+            });
+        }
+        catch (const std::runtime_error&)
+        {
+            ++failures;
+        }
+    };
+
+    std::thread loader(failingLoad);
+    while (!loading)
+        std::this_thread::yield();
+    std::vector<std::thread> waiters;
+    for (int t = 0; t < 4; ++t)
+        waiters.emplace_back(failingLoad);
+    loader.join();
+    for (auto& waiter : waiters)
+        waiter.join();
+
+    EXPECT_EQ(loads.load(), 1);
+    EXPECT_EQ(failures.load(), 5);
+    EXPECT_FALSE(map.exists(7));
+}
+
+TEST(ShardedEvictingCacheMap, RemovalListener)
+{
+    ShardedEvictingCacheMap<int, int> map(4, 2);
+    std::atomic<int> evicted{0};
+    std::atomic<int> erased{0};
+    std::atomic<int> cleared{0};
+    // The listener runs outside the shard lock, so it may use the map
+    map.setRemovalListener([&](int key, int&& value, RemovalCause cause)
+    {
+        EXPECT_EQ(key, value);
+        EXPECT_FALSE(map.exists(key));
+        if (cause == RemovalCause::Capacity)
+            ++evicted;
+        else if (cause == RemovalCause::Erased)
+            ++erased;
+        else if (cause == RemovalCause::Cleared)
+            ++cleared;
+    });
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&map, t]()
+        {
+            for (int i = 0; i < 1000; ++i)
+                map.put(t * 1000 + i, t * 1000 + i);
+            map.erase(t * 1000 + 999);
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    const int remaining = static_cast<int>(map.size());
+    map.clear();
+    EXPECT_EQ(evicted + erased + cleared, 4000);
+    EXPECT_EQ(cleared.load(), remaining);
+}
+
+TEST(ShardedEvictingCacheMap, SlowListenerDoesNotBlockShard)
+{
+    ShardedEvictingCacheMap<int, int> map(1, 1);
+    std::atomic<bool> listening{false};
+    std::atomic<bool> release{false};
+    map.setRemovalListener([&](int key, int&&, RemovalCause)
+    {
+        if (key != 1)
+            return;
+        listening = true;
+        while (!release)
+            std::this_thread::yield();
+    });
+
+    map.put(1, 1);
+    std::thread evicting([&map]() { map.put(2, 2); });
+    while (!listening)
+        std::this_thread::yield();
+    // The evicting thread is stuck in the listener, the shard is not
+    map.put(3, 3);
+    EXPECT_EQ(map.get(3), 3);
+    release = true;
+    evicting.join();
+}
+
+using BufferedMap = ShardedEvictingCacheMap<int, int, std::hash<int>,
+    std::equal_to<int>, LruEviction, std::allocator<std::pair<const int, int>>,
+    CountStats, BufferedReads<2, 4>>;
+
+TEST(ShardedEvictingCacheMap, BufferedReadsReplayedBeforeWrites)
+{
+    BufferedMap map(3, 1);
+    map.put(1, 1);
+    map.put(2, 2);
+    map.put(3, 3);
+    EXPECT_EQ(map.get(1), 1);
+    EXPECT_FALSE(map.get(4));
+
+    // The buffered read of 1 is replayed first, so 2 is the LRU entry
+    map.put(4, 4);
+    EXPECT_TRUE(map.exists(1));
+    EXPECT_FALSE(map.exists(2));
+
+    const CacheStatsSnapshot stats = map.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+}
+
+TEST(ShardedEvictingCacheMap, FullReadBufferIsDrained)
+{
+    BufferedMap map(8, 1);
+    for (int i = 0; i < 8; ++i)
+        map.put(i, i);
+    // The buffer takes the reads of 0 to 3.  The read of 4 finds it full,
+    // is dropped and drains the buffer, so 5 to 7 are recorded after all.
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(map.get(i), i);
+    for (int i = 8; i < 12; ++i)
+        map.put(i, i);
+    // LRU to MRU before the puts: 4, 0, 1, 2, 3, 5, 6, 7
+    for (int i = 0; i < 12; ++i)
+        EXPECT_EQ(map.exists(i), i >= 3 && i != 4);
+    EXPECT_EQ(map.stats().hits, 8u);
+}
+
+TEST(ShardedEvictingCacheMap, BufferedReadsConcurrentAccess)
+{
+    // Replays race with erasures and evictions of the recorded entries, and
+    // exists() and size() share the lock with get()
+    BufferedMap map(64, 4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&map, t]()
+        {
+            for (int i = 0; i < 20000; ++i)
+            {
+                const int key = (i * 7 + t) % 128;
+                if (auto value = map.get(key))
+                {
+                    EXPECT_EQ(*value, key);
+                }
+                else
+                {
+                    map.put(key, key);
+                }
+                if (i % 11 == 0)
+                    map.erase(key);
+                if (i % 13 == 0)
+                    map.exists(key + 1);
+                if (i % 101 == 0)
+                {
+                    EXPECT_LE(map.size(), 64u);
+                }
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_LE(map.size(), 64u);
+    EXPECT_EQ(map.stats().hits + map.stats().misses, 80000u);
+}
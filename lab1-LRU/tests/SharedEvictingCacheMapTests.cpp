@@ -0,0 +1,241 @@
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "SharedEvictingCacheMap.h"
+
+namespace
+{
+
+// A value which can be checked against its key, so a torn or misplaced
+// entry is detected
+struct Value
+{
+    std::uint64_t key;
+    std::uint64_t version;
+    std::uint64_t check;
+};
+
+Value MakeValue(std::uint64_t key, std::uint64_t version)
+{
+    return Value{key, version, key * 0x9e3779b97f4a7c15ULL ^ version};
+}
+
+bool IsValid(std::uint64_t key, const Value& value)
+{
+    return value.key == key &&
+        value.check == (key * 0x9e3779b97f4a7c15ULL ^ value.version);
+}
+
+using SharedMap = SharedEvictingCacheMap<std::uint64_t, Value>;
+
+class SharedEvictingCacheMapTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        path = ::testing::TempDir() + "shared-cache-" +
+            std::to_string(::getpid());
+        SharedMap::remove(path);
+    }
+
+    void TearDown() override { SharedMap::remove(path); }
+
+    // Run a function in a child process
+    // @return the pid of the child
+    template <class TFunction>
+    static pid_t Spawn(TFunction function)
+    {
+        const pid_t pid = ::fork();
+        if (pid == 0)
+            ::_exit(function());
+        return pid;
+    }
+
+    static int Wait(pid_t pid)
+    {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        return status;
+    }
+
+    std::string path;
+};
+
+}  // namespace
+
+TEST_F(SharedEvictingCacheMapTest, Lru)
+{
+    SharedMap map(path, 3, 1);
+    EXPECT_EQ(map.capacity(), 3u);
+    map.put(1, MakeValue(1, 0));
+    map.put(2, MakeValue(2, 0));
+    map.put(3, MakeValue(3, 0));
+    EXPECT_TRUE(map.get(1));
+    map.put(4, MakeValue(4, 0));
+    EXPECT_FALSE(map.exists(2));
+    EXPECT_TRUE(map.exists(1));
+    EXPECT_EQ(map.size(), 3u);
+
+    map.put(1, MakeValue(1, 7));
+    EXPECT_EQ(map.get(1)->version, 7u);
+    EXPECT_TRUE(map.erase(1));
+    EXPECT_FALSE(map.erase(1));
+    EXPECT_FALSE(map.get(1));
+    EXPECT_EQ(map.size(), 2u);
+
+    map.clear();
+    EXPECT_EQ(map.size(), 0u);
+    EXPECT_FALSE(map.exists(3));
+}
+
+TEST_F(SharedEvictingCacheMapTest, SharedBetweenMappings)
+{
+    SharedMap first(path, 100, 4);
+    SharedMap second(path, 100, 4);
+    first.put(1, MakeValue(1, 1));
+    EXPECT_TRUE(IsValid(1, *second.get(1)));
+    second.erase(1);
+    EXPECT_FALSE(first.exists(1));
+
+    EXPECT_THROW(SharedMap(path, 200, 4), std::runtime_error);
+    EXPECT_THROW(SharedMap(path, 100, 8), std::runtime_error);
+    EXPECT_THROW((SharedEvictingCacheMap<std::uint64_t, int>(path, 100, 4)),
+        std::runtime_error);
+}
+
+TEST_F(SharedEvictingCacheMapTest, CreatorDiedBeforeReady)
+{
+    // Left behind empty, or sized but not initialized, by a killed creator
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    ASSERT_GE(fd, 0);
+    ::close(fd);
+    {
+        SharedMap map(path, 100, 4);
+        map.put(1, MakeValue(1, 1));
+    }
+    SharedMap reopened(path, 100, 4);
+    EXPECT_TRUE(reopened.exists(1));
+
+    SharedMap::remove(path);
+    const pid_t child = Spawn([this]()
+    {
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0 || ::ftruncate(fd, 1 << 20) != 0)
+            return 1;
+        ::kill(::getpid(), SIGKILL);
+        return 0;
+    });
+    EXPECT_TRUE(WIFSIGNALED(Wait(child)));
+    SharedMap map(path, 100, 4);
+    EXPECT_EQ(map.size(), 0u);
+    map.put(2, MakeValue(2, 1));
+    EXPECT_TRUE(IsValid(2, *map.get(2)));
+}
+
+TEST_F(SharedEvictingCacheMapTest, SharedBetweenProcesses)
+{
+    SharedMap map(path, 100, 4);
+    const pid_t child = Spawn([this]()
+    {
+        SharedMap child(path, 100, 4);
+        child.put(42, MakeValue(42, 1));
+        return 0;
+    });
+    EXPECT_EQ(Wait(child), 0);
+    ASSERT_TRUE(map.get(42));
+    EXPECT_EQ(map.get(42)->version, 1u);
+}
+
+TEST_F(SharedEvictingCacheMapTest, MultiProcessStress)
+{
+    const std::size_t capacity = 512;
+    SharedMap map(path, capacity, 8);
+    const int processCount = 4;
+    const int operations = 50000;
+
+    std::vector<pid_t> children;
+    for (int p = 0; p < processCount; ++p)
+        children.push_back(Spawn([this, p]()
+        {
+            SharedMap shared(path, capacity, 8);
+            std::mt19937_64 random(p);
+            std::uniform_int_distribution<std::uint64_t> keys(0, 2047);
+            for (int i = 0; i < operations; ++i)
+            {
+                const std::uint64_t key = keys(random);
+                switch (random() % 4)
+                {
+                case 0:
+                    shared.put(key, MakeValue(key, i));
+                    break;
+                case 1:
+                    shared.erase(key);
+                    break;
+                default:
+                    if (auto value = shared.get(key))
+                        if (!IsValid(key, *value))
+                            return 1;
+                }
+            }
+            return 0;
+        }));
+    for (pid_t child : children)
+    {
+        const int status = Wait(child);
+        EXPECT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+
+    EXPECT_LE(map.size(), map.capacity());
+    for (std::uint64_t key = 0; key < 2048; ++key)
+    {
+        if (auto value = map.get(key))
+        {
+            EXPECT_TRUE(IsValid(key, *value));
+        }
+    }
+}
+
+TEST_F(SharedEvictingCacheMapTest, SurvivesKilledProcesses)
+{
+    SharedMap map(path, 64, 1);
+    for (int round = 0; round < 20; ++round)
+    {
+        // Killed at some point of an endless loop of puts, most likely with
+        // the only lock held
+        const pid_t child = Spawn([this]()
+        {
+            SharedMap shared(path, 64, 1);
+            for (std::uint64_t i = 0;; ++i)
+                shared.put(i % 100, MakeValue(i % 100, i));
+            return 0;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ::kill(child, SIGKILL);
+        const int status = Wait(child);
+        EXPECT_TRUE(WIFSIGNALED(status));
+
+        map.put(1000, MakeValue(1000, round));
+        ASSERT_TRUE(map.get(1000));
+        EXPECT_EQ(map.get(1000)->version, std::uint64_t(round));
+        for (std::uint64_t key = 0; key < 100; ++key)
+        {
+            if (auto value = map.get(key))
+            {
+                EXPECT_TRUE(IsValid(key, *value));
+            }
+        }
+        EXPECT_LE(map.size(), 64u);
+    }
+}
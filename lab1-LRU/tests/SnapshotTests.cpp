@@ -0,0 +1,262 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "EvictingCacheMap.h"
+#include "Snapshot.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct FakeClock
+{
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<FakeClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return time_point(current); }
+
+    static inline duration current{0};
+};
+
+struct LengthWeigher
+{
+    std::size_t operator()(int, const std::string& value) const
+    {
+        return value.size();
+    }
+};
+
+// Stores a vector of ints as its size followed by the elements
+struct VectorSerializer
+{
+    static void Write(SnapshotWriter& out, const std::vector<int>& value)
+    {
+        Serializer<std::uint32_t>::Write(out,
+            static_cast<std::uint32_t>(value.size()));
+        out.Write(value.data(), value.size() * sizeof(int));
+    }
+
+    static std::vector<int> Read(SnapshotReader& in)
+    {
+        std::vector<int> value(Serializer<std::uint32_t>::Read(in));
+        for (int& element : value)
+            element = Serializer<int>::Read(in);
+        return value;
+    }
+};
+
+class Snapshot : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        path = ::testing::TempDir() + "EvictingCacheMap.snapshot";
+        std::remove(path.c_str());
+    }
+
+    void TearDown() override { std::remove(path.c_str()); }
+
+    std::string path;
+};
+
+template <class TMap>
+std::vector<typename TMap::value_type> Entries(const TMap& map)
+{
+    return std::vector<typename TMap::value_type>(map.begin(), map.end());
+}
+
+}  // namespace
+
+TEST_F(Snapshot, KeepsRecencyOrder)
+{
+    EvictingCacheMap<int, double> map(10);
+    for (int i = 0; i < 5; ++i)
+        map.put(i, i * 1.5);
+    map.get(1);
+    map.get(3);
+    const auto before = Entries(map);
+
+    SaveSnapshot(map, path);
+    EXPECT_EQ(Entries(map), before);
+
+    EvictingCacheMap<int, double> loaded(10);
+    loaded.put(100, 100);
+    LoadSnapshot(loaded, path);
+    EXPECT_EQ(Entries(loaded), before);
+    EXPECT_FALSE(loaded.exists(100));
+
+    // The least recently used entry is still evicted first
+    for (int i = 5; i < 11; ++i)
+        loaded.put(i, i);
+    EXPECT_FALSE(loaded.exists(0));
+    EXPECT_TRUE(loaded.exists(2));
+}
+
+TEST_F(Snapshot, Strings)
+{
+    EvictingCacheMap<std::string, std::string> map(10);
+    map.put("", "empty");
+    map.put("key", std::string(1000, 'x'));
+    map.put("nul", std::string("a\0b", 3));
+    SaveSnapshot(map, path);
+
+    EvictingCacheMap<std::string, std::string> loaded(10);
+    LoadSnapshot(loaded, path);
+    EXPECT_EQ(Entries(loaded), Entries(map));
+}
+
+TEST_F(Snapshot, CustomSerializer)
+{
+    EvictingCacheMap<int, std::vector<int>> map(10);
+    map.put(1, std::vector<int>{1, 2, 3});
+    map.put(2, std::vector<int>{});
+    SaveSnapshot<Serializer<int>, VectorSerializer>(map, path);
+
+    EvictingCacheMap<int, std::vector<int>> loaded(10);
+    LoadSnapshot<Serializer<int>, VectorSerializer>(loaded, path);
+    EXPECT_EQ(Entries(loaded), Entries(map));
+}
+
+TEST_F(Snapshot, LoadsMostRecentIntoSmallerMap)
+{
+    EvictingCacheMap<int, int> map(100);
+    for (int i = 0; i < 100; ++i)
+        map.put(i, i);
+    SaveSnapshot(map, path);
+
+    EvictingCacheMap<int, int> loaded(10);
+    LoadSnapshot(loaded, path);
+    ASSERT_EQ(loaded.size(), 10u);
+    int expected = 99;
+    for (const auto& entry : loaded)
+        EXPECT_EQ(entry.first, expected--);
+
+    EvictingCacheMap<std::string, int> strings(100);
+    for (int i = 0; i < 100; ++i)
+        strings.put(std::to_string(i), i);
+    SaveSnapshot(strings, path);
+    EvictingCacheMap<std::string, int> smaller(3);
+    LoadSnapshot(smaller, path);
+    ASSERT_EQ(smaller.size(), 3u);
+    EXPECT_EQ(smaller.begin()->first, "99");
+    EXPECT_FALSE(smaller.exists("96"));
+}
+
+TEST_F(Snapshot, Weighted)
+{
+    using WeightedMap = EvictingCacheMap<int, std::string, std::hash<int>,
+        std::equal_to<int>, LruEviction,
+        std::allocator<std::pair<const int, std::string>>, LengthWeigher>;
+    WeightedMap map(10, 4, LengthWeigher());
+    map.put(1, "aaaa");
+    map.put(2, "bbb");
+    map.put(3, "cc");
+    SaveSnapshot(map, path);
+
+    WeightedMap loaded(5, 4, LengthWeigher());
+    LoadSnapshot(loaded, path);
+    EXPECT_EQ(loaded.weight(), 5u);
+    EXPECT_FALSE(loaded.exists(1));
+    EXPECT_EQ(loaded.get(2), "bbb");
+    EXPECT_EQ(loaded.get(3), "cc");
+}
+
+TEST_F(Snapshot, Expiration)
+{
+    using ExpiringMap = EvictingCacheMap<int, int, std::hash<int>,
+        std::equal_to<int>, LruEviction,
+        std::allocator<std::pair<const int, int>>, UnitWeigher,
+        ExpireAfterAccess<FakeClock>>;
+    FakeClock::current = 1s;
+    ExpiringMap map(10);
+    map.put(1, 1, 10ms);
+    map.put(2, 2, 100ms);
+    map.put(3, 3);
+    FakeClock::current += 20ms;
+    SaveSnapshot(map, path);
+
+    ExpiringMap loaded(10);
+    LoadSnapshot(loaded, path);
+    EXPECT_EQ(loaded.size(), 2u);
+    EXPECT_FALSE(loaded.exists(1));
+
+    // 80ms were left of the time-to-live, which restarts at 100ms
+    FakeClock::current += 70ms;
+    EXPECT_EQ(loaded.get(2), 2);
+    FakeClock::current += 90ms;
+    EXPECT_EQ(loaded.get(2), 2);
+    FakeClock::current += 24h;
+    EXPECT_FALSE(loaded.exists(2));
+    EXPECT_EQ(loaded.get(3), 3);
+
+    // Records of maps without expiration have another layout
+    EvictingCacheMap<int, int> plain(10);
+    EXPECT_THROW(LoadSnapshot(plain, path), std::runtime_error);
+}
+
+TEST_F(Snapshot, Errors)
+{
+    // A snapshot which is missing or does not match leaves the map alone
+    EvictingCacheMap<int, int> map(10);
+    map.put(0, 0);
+    EXPECT_THROW(LoadSnapshot(map, path), std::runtime_error);
+    EXPECT_EQ(map.get(0), 0);
+
+    for (int i = 0; i < 10; ++i)
+        map.put(i, i);
+    SaveSnapshot(map, path);
+
+    EvictingCacheMap<int, double> otherType(10);
+    otherType.put(1, 1.5);
+    EXPECT_THROW(LoadSnapshot(otherType, path), std::runtime_error);
+    EXPECT_EQ(otherType.get(1), 1.5);
+
+    // Saving into a missing directory leaves the snapshot alone
+    EXPECT_THROW(
+        SaveSnapshot(map, ::testing::TempDir() + "missing/dir/snapshot"),
+        std::runtime_error);
+
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() - 1);
+    }
+    EvictingCacheMap<int, int> loaded(10);
+    loaded.put(1, 1);
+    EXPECT_THROW(LoadSnapshot(loaded, path), std::runtime_error);
+    EXPECT_EQ(loaded.get(1), 1);
+
+    // Variable-sized records are only found to be cut off while reading
+    EvictingCacheMap<int, std::string> strings(10);
+    strings.put(1, "one");
+    strings.put(2, "two");
+    SaveSnapshot(strings, path);
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() - 2);
+    }
+    EvictingCacheMap<int, std::string> truncated(10);
+    truncated.put(3, "three");
+    EXPECT_THROW(LoadSnapshot(truncated, path), std::runtime_error);
+    EXPECT_TRUE(truncated.empty());
+}
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "StackDistance.h"
+
+TEST(StackDistance, Distances)
+{
+    StackDistance stack;
+    EXPECT_EQ(stack.Access(1).entries, StackDistance::Infinite);
+    EXPECT_EQ(stack.Access(2).entries, StackDistance::Infinite);
+    EXPECT_EQ(stack.Access(2).entries, 1u);
+    EXPECT_EQ(stack.Access(3).entries, StackDistance::Infinite);
+    EXPECT_EQ(stack.Access(1).entries, 3u);
+    EXPECT_EQ(stack.Access(3).entries, 2u);
+    EXPECT_EQ(stack.Size(), 3u);
+}
+
+TEST(StackDistance, Bytes)
+{
+    StackDistance stack;
+    stack.Access(1, 100);
+    stack.Access(2, 10);
+    stack.Access(2, 20);
+    // Key 2 counts with its latest size, key 1 with its new one
+    const StackDistance::Distance distance = stack.Access(1, 50);
+    EXPECT_EQ(distance.entries, 2u);
+    EXPECT_EQ(distance.bytes, 70u);
+}
+
+TEST(StackDistance, Remove)
+{
+    StackDistance stack;
+    stack.Access(1);
+    stack.Access(2);
+    stack.Access(3);
+    EXPECT_TRUE(stack.Remove(2));
+    EXPECT_FALSE(stack.Remove(2));
+    EXPECT_EQ(stack.Access(1).entries, 2u);
+    EXPECT_EQ(stack.Access(2).entries, StackDistance::Infinite);
+}
+
+TEST(StackDistance, MatchesNaiveStack)
+{
+    // Long enough to compact the trees many times
+    StackDistance stack;
+    std::vector<std::uint64_t> naive;
+    std::mt19937_64 random(7);
+    std::uniform_int_distribution<std::uint64_t> keys(0, 300);
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        const std::uint64_t key = keys(random);
+        const auto it = std::find(naive.begin(), naive.end(), key);
+        const std::uint64_t expected = it == naive.end()
+            ? StackDistance::Infinite
+            : static_cast<std::uint64_t>(it - naive.begin()) + 1;
+        if (it != naive.end())
+            naive.erase(it);
+        naive.insert(naive.begin(), key);
+
+        ASSERT_EQ(stack.Access(key).entries, expected) << i;
+    }
+}
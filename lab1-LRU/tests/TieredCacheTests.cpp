@@ -0,0 +1,222 @@
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "gtest/gtest.h"
+#include "SegmentLog.h"
+#include "TieredCache.h"
+
+namespace
+{
+
+struct Value
+{
+    std::uint64_t payload[4];
+};
+
+Value MakeValue(int key)
+{
+    return Value{{std::uint64_t(key), 1, 2, 3}};
+}
+
+class TempDirectory : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        directory = ::testing::TempDir() + "tiered";
+        ::mkdir(directory.c_str(), 0755);
+    }
+
+    std::string directory;
+};
+
+class SegmentLogTest : public TempDirectory {};
+class TieredCacheTest : public TempDirectory {};
+
+using Log = SegmentLog<int, Value>;
+
+// Segments of 4 records
+constexpr std::size_t SegmentSize = 4 * Log::RecordSize;
+
+}  // namespace
+
+TEST_F(SegmentLogTest, PutTake)
+{
+    Log log(directory, SegmentSize, 3);
+    for (int i = 0; i < 6; ++i)
+        log.Put(i, MakeValue(i));
+    EXPECT_EQ(log.Size(), 6u);
+    EXPECT_EQ(log.Writes(), 1u);
+
+    // One record comes from the written segment, one from the buffer
+    EXPECT_EQ(log.Take(1)->payload[0], 1u);
+    EXPECT_EQ(log.Take(5)->payload[0], 5u);
+    EXPECT_EQ(log.Reads(), 1u);
+    EXPECT_FALSE(log.Take(1));
+    EXPECT_FALSE(log.Contains(5));
+
+    log.Put(2, MakeValue(20));
+    EXPECT_EQ(log.Take(2)->payload[0], 20u);
+    EXPECT_TRUE(log.Erase(3));
+    EXPECT_FALSE(log.Erase(3));
+    EXPECT_EQ(log.Size(), 2u);
+}
+
+TEST_F(SegmentLogTest, FifoReclamation)
+{
+    Log log(directory, SegmentSize, 3);
+    for (int i = 0; i < 13; ++i)
+        log.Put(i, MakeValue(i));
+
+    // The first segment was reclaimed to make room for the fourth
+    EXPECT_EQ(log.Reclaims(), 1u);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_FALSE(log.Contains(i));
+    for (int i = 4; i < 13; ++i)
+        EXPECT_TRUE(log.Contains(i));
+
+    // A key rewritten into a newer segment survives its old one
+    log.Put(5, MakeValue(50));
+    for (int i = 14; i < 17; ++i)
+        log.Put(i, MakeValue(i));
+    EXPECT_EQ(log.Reclaims(), 2u);
+    EXPECT_FALSE(log.Contains(4));
+    EXPECT_EQ(log.Take(5)->payload[0], 50u);
+}
+
+TEST_F(SegmentLogTest, LruReclamation)
+{
+    Log log(directory, SegmentSize, 3, SegmentReclamation::Lru);
+    for (int i = 0; i < 12; ++i)
+        log.Put(i, MakeValue(i));
+
+    // Reading from the oldest segment makes the second one the victim
+    EXPECT_TRUE(log.Take(0));
+    log.Put(12, MakeValue(12));
+    EXPECT_TRUE(log.Contains(1));
+    EXPECT_FALSE(log.Contains(4));
+}
+
+TEST_F(SegmentLogTest, TakeManyCoalescesReads)
+{
+    Log log(directory, SegmentSize, 4);
+    for (int i = 0; i < 12; ++i)
+        log.Put(i, MakeValue(i));
+
+    const std::vector<int> keys = {7, 0, 100, 2, 5, 10, 0};
+    std::vector<std::optional<Value>> values;
+    log.TakeMany(keys.begin(), keys.end(), std::back_inserter(values));
+    ASSERT_EQ(values.size(), keys.size());
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+        if (keys[i] == 100)
+        {
+            EXPECT_FALSE(values[i]);
+            continue;
+        }
+        ASSERT_TRUE(values[i]);
+        EXPECT_EQ(values[i]->payload[0], std::uint64_t(keys[i]));
+    }
+    EXPECT_FALSE(values[6]);
+
+    // One read per written segment, the active one is in memory
+    EXPECT_EQ(log.Reads(), 2u);
+    EXPECT_EQ(log.Size(), 7u);
+}
+
+TEST_F(SegmentLogTest, NeedsTwoSegments)
+{
+    EXPECT_THROW(Log(directory, SegmentSize, 1), std::invalid_argument);
+    EXPECT_THROW(Log(directory + "/missing/dir", SegmentSize, 2),
+        std::runtime_error);
+}
+
+TEST_F(SegmentLogTest, SegmentSizeFitsOffsets)
+{
+    // Record offsets are 32-bit, and nothing is allocated before the check
+    EXPECT_THROW(Log(directory, (std::size_t(1) << 32) + SegmentSize, 2),
+        std::invalid_argument);
+}
+
+TEST_F(TieredCacheTest, DemotesAndPromotes)
+{
+    TieredCache<int, Value> cache(4, directory, SegmentSize, 4);
+    for (int i = 0; i < 10; ++i)
+        cache.put(i, MakeValue(i));
+    EXPECT_EQ(cache.size(), 10u);
+    EXPECT_EQ(cache.memoryTier().size(), 4u);
+    EXPECT_EQ(cache.fileTier().Size(), 6u);
+
+    // A hit in the log moves the entry to memory and demotes another one
+    EXPECT_EQ(cache.get(0)->payload[0], 0u);
+    EXPECT_TRUE(cache.memoryTier().exists(0));
+    EXPECT_FALSE(cache.fileTier().Contains(0));
+    EXPECT_TRUE(cache.fileTier().Contains(6));
+    EXPECT_EQ(cache.size(), 10u);
+
+    // put() drops the older value in the log
+    cache.put(1, MakeValue(100));
+    EXPECT_EQ(cache.get(1)->payload[0], 100u);
+    EXPECT_EQ(cache.size(), 10u);
+
+    EXPECT_TRUE(cache.erase(2));
+    EXPECT_TRUE(cache.erase(1));
+    EXPECT_FALSE(cache.erase(1));
+    EXPECT_FALSE(cache.exists(2));
+    EXPECT_FALSE(cache.get(42));
+}
+
+TEST_F(TieredCacheTest, MultiGet)
+{
+    TieredCache<int, Value> cache(4, directory, SegmentSize, 8);
+    for (int i = 0; i < 20; ++i)
+        cache.put(i, MakeValue(i));
+
+    const std::vector<int> keys = {19, 0, 1, 2, 3, 50, 18};
+    std::vector<std::optional<Value>> values;
+    cache.multiGet(keys.begin(), keys.end(), std::back_inserter(values));
+    ASSERT_EQ(values.size(), keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        if (keys[i] == 50)
+        {
+            EXPECT_FALSE(values[i]);
+            continue;
+        }
+        ASSERT_TRUE(values[i]);
+        EXPECT_EQ(values[i]->payload[0], std::uint64_t(keys[i]));
+    }
+    // Keys 0 to 3 were in one segment
+    EXPECT_EQ(cache.fileTier().Reads(), 1u);
+    EXPECT_EQ(cache.size(), 20u);
+    for (int key : {0, 1, 2, 3})
+        EXPECT_TRUE(cache.memoryTier().exists(key));
+}
+
+TEST_F(TieredCacheTest, MultiGetDuplicateKeys)
+{
+    TieredCache<int, Value> cache(2, directory, SegmentSize, 8);
+    for (int i = 0; i < 10; ++i)
+        cache.put(i, MakeValue(i));
+
+    // The last 0 has been demoted again by the promotion of 1 and 2
+    const std::vector<int> keys = {0, 0, 1, 2, 0, 42, 42};
+    std::vector<std::optional<Value>> values;
+    cache.multiGet(keys.begin(), keys.end(), std::back_inserter(values));
+    ASSERT_EQ(values.size(), keys.size());
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+        ASSERT_TRUE(values[i]);
+        EXPECT_EQ(values[i]->payload[0], std::uint64_t(keys[i]));
+    }
+    EXPECT_FALSE(values[5]);
+    EXPECT_FALSE(values[6]);
+    EXPECT_EQ(cache.size(), 10u);
+    EXPECT_TRUE(cache.memoryTier().exists(0));
+}
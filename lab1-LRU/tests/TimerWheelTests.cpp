@@ -0,0 +1,112 @@
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "TimerWheel.h"
+
+using Wheel = TimerWheel<>;
+
+namespace
+{
+
+const std::uint64_t Millisecond = 1000000;
+
+std::vector<Wheel::Timer*> AdvanceTo(Wheel& wheel, std::uint64_t now)
+{
+    std::vector<Wheel::Timer*> expired;
+    wheel.Advance(now, [&expired](Wheel::Timer* timer)
+    {
+        expired.push_back(timer);
+    });
+    return expired;
+}
+
+}  // namespace
+
+TEST(TimerWheel, ExpiresDueTimers)
+{
+    Wheel wheel;
+    Wheel::Timer early, late;
+    wheel.Schedule(&early, 10 * Millisecond);
+    wheel.Schedule(&late, 50 * Millisecond);
+
+    EXPECT_TRUE(AdvanceTo(wheel, 5 * Millisecond).empty());
+    EXPECT_EQ(AdvanceTo(wheel, 20 * Millisecond),
+        std::vector<Wheel::Timer*>{&early});
+    EXPECT_EQ(AdvanceTo(wheel, 60 * Millisecond),
+        std::vector<Wheel::Timer*>{&late});
+    EXPECT_TRUE(AdvanceTo(wheel, 100 * Millisecond).empty());
+}
+
+TEST(TimerWheel, Remove)
+{
+    Wheel wheel;
+    Wheel::Timer first, second;
+    wheel.Schedule(&first, 10 * Millisecond);
+    wheel.Schedule(&second, 10 * Millisecond);
+    wheel.Remove(&first);
+    wheel.Remove(&first);
+
+    EXPECT_EQ(AdvanceTo(wheel, 20 * Millisecond),
+        std::vector<Wheel::Timer*>{&second});
+}
+
+TEST(TimerWheel, NeverIsNotScheduled)
+{
+    Wheel wheel;
+    Wheel::Timer timer;
+    wheel.Schedule(&timer, Wheel::Never);
+
+    EXPECT_TRUE(AdvanceTo(wheel, Wheel::Never - 1).empty());
+    wheel.Remove(&timer);
+}
+
+TEST(TimerWheel, CoarseLevelsCascade)
+{
+    const std::uint64_t hour = 3600 * 1000 * Millisecond;
+    Wheel wheel;
+    Wheel::Timer timer;
+    wheel.Schedule(&timer, hour);
+
+    for (std::uint64_t now = 0; now + Millisecond < hour; now += hour / 1000)
+        EXPECT_TRUE(AdvanceTo(wheel, now).empty());
+    EXPECT_TRUE(AdvanceTo(wheel, hour - Millisecond).empty());
+    EXPECT_EQ(AdvanceTo(wheel, hour + 2 * Millisecond),
+        std::vector<Wheel::Timer*>{&timer});
+}
+
+TEST(TimerWheel, LargeJump)
+{
+    Wheel wheel;
+    std::vector<Wheel::Timer> timers(1000);
+    for (size_t i = 0; i < timers.size(); ++i)
+        wheel.Schedule(&timers[i], (i + 1) * (i + 1) * 1000 * Millisecond);
+
+    EXPECT_EQ(AdvanceTo(wheel, 4000 * Millisecond).size(), 2u);
+    EXPECT_EQ(AdvanceTo(wheel, 4000000 * Millisecond).size(), 61u);
+    EXPECT_EQ(AdvanceTo(wheel, 1000000000 * Millisecond).size(), 937u);
+}
+
+TEST(TimerWheel, OverdueTimer)
+{
+    Wheel wheel;
+    Wheel::Timer timer;
+    AdvanceTo(wheel, 100 * Millisecond);
+    wheel.Schedule(&timer, 50 * Millisecond);
+
+    EXPECT_EQ(AdvanceTo(wheel, 102 * Millisecond),
+        std::vector<Wheel::Timer*>{&timer});
+}
+
+TEST(TimerWheel, BeyondLastLevel)
+{
+    const std::uint64_t day = 24 * 3600 * 1000 * Millisecond;
+    Wheel wheel;
+    Wheel::Timer timer;
+    wheel.Schedule(&timer, 30 * day);
+
+    for (std::uint64_t now = 0; now < 30 * day; now += day / 7)
+        EXPECT_TRUE(AdvanceTo(wheel, now).empty());
+    EXPECT_EQ(AdvanceTo(wheel, 30 * day + day / 7),
+        std::vector<Wheel::Timer*>{&timer});
+}
@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "EvictingCacheMap.h"
+#include "TinyLfuEviction.h"
+
+using LruMapii = EvictingCacheMap<int, int>;
+using WTinyLfuMapii =
+    EvictingCacheMap<int, int, std::hash<int>, std::equal_to<int>,
+        WTinyLfuEviction>;
+
+TEST(FrequencySketch, DoorkeeperAbsorbsFirstAccess)
+{
+    FrequencySketch sketch(64);
+    EXPECT_EQ(sketch.Frequency(12345), 0u);
+
+    sketch.Increment(12345);
+    EXPECT_EQ(sketch.Frequency(12345), 1u);
+
+    sketch.Increment(12345);
+    sketch.Increment(12345);
+    EXPECT_EQ(sketch.Frequency(12345), 3u);
+}
+
+TEST(FrequencySketch, CountersSaturate)
+{
+    FrequencySketch sketch(1000);
+    for (int i = 0; i < 100; ++i)
+        sketch.Increment(777);
+    EXPECT_EQ(sketch.Frequency(777), FrequencySketch::MaxCount + 1);
+}
+
+TEST(FrequencySketch, Aging)
+{
+    const size_t capacity = 64;
+    FrequencySketch sketch(capacity);
+    for (int i = 0; i < 9; ++i)
+        sketch.Increment(1);
+    EXPECT_EQ(sketch.Frequency(1), 9u);
+
+    // Fill up the sample with other hashes, which halves the counters and
+    // clears the doorkeeper.
+    for (size_t i = 9; i < 10 * capacity; ++i)
+        sketch.Increment(static_cast<std::uint32_t>(i) * 2654435761u);
+    EXPECT_EQ(sketch.Frequency(1), 4u);
+}
+
+TEST(FrequencySketch, Clear)
+{
+    FrequencySketch sketch(64);
+    for (int i = 0; i < 5; ++i)
+        sketch.Increment(42);
+    sketch.Clear();
+    EXPECT_EQ(sketch.Frequency(42), 0u);
+}
+
+template <class TMap>
+int HotSetSurvivors(int capacity)
+{
+    TMap map(capacity);
+
+    // A hot set accessed many times
+    for (int round = 0; round < 10; ++round)
+        for (int i = 0; i < capacity / 2; ++i)
+            if (!map.get(i))
+                map.put(i, i);
+
+    // A long scan of keys seen only once
+    for (int i = 1000; i < 1000 + 10 * capacity; ++i)
+        if (!map.get(i))
+            map.put(i, i);
+
+    int survivors = 0;
+    for (int i = 0; i < capacity / 2; ++i)
+        survivors += map.exists(i);
+    return survivors;
+}
+
+TEST(WTinyLfuEviction, ScanResistance)
+{
+    const int capacity = 100;
+    EXPECT_EQ(HotSetSurvivors<LruMapii>(capacity), 0);
+    // Only hot keys sitting in the window when the scan starts may be lost
+    EXPECT_GE(HotSetSurvivors<WTinyLfuMapii>(capacity), capacity / 2 - 2);
+}
+
+TEST(WTinyLfuEviction, NewKeysAreServedByWindow)
+{
+    WTinyLfuMapii map(200);
+    for (int i = 0; i < 200; ++i)
+        map.put(i, i);
+
+    // The most recent insertion always survives, even when it is rejected
+    // from the main region later on.
+    for (int i = 200; i < 400; ++i)
+    {
+        map.put(i, i);
+        EXPECT_TRUE(map.exists(i));
+        EXPECT_EQ(map.size(), 200u);
+    }
+}
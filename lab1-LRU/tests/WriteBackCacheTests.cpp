@@ -0,0 +1,330 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "BackingStore.h"
+#include "EvictingCacheMap.h"
+#include "WriteBackCache.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct FakeClock
+{
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<FakeClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return time_point(current); }
+
+    static inline duration current{0};
+};
+
+// Keeps entries in memory and remembers every batch written
+class MemoryStore final : public BackingStore<int, std::string>
+{
+public:
+    std::optional<std::string> Read(const int& key) override
+    {
+        ++reads;
+        auto found = entries.find(key);
+        if (found == entries.end())
+            return {};
+        return found->second;
+    }
+
+    void Write(const Batch& batch) override
+    {
+        if (failing)
+            throw std::runtime_error("store is down");
+        for (const auto& entry : batch)
+            entries[entry.first] = entry.second;
+        batches.push_back(batch);
+    }
+
+    void Remove(const int& key) override { entries.erase(key); }
+
+    std::map<int, std::string> entries;
+    std::vector<Batch> batches;
+    int reads = 0;
+    bool failing = false;
+};
+
+using Cache = WriteBackCache<int, std::string, std::hash<int>,
+    std::equal_to<int>, LruEviction, FakeClock>;
+
+}  // namespace
+
+TEST(WriteBackCache, CoalescesWrites)
+{
+    MemoryStore store;
+    Cache cache(10, store);
+    for (int i = 0; i < 100; ++i)
+        cache.put(1, std::to_string(i));
+    cache.put(2, "two");
+    EXPECT_EQ(cache.dirty(), 2u);
+    EXPECT_TRUE(store.batches.empty());
+
+    cache.flush();
+    ASSERT_EQ(store.batches.size(), 1u);
+    EXPECT_EQ(store.batches[0].size(), 2u);
+    EXPECT_EQ(store.entries[1], "99");
+    EXPECT_EQ(store.entries[2], "two");
+    EXPECT_EQ(cache.dirty(), 0u);
+
+    // Nothing dirty, nothing written
+    cache.flush();
+    EXPECT_EQ(store.batches.size(), 1u);
+    EXPECT_EQ(cache.flushCount(), 1u);
+}
+
+TEST(WriteBackCache, DirtyEvictionsWaitForFlush)
+{
+    MemoryStore store;
+    Cache cache(2, store);
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.dirty(), 3u);
+    EXPECT_TRUE(store.batches.empty());
+
+    // The evicted value comes from the buffer and is dirty again
+    EXPECT_EQ(cache.get(1), "one");
+    EXPECT_EQ(store.reads, 0);
+    cache.put(1, "uno");
+    EXPECT_EQ(cache.dirty(), 3u);
+
+    cache.flush();
+    ASSERT_EQ(store.batches.size(), 1u);
+    EXPECT_EQ(store.batches[0].size(), 3u);
+    EXPECT_EQ(store.entries[1], "uno");
+    EXPECT_EQ(store.entries[2], "two");
+    EXPECT_EQ(store.entries[3], "three");
+}
+
+TEST(WriteBackCache, RepeatedEvictionsWriteOnce)
+{
+    MemoryStore store;
+    Cache cache(1, store);
+    cache.put(1, "a");
+    cache.put(2, "b");
+    cache.put(1, "c");
+    cache.put(2, "d");
+    EXPECT_EQ(cache.dirty(), 2u);
+
+    cache.flush();
+    ASSERT_EQ(store.batches.size(), 1u);
+    EXPECT_EQ(store.batches[0].size(), 2u);
+    EXPECT_EQ(store.entries[1], "c");
+    EXPECT_EQ(store.entries[2], "d");
+}
+
+TEST(WriteBackCache, ReadingEvictedValuesDoesNotRelistThem)
+{
+    MemoryStore store;
+    Cache cache(2, store, 8);
+    for (int i = 0; i < 4; ++i)
+        cache.put(i, std::to_string(i));
+
+    // Every get() brings a value back and evicts another dirty one
+    for (int round = 0; round < 1000; ++round)
+        for (int i = 0; i < 4; ++i)
+            EXPECT_EQ(cache.get(i), std::to_string(i));
+    EXPECT_EQ(cache.dirty(), 4u);
+    EXPECT_EQ(cache.flushCount(), 0u);
+    EXPECT_TRUE(store.batches.empty());
+
+    cache.flush();
+    ASSERT_EQ(store.batches.size(), 1u);
+    EXPECT_EQ(store.batches[0].size(), 4u);
+    EXPECT_EQ(cache.dirty(), 0u);
+}
+
+TEST(WriteBackCache, ReadThrough)
+{
+    MemoryStore store;
+    store.entries[1] = "stored";
+    Cache cache(10, store);
+
+    EXPECT_EQ(cache.get(1), "stored");
+    EXPECT_EQ(cache.get(1), "stored");
+    EXPECT_EQ(store.reads, 1);
+    EXPECT_FALSE(cache.get(2));
+    EXPECT_EQ(cache.dirty(), 0u);
+
+    cache.flush();
+    EXPECT_TRUE(store.batches.empty());
+}
+
+TEST(WriteBackCache, FlushesAtThreshold)
+{
+    MemoryStore store;
+    Cache cache(100, store, 4);
+    for (int i = 0; i < 3; ++i)
+        cache.put(i, "value");
+    EXPECT_TRUE(store.batches.empty());
+    cache.put(3, "value");
+    ASSERT_EQ(store.batches.size(), 1u);
+    EXPECT_EQ(store.batches[0].size(), 4u);
+    EXPECT_EQ(cache.dirty(), 0u);
+}
+
+TEST(WriteBackCache, FlushIfDue)
+{
+    FakeClock::current = 1s;
+    MemoryStore store;
+    Cache cache(10, store, 1024, 100ms);
+    cache.put(1, "one");
+
+    FakeClock::current += 99ms;
+    EXPECT_FALSE(cache.flushIfDue());
+    FakeClock::current += 1ms;
+    EXPECT_TRUE(cache.flushIfDue());
+    EXPECT_EQ(store.entries[1], "one");
+    EXPECT_FALSE(cache.flushIfDue());
+}
+
+TEST(WriteBackCache, FailedFlushKeepsValuesDirty)
+{
+    MemoryStore store;
+    Cache cache(1, store);
+    cache.put(1, "one");
+    cache.put(2, "two");
+
+    store.failing = true;
+    EXPECT_THROW(cache.flush(), std::runtime_error);
+    EXPECT_EQ(cache.dirty(), 2u);
+
+    store.failing = false;
+    cache.flush();
+    ASSERT_EQ(store.batches.size(), 1u);
+    EXPECT_EQ(store.batches[0].size(), 2u);
+    EXPECT_EQ(cache.dirty(), 0u);
+}
+
+TEST(WriteBackCache, Erase)
+{
+    MemoryStore store;
+    store.entries[1] = "stored";
+    Cache cache(1, store);
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.erase(1);
+    cache.erase(2);
+    EXPECT_EQ(cache.dirty(), 0u);
+    EXPECT_FALSE(cache.get(1));
+    EXPECT_FALSE(cache.get(2));
+
+    cache.flush();
+    EXPECT_TRUE(store.batches.empty());
+    EXPECT_TRUE(store.entries.empty());
+}
+
+TEST(WriteBackCache, DestructorFlushes)
+{
+    MemoryStore store;
+    {
+        Cache cache(10, store);
+        cache.put(1, "one");
+    }
+    EXPECT_EQ(store.entries[1], "one");
+
+    // Errors are swallowed
+    store.failing = true;
+    {
+        Cache cache(10, store);
+        cache.put(2, "two");
+    }
+    EXPECT_EQ(store.entries.count(2), 0u);
+}
+
+TEST(WriteBackCache, FindWithoutPromotion)
+{
+    EvictingCacheMap<int, int> map(2);
+    map.put(1, 1);
+    map.put(2, 2);
+    EXPECT_EQ(map.findWithoutPromotion(1)->second, 1);
+    EXPECT_EQ(map.findWithoutPromotion(3), map.end());
+
+    // 1 is still the least recently used entry
+    map.put(3, 3);
+    EXPECT_FALSE(map.exists(1));
+}
+
+TEST(FileBackingStore, Persists)
+{
+    const std::string path = ::testing::TempDir() + "FileBackingStore.log";
+    std::remove(path.c_str());
+    {
+        FileBackingStore<int, double> store(path);
+        EXPECT_FALSE(store.Read(1));
+        store.Write({{1, 1.5}, {2, 2.5}, {3, 3.5}});
+        store.Write({{2, 20.5}});
+        store.Remove(3);
+        EXPECT_EQ(store.Read(2), 20.5);
+        EXPECT_FALSE(store.Read(3));
+        EXPECT_EQ(store.Size(), 2u);
+        EXPECT_EQ(store.Batches(), 2u);
+        EXPECT_EQ(store.Records(), 4u);
+    }
+    {
+        FileBackingStore<int, double> store(path);
+        EXPECT_EQ(store.Size(), 2u);
+        EXPECT_EQ(store.Read(1), 1.5);
+        EXPECT_EQ(store.Read(2), 20.5);
+        EXPECT_FALSE(store.Read(3));
+    }
+    std::remove(path.c_str());
+}
+
+TEST(FileBackingStore, IgnoresTornRecord)
+{
+    const std::string path = ::testing::TempDir() + "TornRecord.log";
+    std::remove(path.c_str());
+    {
+        FileBackingStore<int, int> store(path);
+        store.Write({{1, 10}});
+    }
+    {
+        // A crash in the middle of a write leaves part of a record
+        std::ofstream(path, std::ios::binary | std::ios::app) << "xyz";
+        FileBackingStore<int, int> store(path);
+        EXPECT_EQ(store.Size(), 1u);
+        store.Write({{2, 20}});
+    }
+    FileBackingStore<int, int> store(path);
+    EXPECT_EQ(store.Read(1), 10);
+    EXPECT_EQ(store.Read(2), 20);
+    std::remove(path.c_str());
+}
+
+TEST(FileBackingStore, BehindCache)
+{
+    const std::string path = ::testing::TempDir() + "BehindCache.log";
+    std::remove(path.c_str());
+    FileBackingStore<int, int> store(path);
+    {
+        WriteBackCache<int, int> cache(16, store);
+        for (int round = 0; round < 10; ++round)
+            for (int key = 0; key < 64; ++key)
+                cache.put(key, key * round);
+        cache.flush();
+        EXPECT_EQ(cache.get(5), 45);
+    }
+    // Dirty evictions went out with the flush, one batch
+    EXPECT_EQ(store.Batches(), 1u);
+    EXPECT_EQ(store.Records(), 64u);
+    EXPECT_EQ(store.Read(63), 63 * 9);
+    std::remove(path.c_str());
+}
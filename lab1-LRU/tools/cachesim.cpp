@@ -0,0 +1,369 @@
+// cachesim - replay a key trace against caches of many capacities and print
+// the miss-ratio curve as CSV.
+//
+//   cachesim [options] TRACE
+//
+//   --format=text|u64|u64size  trace format (default text):
+//                                text     one access per line, "key" or
+//                                         "key size", the key is any token
+//                                u64      native 64-bit keys
+//                                u64size  native 64-bit key followed by a
+//                                         32-bit size, packed
+//   --policy=lru|clock|sieve|tinylfu
+//                              eviction policy (default lru)
+//   --capacities=C1,C2,...     capacities to report (default: 8 per doubling
+//                              for lru, powers of two from 16 to 2^20 for
+//                              the other policies)
+//   --bytes                    capacities are total sizes instead of entry
+//                              counts
+//
+// The trace is memory-mapped and read once.  LRU is evaluated for all
+// capacities at once from the stack distance of every access, which is exact
+// for entry counts; the other policies are not stack algorithms, so every
+// access is replayed through one EvictingCacheMap per capacity instead.
+//
+// Every output row has the capacity, the number of accesses and hits, the hit
+// ratio, the byte hit ratio (hit bytes over requested bytes) and the miss
+// ratio.  Accesses without a size count as one byte.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "EvictingCacheMap.h"
+#include "EvictionPolicies.h"
+#include "StackDistance.h"
+#include "TinyLfuEviction.h"
+
+namespace {
+
+enum class Format { Text, U64, U64Size };
+
+struct Options {
+  Format format = Format::Text;
+  std::string policy = "lru";
+  std::vector<std::uint64_t> capacities;
+  bool bytes = false;
+  std::string path;
+};
+
+struct Access {
+  std::uint64_t key;
+  std::uint64_t size;
+};
+
+/**
+ * Read-only memory mapping of a whole file.
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Unable to open " + path);
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Unable to stat " + path);
+    }
+    size = static_cast<std::size_t>(status.st_size);
+    if (size > 0) {
+      void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Unable to map " + path);
+      }
+      data = static_cast<const char*>(mapping);
+      ::madvise(mapping, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data) ::munmap(const_cast<char*>(data), size);
+  }
+
+  std::string_view Contents() const { return {data, size}; }
+
+ private:
+  const char* data = nullptr;
+  std::size_t size = 0;
+};
+
+// Call visit(Access) for every record of the trace
+template <class TVisit>
+void ForEachAccess(std::string_view trace, Format format, TVisit&& visit) {
+  if (format == Format::Text) {
+    std::hash<std::string_view> hash;
+    std::size_t pos = 0;
+    while (pos < trace.size()) {
+      std::size_t end = trace.find('\n', pos);
+      if (end == std::string_view::npos) end = trace.size();
+      std::string_view line = trace.substr(pos, end - pos);
+      pos = end + 1;
+
+      const std::size_t keyBegin = line.find_first_not_of(" \t\r");
+      if (keyBegin == std::string_view::npos) continue;
+      std::size_t keyEnd = line.find_first_of(" \t\r", keyBegin);
+      if (keyEnd == std::string_view::npos) keyEnd = line.size();
+
+      std::uint64_t size = 1;
+      const std::size_t sizeBegin = line.find_first_not_of(" \t\r", keyEnd);
+      if (sizeBegin != std::string_view::npos)
+        size = std::strtoull(line.data() + sizeBegin, nullptr, 10);
+      visit(Access{hash(line.substr(keyBegin, keyEnd - keyBegin)), size});
+    }
+    return;
+  }
+
+  const std::size_t recordSize = format == Format::U64 ? 8 : 12;
+  if (trace.size() % recordSize != 0)
+    std::fprintf(stderr, "cachesim: ignoring %zu trailing bytes\n",
+                 trace.size() % recordSize);
+  for (std::size_t pos = 0; pos + recordSize <= trace.size();
+       pos += recordSize) {
+    Access access{0, 1};
+    std::memcpy(&access.key, trace.data() + pos, 8);
+    if (format == Format::U64Size) {
+      std::uint32_t size;
+      std::memcpy(&size, trace.data() + pos + 8, 4);
+      access.size = size;
+    }
+    visit(access);
+  }
+}
+
+struct Row {
+  std::uint64_t capacity = 0;
+  std::uint64_t hits = 0;
+  std::uint64_t hitBytes = 0;
+};
+
+struct Result {
+  std::vector<Row> rows;
+  std::uint64_t accesses = 0;
+  std::uint64_t bytes = 0;
+};
+
+// Capacities spaced evenly on a log scale with eight points per doubling
+std::vector<std::uint64_t> LogCapacities(std::uint64_t max) {
+  std::vector<std::uint64_t> capacities;
+  for (double capacity = 1;; capacity *= 1.0905077326652577) {
+    const auto rounded = static_cast<std::uint64_t>(capacity + 0.5);
+    if (capacities.empty() || rounded != capacities.back())
+      capacities.push_back(rounded);
+    if (rounded >= max) break;
+  }
+  return capacities;
+}
+
+// Stack distance histogram, bucketed so that the capacities given or the
+// default log scale are exact
+Result SimulateLru(std::string_view trace, const Options& options) {
+  const bool explicitCapacities = !options.capacities.empty();
+  std::vector<std::uint64_t> bounds = options.capacities;
+  if (!explicitCapacities)
+    bounds = LogCapacities(std::numeric_limits<std::uint32_t>::max() *
+                           (options.bytes ? 1024ULL : 1ULL));
+
+  Result result;
+  std::vector<Row> buckets(bounds.size());
+  std::uint64_t largestDistance = 0;
+  StackDistance stack;
+  ForEachAccess(trace, options.format, [&](const Access& access) {
+    ++result.accesses;
+    result.bytes += access.size;
+    const StackDistance::Distance distance =
+        stack.Access(access.key, access.size);
+    const std::uint64_t d = options.bytes ? distance.bytes : distance.entries;
+    if (d == StackDistance::Infinite) return;
+    largestDistance = std::max(largestDistance, d);
+    // The smallest capacity which still hits
+    const auto bucket = static_cast<std::size_t>(
+        std::lower_bound(bounds.begin(), bounds.end(), d) - bounds.begin());
+    if (bucket == bounds.size()) return;
+    ++buckets[bucket].hits;
+    buckets[bucket].hitBytes += access.size;
+  });
+
+  Row cumulative;
+  for (std::size_t i = 0; i < bounds.size(); ++i) {
+    cumulative.capacity = bounds[i];
+    cumulative.hits += buckets[i].hits;
+    cumulative.hitBytes += buckets[i].hitBytes;
+    result.rows.push_back(cumulative);
+    // Larger caches hit just as much
+    if (!explicitCapacities && bounds[i] >= largestDistance) break;
+  }
+  return result;
+}
+
+struct SizeWeigher {
+  std::size_t operator()(std::uint64_t, std::uint64_t size) const {
+    return size;
+  }
+};
+
+// Replay through one map per capacity, all fed in the same pass
+template <class TPolicy, class TWeigher>
+Result Replay(std::string_view trace, const Options& options) {
+  using Map = EvictingCacheMap<
+      std::uint64_t, std::uint64_t, std::hash<std::uint64_t>,
+      std::equal_to<std::uint64_t>, TPolicy,
+      std::allocator<std::pair<const std::uint64_t, std::uint64_t>>,
+      TWeigher>;
+
+  std::vector<std::uint64_t> capacities = options.capacities;
+  if (capacities.empty())
+    for (std::uint64_t capacity = 16; capacity <= (1 << 20); capacity *= 2)
+      capacities.push_back(capacity);
+
+  std::vector<std::unique_ptr<Map>> maps;
+  for (std::uint64_t capacity : capacities) {
+    if constexpr (std::is_same_v<TWeigher, UnitWeigher>)
+      maps.push_back(std::make_unique<Map>(capacity));
+    else
+      // Assume 1KB per entry on average to size the policy state
+      maps.push_back(std::make_unique<Map>(
+          capacity, std::max<std::uint64_t>(capacity / 1024, 16),
+          TWeigher()));
+  }
+
+  Result result;
+  result.rows.resize(capacities.size());
+  for (std::size_t i = 0; i < capacities.size(); ++i)
+    result.rows[i].capacity = capacities[i];
+  ForEachAccess(trace, options.format, [&](const Access& access) {
+    ++result.accesses;
+    result.bytes += access.size;
+    for (std::size_t i = 0; i < maps.size(); ++i) {
+      auto found = maps[i]->find(access.key);
+      if (found == maps[i]->end() || found->second != access.size)
+        maps[i]->put(access.key, access.size);
+      if (found != maps[i]->end()) {
+        ++result.rows[i].hits;
+        result.rows[i].hitBytes += access.size;
+      }
+    }
+  });
+  return result;
+}
+
+template <class TWeigher>
+Result Simulate(std::string_view trace, const Options& options) {
+  if (options.policy == "lru") return SimulateLru(trace, options);
+  if (options.policy == "clock")
+    return Replay<ClockEviction, TWeigher>(trace, options);
+  if (options.policy == "sieve")
+    return Replay<SieveEviction, TWeigher>(trace, options);
+  if (options.policy == "tinylfu")
+    return Replay<WTinyLfuEviction, TWeigher>(trace, options);
+  throw std::invalid_argument("Unknown policy " + options.policy);
+}
+
+void PrintCsv(const Result& result) {
+  std::printf("capacity,accesses,hits,hit_ratio,byte_hit_ratio,miss_ratio\n");
+  for (const Row& row : result.rows) {
+    const double hitRatio =
+        result.accesses ? static_cast<double>(row.hits) / result.accesses : 0;
+    const double byteHitRatio =
+        result.bytes ? static_cast<double>(row.hitBytes) / result.bytes : 0;
+    std::printf("%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.6f,%.6f,%.6f\n",
+                row.capacity, result.accesses, row.hits, hitRatio,
+                byteHitRatio, 1 - hitRatio);
+  }
+}
+
+std::vector<std::uint64_t> ParseCapacities(std::string_view list) {
+  std::vector<std::uint64_t> capacities;
+  while (!list.empty()) {
+    const std::size_t comma = std::min(list.find(','), list.size());
+    const std::string item(list.substr(0, comma));
+    char* end = nullptr;
+    const std::uint64_t capacity = std::strtoull(item.c_str(), &end, 10);
+    if (item.empty() || *end != '\0' || capacity == 0)
+      throw std::invalid_argument("Invalid capacity '" + item + "'");
+    capacities.push_back(capacity);
+    list.remove_prefix(std::min(comma + 1, list.size()));
+  }
+  std::sort(capacities.begin(), capacities.end());
+  capacities.erase(std::unique(capacities.begin(), capacities.end()),
+                   capacities.end());
+  return capacities;
+}
+
+Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    auto value = [&arg](std::string_view name) {
+      return arg.substr(0, name.size()) == name ? arg.substr(name.size())
+                                                : std::string_view();
+    };
+    if (!value("--format=").empty()) {
+      const std::string_view format = value("--format=");
+      if (format == "text")
+        options.format = Format::Text;
+      else if (format == "u64")
+        options.format = Format::U64;
+      else if (format == "u64size")
+        options.format = Format::U64Size;
+      else
+        throw std::invalid_argument("Unknown format " + std::string(format));
+    } else if (!value("--policy=").empty()) {
+      options.policy = value("--policy=");
+    } else if (!value("--capacities=").empty()) {
+      options.capacities = ParseCapacities(value("--capacities="));
+    } else if (arg == "--bytes") {
+      options.bytes = true;
+    } else if (arg.substr(0, 2) != "--" && options.path.empty()) {
+      options.path = arg;
+    } else {
+      throw std::invalid_argument("Unexpected argument " + std::string(arg));
+    }
+  }
+  if (options.path.empty()) throw std::invalid_argument("No trace given");
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  try {
+    const Options options = ParseOptions(argc, argv);
+    const MappedFile file(options.path);
+    const Result result =
+        options.bytes ? Simulate<SizeWeigher>(file.Contents(), options)
+                      : Simulate<UnitWeigher>(file.Contents(), options);
+    PrintCsv(result);
+  } catch (const std::invalid_argument& error) {
+    std::fprintf(stderr,
+                 "cachesim: %s\n"
+                 "usage: cachesim [--format=text|u64|u64size] "
+                 "[--policy=lru|clock|sieve|tinylfu]\n"
+                 "                [--capacities=C1,C2,...] [--bytes] TRACE\n",
+                 error.what());
+    return 2;
+  } catch (const std::exception& error) {
+    std::fprintf(stderr, "cachesim: %s\n", error.what());
+    return 1;
+  }
+}